@@ -0,0 +1,1142 @@
+#include "Boolean.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "Parallel.h"
+#include "Picker.h"
+#include "Tessellator.h"
+#include "Validator.h"
+
+namespace {
+
+struct P2 {
+	double x, y;
+};
+
+double cross(const P2& a, const P2& b, const P2& c) {
+	return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+double signedArea(const vector<P2>& loop) {
+	double area = 0;
+	for (size_t i = 0, j = loop.size() - 1; i < loop.size(); j = i++) {
+		area += loop[j].x * loop[i].y - loop[i].x * loop[j].y;
+	}
+	return area / 2;
+}
+
+// even-odd rule over all loops
+bool inside(const vector<vector<P2>>& loops, const P2& p) {
+	bool in = false;
+	for (const vector<P2>& loop : loops) {
+		for (size_t i = 0, j = loop.size() - 1; i < loop.size(); j = i++) {
+			const P2& a = loop[j];
+			const P2& b = loop[i];
+			if ((a.y > p.y) != (b.y > p.y) && p.x < a.x + (p.y - a.y) / (b.y - a.y) * (b.x - a.x)) {
+				in = !in;
+			}
+		}
+	}
+	return in;
+}
+
+double boundaryDistance(const vector<vector<P2>>& loops, const P2& p) {
+	double nearest = numeric_limits<double>::infinity();
+	for (const vector<P2>& loop : loops) {
+		for (size_t i = 0, j = loop.size() - 1; i < loop.size(); j = i++) {
+			double dx = loop[i].x - loop[j].x, dy = loop[i].y - loop[j].y;
+			double length = dx * dx + dy * dy;
+			double s = length > 0 ? ((p.x - loop[j].x) * dx + (p.y - loop[j].y) * dy) / length : 0;
+			s = max(0.0, min(1.0, s));
+			nearest = min(nearest, hypot(loop[j].x + s * dx - p.x, loop[j].y + s * dy - p.y));
+		}
+	}
+	return nearest;
+}
+
+// A point strictly inside a polygon with holes (outer loop counter-clockwise,
+// holes clockwise): the lowest left corner of the outer loop is convex, and
+// either no other vertex lies in the triangle it makes with its neighbours,
+// whose centroid then is inside, or the segment from the corner to the
+// vertex in it nearest to the corner is, and so is its midpoint.
+P2 interiorPoint(const vector<vector<P2>>& loops) {
+	const vector<P2>& outer = loops[0];
+	size_t n = outer.size(), corner = 0;
+	for (size_t i = 1; i < n; ++i) {
+		if (outer[i].x < outer[corner].x || (outer[i].x == outer[corner].x && outer[i].y < outer[corner].y)) {
+			corner = i;
+		}
+	}
+	const P2& a = outer[(corner + n - 1) % n];
+	const P2& b = outer[corner];
+	const P2& c = outer[(corner + 1) % n];
+	double area = cross(a, b, c);
+	const P2* nearest = nullptr;
+	double depth = 0;
+	for (const vector<P2>& loop : loops) {
+		for (const P2& q : loop) {
+			if (&q == &a || &q == &b || &q == &c) {
+				continue;
+			}
+			double wa = cross(b, c, q), wb = cross(c, a, q), wc = cross(a, b, q);
+			if (area > 0 ? (wa > 0 && wb > 0 && wc > 0) : (wa < 0 && wb < 0 && wc < 0)) {
+				if (fabs(wb) > depth) { // furthest from the line a-c, nearest to b
+					depth = fabs(wb);
+					nearest = &q;
+				}
+			}
+		}
+	}
+	if (nearest) {
+		return { (b.x + nearest->x) / 2, (b.y + nearest->y) / 2 };
+	}
+	return { (a.x + b.x + c.x) / 3, (a.y + b.y + c.y) / 3 };
+}
+
+double distance2(const Point& p, const Point& q) {
+	return (p.x - q.x) * (p.x - q.x) + (p.y - q.y) * (p.y - q.y) + (p.z - q.z) * (p.z - q.z);
+}
+
+Point lerp(const Point& p, const Point& q, double s) {
+	return Point(p.x + s * (q.x - p.x), p.y + s * (q.y - p.y), p.z + s * (q.z - p.z));
+}
+
+double dot(const double* v, const Point& p) {
+	return v[0] * p.x + v[1] * p.y + v[2] * p.z;
+}
+
+// Merges points closer than eps: a hash grid of cells eps wide, so a new point
+// is compared only with the ones in the 27 cells around it.
+struct Welder {
+	explicit Welder(double _eps) : eps(_eps) {}
+
+	uint32_t add(const Point& p) {
+		int64_t cx = cell(p.x), cy = cell(p.y), cz = cell(p.z);
+		for (int64_t x = cx - 1; x <= cx + 1; ++x) {
+			for (int64_t y = cy - 1; y <= cy + 1; ++y) {
+				for (int64_t z = cz - 1; z <= cz + 1; ++z) {
+					auto it = first.find(key(x, y, z));
+					for (uint32_t i = it == first.end() ? none : it->second; i != none; i = chain[i]) {
+						if (distance2(points[i], p) <= eps * eps) {
+							return i;
+						}
+					}
+				}
+			}
+		}
+		uint32_t i = static_cast<uint32_t>(points.size());
+		points.push_back(p);
+		auto [it, added] = first.try_emplace(key(cx, cy, cz), i);
+		chain.push_back(added ? none : it->second);
+		it->second = i;
+		return i;
+	}
+
+	static constexpr uint32_t none = ~0u;
+
+	double eps;
+	vector<Point> points;
+	vector<uint32_t> chain; // next point in the same bucket
+	unordered_map<uint64_t, uint32_t> first;
+
+private:
+	int64_t cell(double x) const {
+		return static_cast<int64_t>(floor(x / eps));
+	}
+
+	static uint64_t key(int64_t x, int64_t y, int64_t z) {
+		return uint64_t(x) * 73856093u ^ uint64_t(y) * 19349663u ^ uint64_t(z) * 83492791u;
+	}
+};
+
+uint64_t edgeKey(uint32_t a, uint32_t b) {
+	return uint64_t(a) << 32 | b;
+}
+
+enum class Place { outside, inside, same, opposite }; // same, opposite: on a face of the other solid
+
+struct FaceData {
+	Face* face = nullptr;
+	int side = 0; // 0 for a, 1 for b
+	Plane plane;
+	double outward[3] = { 0, 0, 0 }; // plane.normal, turned round for an inside-out solid
+	int u = 0, v = 1, w = 2; // the outer loop runs counter-clockwise in the (u, v) projection
+	vector<vector<Vertex*>> loops; // outer loop first
+	Box box; // grown by eps
+	bool candidate = false; // its box meets a face box of the other solid
+	vector<pair<Point, Point>> cuts; // where faces of the other solid cross it
+	vector<uint32_t> coplanar; // faces of the other solid in the same plane
+	vector<vector<vector<Point>>> pieces; // what the result keeps, outer loop first, oriented for it
+
+	P2 project(const Point& p) const {
+		const double c[3] = { p.x, p.y, p.z };
+		return { c[u], c[v] };
+	}
+
+	Point lift(const P2& q) const {
+		double c[3];
+		c[u] = q.x;
+		c[v] = q.y;
+		c[w] = -(plane.d + plane.normal[u] * q.x + plane.normal[v] * q.y) / plane.normal[w];
+		return Point(c[0], c[1], c[2]);
+	}
+
+	// loops projected onto the plane of frame
+	vector<vector<P2>> projectLoops(const FaceData& frame) const {
+		vector<vector<P2>> projected(loops.size());
+		for (size_t l = 0; l < loops.size(); ++l) {
+			for (Vertex* vertex : loops[l]) {
+				projected[l].push_back(frame.project(*vertex->point));
+			}
+		}
+		return projected;
+	}
+};
+
+struct SolidData {
+	Solid* solid = nullptr;
+	double sign = 1; // -1 when the faces point inwards
+	vector<double> triangles; // 9 coordinates each
+	vector<uint32_t> triangle_face; // FaceData index of every triangle
+	vector<Box> boxes;
+	BoxTree tree;
+};
+
+// The loops of a face and the cuts across it as a planar graph in the face's
+// projection, every piece of boundary a half-edge with the face on its left
+// and every cut a pair of them.
+struct Arrangement {
+	vector<Point> points;
+	vector<P2> xy;
+	vector<uint32_t> from, to;
+	vector<int32_t> twin; // -1 on the boundary
+	vector<double> angle;
+	vector<char> alive; // not part of a dangling cut
+	vector<int32_t> region; // on the left, -1 for none
+};
+
+// Where the line through both planes (along direction) runs inside the face:
+// the points where its edges cross `plane`, sorted along the line and taken
+// in pairs. Distances within eps count as 0 and 0 as positive, so a vertex
+// on the plane is crossed at most once; each edge is interpolated from its
+// lower vertex id, so the faces on both sides of it get the same point.
+void crossings(const FaceData& face, const Plane& plane, const double direction[3], double eps,
+               vector<pair<double, Point>>& out) {
+	out.clear();
+	for (const vector<Vertex*>& loop : face.loops) {
+		for (size_t i = 0; i < loop.size(); ++i) {
+			Vertex* p = loop[i];
+			Vertex* q = loop[(i + 1) % loop.size()];
+			if (p->VertexId > q->VertexId) {
+				swap(p, q);
+			}
+			double dp = plane.distance(*p->point), dq = plane.distance(*q->point);
+			dp = fabs(dp) <= eps ? 0 : dp;
+			dq = fabs(dq) <= eps ? 0 : dq;
+			if ((dp >= 0) != (dq >= 0)) {
+				Point x = lerp(*p->point, *q->point, dp / (dp - dq));
+				out.push_back({ dot(direction, x), x });
+			}
+		}
+	}
+	sort(out.begin(), out.end(), [](const pair<double, Point>& l, const pair<double, Point>& r) {
+		return l.first < r.first;
+	});
+}
+
+bool onPlane(const FaceData& face, const Plane& plane, double eps) {
+	for (const vector<Vertex*>& loop : face.loops) {
+		for (Vertex* vertex : loop) {
+			if (fabs(plane.distance(*vertex->point)) > eps) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// the parts of the edges of `edges` strictly inside `face`, both in one plane
+void clipEdges(const FaceData& face, const FaceData& edges, double eps, vector<pair<Point, Point>>& out) {
+	vector<vector<P2>> polygon = face.projectLoops(face);
+	vector<double> cuts;
+	for (const vector<Vertex*>& loop : edges.loops) {
+		for (size_t i = 0; i < loop.size(); ++i) {
+			const Point& p = *loop[i]->point;
+			const Point& q = *loop[(i + 1) % loop.size()]->point;
+			P2 a = face.project(p), b = face.project(q);
+			double dx = b.x - a.x, dy = b.y - a.y, length = hypot(dx, dy);
+			if (length <= eps) {
+				continue;
+			}
+			cuts.assign({ 0, 1 });
+			for (const vector<P2>& boundary : polygon) {
+				for (size_t j = 0, k = boundary.size() - 1; j < boundary.size(); k = j++) {
+					const P2& c = boundary[k];
+					const P2& d = boundary[j];
+					double ex = d.x - c.x, ey = d.y - c.y;
+					double denominator = dx * ey - dy * ex;
+					if (denominator != 0) {
+						double s = ((c.x - a.x) * ey - (c.y - a.y) * ex) / denominator;
+						double t = ((c.x - a.x) * dy - (c.y - a.y) * dx) / denominator;
+						if (s > 0 && s < 1 && t >= 0 && t <= 1) {
+							cuts.push_back(s);
+						}
+					}
+					// a corner of face touching the edge
+					double s = ((d.x - a.x) * dx + (d.y - a.y) * dy) / (length * length);
+					if (s > 0 && s < 1 && fabs(cross(a, b, d)) / length <= eps) {
+						cuts.push_back(s);
+					}
+				}
+			}
+			sort(cuts.begin(), cuts.end());
+			for (size_t j = 0; j + 1 < cuts.size(); ++j) {
+				if ((cuts[j + 1] - cuts[j]) * length <= eps) {
+					continue;
+				}
+				double middle = (cuts[j] + cuts[j + 1]) / 2;
+				P2 m = { a.x + middle * dx, a.y + middle * dy };
+				if (inside(polygon, m) && boundaryDistance(polygon, m) > eps) {
+					out.push_back({ lerp(p, q, cuts[j]), lerp(p, q, cuts[j + 1]) });
+				}
+			}
+		}
+	}
+}
+
+// Cuts of a non-coplanar pair: where the intervals the two faces leave on
+// the line through both planes overlap.
+void intersectFaces(const FaceData& f, const FaceData& g, double eps, vector<pair<Point, Point>>& out) {
+	const double* m = f.plane.normal;
+	const double* n = g.plane.normal;
+	double direction[3] = { m[1] * n[2] - m[2] * n[1], m[2] * n[0] - m[0] * n[2], m[0] * n[1] - m[1] * n[0] };
+	double length = sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+	if (length < 1e-12) {
+		return; // parallel planes further apart than eps
+	}
+	for (double& c : direction) {
+		c /= length;
+	}
+	vector<pair<double, Point>> in_f, in_g;
+	crossings(f, g.plane, direction, eps, in_f);
+	if (in_f.empty()) {
+		return;
+	}
+	crossings(g, f.plane, direction, eps, in_g);
+	for (size_t i = 0, j = 0; i + 1 < in_f.size() && j + 1 < in_g.size();) {
+		const pair<double, Point>& low = in_f[i].first > in_g[j].first ? in_f[i] : in_g[j];
+		const pair<double, Point>& high = in_f[i + 1].first < in_g[j + 1].first ? in_f[i + 1] : in_g[j + 1];
+		if (high.first - low.first > eps) {
+			out.push_back({ low.second, high.second });
+		}
+		if (in_f[i + 1].first < in_g[j + 1].first) {
+			i += 2;
+		} else {
+			j += 2;
+		}
+	}
+}
+
+// Nodes from the loops (first) and from the cuts, welded; loop edges split
+// where a cut ends on them and cuts split where a node lies on them; cuts
+// along the boundary and dangling cuts (which bound nothing) dropped.
+void arrange(const FaceData& face, double eps, Arrangement& graph) {
+	Welder welder(eps);
+	vector<pair<uint32_t, uint32_t>> boundary, cuts;
+	for (const vector<Vertex*>& loop : face.loops) {
+		vector<uint32_t> nodes;
+		for (Vertex* vertex : loop) {
+			nodes.push_back(welder.add(*vertex->point));
+		}
+		for (size_t i = 0; i < nodes.size(); ++i) {
+			if (nodes[i] != nodes[(i + 1) % nodes.size()]) {
+				boundary.push_back({ nodes[i], nodes[(i + 1) % nodes.size()] });
+			}
+		}
+	}
+	uint32_t loop_nodes = static_cast<uint32_t>(welder.points.size());
+	for (const pair<Point, Point>& cut : face.cuts) {
+		uint32_t a = welder.add(cut.first), b = welder.add(cut.second);
+		if (a != b) {
+			cuts.push_back({ min(a, b), max(a, b) });
+		}
+	}
+	sort(cuts.begin(), cuts.end());
+	cuts.erase(unique(cuts.begin(), cuts.end()), cuts.end());
+	graph.points = move(welder.points);
+	const vector<Point>& points = graph.points;
+	uint32_t count = static_cast<uint32_t>(points.size());
+	graph.xy.resize(count);
+	P2 low = { numeric_limits<double>::infinity(), numeric_limits<double>::infinity() };
+	P2 high = { -low.x, -low.y };
+	for (uint32_t i = 0; i < count; ++i) {
+		P2 p = graph.xy[i] = face.project(points[i]);
+		low = { min(low.x, p.x), min(low.y, p.y) };
+		high = { max(high.x, p.x), max(high.y, p.y) };
+	}
+
+	// a grid of about one node per cell finds the nodes near an edge
+	int cells = max(1, min(1024, static_cast<int>(sqrt(double(count)))));
+	double size = max(high.x - low.x, high.y - low.y) / cells + eps;
+	auto cellOf = [&](double value, double origin) {
+		return max(0, min(cells - 1, static_cast<int>((value - origin) / size)));
+	};
+	vector<uint32_t> cell_first(size_t(cells) * cells + 1, 0), cell_nodes(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		++cell_first[cellOf(graph.xy[i].y, low.y) * cells + cellOf(graph.xy[i].x, low.x) + 1];
+	}
+	partial_sum(cell_first.begin(), cell_first.end(), cell_first.begin());
+	{
+		vector<uint32_t> fill(cell_first.begin(), cell_first.end() - 1);
+		for (uint32_t i = 0; i < count; ++i) {
+			cell_nodes[fill[cellOf(graph.xy[i].y, low.y) * cells + cellOf(graph.xy[i].x, low.x)]++] = i;
+		}
+	}
+	vector<pair<double, uint32_t>> on_edge;
+	auto split = [&](uint32_t a, uint32_t b, uint32_t first_candidate, vector<uint32_t>& chain) {
+		on_edge.clear();
+		const Point& p = points[a];
+		const Point& q = points[b];
+		double length2 = distance2(p, q);
+		int x0 = cellOf(min(graph.xy[a].x, graph.xy[b].x) - eps, low.x);
+		int x1 = cellOf(max(graph.xy[a].x, graph.xy[b].x) + eps, low.x);
+		int y0 = cellOf(min(graph.xy[a].y, graph.xy[b].y) - eps, low.y);
+		int y1 = cellOf(max(graph.xy[a].y, graph.xy[b].y) + eps, low.y);
+		for (int y = y0; y <= y1; ++y) {
+			for (int x = x0; x <= x1; ++x) {
+				for (uint32_t k = cell_first[y * cells + x]; k < cell_first[y * cells + x + 1]; ++k) {
+					uint32_t node = cell_nodes[k];
+					if (node < first_candidate || node == a || node == b) {
+						continue;
+					}
+					const Point& r = points[node];
+					double s = ((r.x - p.x) * (q.x - p.x) + (r.y - p.y) * (q.y - p.y) + (r.z - p.z) * (q.z - p.z)) / length2;
+					if (s > 0 && s < 1 && distance2(r, lerp(p, q, s)) <= eps * eps) {
+						on_edge.push_back({ s, node });
+					}
+				}
+			}
+		}
+		sort(on_edge.begin(), on_edge.end());
+		chain.assign(1, a);
+		for (const pair<double, uint32_t>& node : on_edge) {
+			chain.push_back(node.second);
+		}
+		chain.push_back(b);
+	};
+
+	graph.from.clear();
+	graph.to.clear();
+	graph.twin.clear();
+	unordered_set<uint64_t> boundary_keys;
+	vector<uint32_t> chain;
+	for (const pair<uint32_t, uint32_t>& edge : boundary) {
+		split(edge.first, edge.second, loop_nodes, chain); // only cuts end inside loop edges
+		for (size_t i = 0; i + 1 < chain.size(); ++i) {
+			graph.from.push_back(chain[i]);
+			graph.to.push_back(chain[i + 1]);
+			graph.twin.push_back(-1);
+			boundary_keys.insert(edgeKey(chain[i], chain[i + 1]));
+		}
+	}
+	vector<pair<uint32_t, uint32_t>> pieces;
+	for (const pair<uint32_t, uint32_t>& edge : cuts) {
+		split(edge.first, edge.second, 0, chain);
+		for (size_t i = 0; i + 1 < chain.size(); ++i) {
+			uint32_t a = chain[i], b = chain[i + 1];
+			if (!boundary_keys.count(edgeKey(a, b)) && !boundary_keys.count(edgeKey(b, a))) {
+				pieces.push_back({ min(a, b), max(a, b) });
+			}
+		}
+	}
+	sort(pieces.begin(), pieces.end());
+	pieces.erase(unique(pieces.begin(), pieces.end()), pieces.end());
+	for (const pair<uint32_t, uint32_t>& piece : pieces) {
+		int32_t h = static_cast<int32_t>(graph.from.size());
+		graph.from.insert(graph.from.end(), { piece.first, piece.second });
+		graph.to.insert(graph.to.end(), { piece.second, piece.first });
+		graph.twin.insert(graph.twin.end(), { h + 1, h });
+	}
+
+	size_t half_edges = graph.from.size();
+	graph.angle.resize(half_edges);
+	for (size_t h = 0; h < half_edges; ++h) {
+		const P2& a = graph.xy[graph.from[h]];
+		const P2& b = graph.xy[graph.to[h]];
+		graph.angle[h] = atan2(b.y - a.y, b.x - a.x);
+	}
+
+	// drop dangling cuts, which end at a node with no other edge
+	graph.alive.assign(half_edges, 1);
+	vector<uint32_t> degree(count, 0);
+	vector<vector<uint32_t>> cuts_at(count);
+	for (size_t h = 0; h < half_edges; ++h) {
+		if (graph.twin[h] < 0 || graph.twin[h] > int32_t(h)) {
+			++degree[graph.from[h]];
+			++degree[graph.to[h]];
+		}
+		if (graph.twin[h] >= 0) {
+			cuts_at[graph.from[h]].push_back(static_cast<uint32_t>(h));
+		}
+	}
+	vector<uint32_t> loose;
+	for (uint32_t i = 0; i < count; ++i) {
+		if (degree[i] == 1) {
+			loose.push_back(i);
+		}
+	}
+	while (!loose.empty()) {
+		uint32_t node = loose.back();
+		loose.pop_back();
+		for (uint32_t h : cuts_at[node]) {
+			if (graph.alive[h]) {
+				graph.alive[h] = graph.alive[graph.twin[h]] = 0;
+				--degree[node];
+				if (--degree[graph.to[h]] == 1) {
+					loose.push_back(graph.to[h]);
+				}
+			}
+		}
+	}
+}
+
+// Cycles of the half-edges marked in use, turning as far right as possible
+// at every node, which traces each region on their left. Returns false when
+// they do not join up into cycles.
+bool traceCycles(const Arrangement& graph, const vector<char>& use, vector<vector<uint32_t>>& cycles) {
+	vector<vector<uint32_t>> around(graph.points.size());
+	for (uint32_t h = 0; h < use.size(); ++h) {
+		if (use[h]) {
+			around[graph.from[h]].push_back(h);
+		}
+	}
+	for (vector<uint32_t>& outgoing : around) {
+		sort(outgoing.begin(), outgoing.end(), [&](uint32_t l, uint32_t r) {
+			return graph.angle[l] < graph.angle[r];
+		});
+	}
+	auto next = [&](uint32_t h) {
+		const vector<uint32_t>& outgoing = around[graph.to[h]];
+		const P2& a = graph.xy[graph.from[h]];
+		const P2& b = graph.xy[graph.to[h]];
+		double back = atan2(a.y - b.y, a.x - b.x); // as the twin's angle
+		auto it = lower_bound(outgoing.begin(), outgoing.end(), back, [&](uint32_t g, double value) {
+			return graph.angle[g] < value;
+		});
+		return it == outgoing.begin() ? outgoing.back() : *(it - 1);
+	};
+	cycles.clear();
+	vector<char> seen(use.size(), 0);
+	for (uint32_t h = 0; h < use.size(); ++h) {
+		if (!use[h] || seen[h]) {
+			continue;
+		}
+		vector<uint32_t> cycle;
+		uint32_t g = h;
+		do {
+			if (seen[g]) {
+				return false;
+			}
+			seen[g] = 1;
+			cycle.push_back(g);
+			g = next(g);
+		} while (g != h);
+		cycles.push_back(move(cycle));
+	}
+	return true;
+}
+
+vector<P2> cyclePoints(const Arrangement& graph, const vector<uint32_t>& cycle) {
+	vector<P2> loop;
+	for (uint32_t h : cycle) {
+		loop.push_back(graph.xy[graph.from[h]]);
+	}
+	return loop;
+}
+
+// Groups cycles into polygons: each counter-clockwise cycle with the
+// clockwise ones (holes) that lie in it and in no smaller one.
+// Holes outside every cycle are dropped.
+vector<vector<uint32_t>> groupCycles(const Arrangement& graph, const vector<vector<uint32_t>>& cycles) {
+	vector<double> area(cycles.size());
+	vector<uint32_t> outer;
+	vector<vector<uint32_t>> polygons;
+	vector<uint32_t> polygon_of(cycles.size(), ~0u);
+	for (uint32_t i = 0; i < cycles.size(); ++i) {
+		area[i] = signedArea(cyclePoints(graph, cycles[i]));
+		if (area[i] > 0) {
+			polygon_of[i] = static_cast<uint32_t>(polygons.size());
+			polygons.push_back({ i });
+			outer.push_back(i);
+		}
+	}
+	vector<Box> boxes;
+	for (uint32_t i : outer) {
+		Box box;
+		for (uint32_t h : cycles[i]) {
+			box.add(Point(graph.xy[graph.from[h]].x, graph.xy[graph.from[h]].y, 0));
+		}
+		boxes.push_back(box);
+	}
+	BoxTree tree;
+	if (outer.size() > 1) {
+		tree.build(boxes, 1);
+	}
+	// a hole's node on the cycle tested says nothing (the hole may run along
+	// the other side of its edges), so test one that is not
+	vector<uint32_t> stamp(graph.points.size(), ~0u);
+	for (uint32_t i = 0; i < cycles.size(); ++i) {
+		if (area[i] >= 0) {
+			continue;
+		}
+		Box hole;
+		for (uint32_t h : cycles[i]) {
+			hole.add(Point(graph.xy[graph.from[h]].x, graph.xy[graph.from[h]].y, 0));
+		}
+		uint32_t best = ~0u;
+		auto test = [&](uint32_t k) {
+			uint32_t candidate = outer[k];
+			if (best != ~0u && area[candidate] >= area[best]) {
+				return;
+			}
+			for (uint32_t h : cycles[candidate]) {
+				stamp[graph.from[h]] = candidate;
+			}
+			for (uint32_t h : cycles[i]) {
+				if (stamp[graph.from[h]] != candidate) {
+					if (inside({ cyclePoints(graph, cycles[candidate]) }, graph.xy[graph.from[h]])) {
+						best = candidate;
+					}
+					return;
+				}
+			}
+		};
+		if (outer.size() == 1) {
+			test(0);
+		} else {
+			tree.overlapping(hole, test);
+		}
+		if (best != ~0u) {
+			polygons[polygon_of[best]].push_back(i);
+		}
+	}
+	return polygons;
+}
+
+// Place of p, a point of face, relative to the other solid: on a face of it
+// lying in the same plane, or else by the nearest face a ray from p meets.
+// Rays that pass too close to an edge or graze a face are cast again in
+// another direction.
+Place locate(const Point& p, const FaceData& face, const vector<FaceData>& faces, const SolidData& other, double eps) {
+	if (!face.coplanar.empty()) {
+		P2 q = face.project(p);
+		for (uint32_t g : face.coplanar) {
+			vector<vector<P2>> loops = faces[g].projectLoops(face);
+			if (inside(loops, q) && boundaryDistance(loops, q) > eps) {
+				const double* m = face.outward;
+				const double* n = faces[g].outward;
+				return m[0] * n[0] + m[1] * n[1] + m[2] * n[2] > 0 ? Place::same : Place::opposite;
+			}
+		}
+	}
+	// unit length, and far from any direction with small integer ratios
+	static const double directions[][3] = {
+		{ 0.3240349, 0.5590912, 0.7631634 }, { -0.6474841, 0.3306419, 0.6866151 },
+		{ 0.4171657, -0.7463688, 0.5185618 }, { -0.3790557, -0.6288240, -0.6788940 },
+		{ 0.8120316, 0.2355926, -0.5339483 }, { -0.6961348, 0.1528723, -0.7014459 },
+	};
+	Place fallback = Place::outside;
+	for (size_t attempt = 0; attempt < size(directions); ++attempt) {
+		const double* d = directions[attempt];
+		Ray ray = { p, Point(d[0], d[1], d[2]) };
+		double t_max = numeric_limits<double>::max();
+		int64_t hit = -1;
+		double weights[2] = { 0, 0 };
+		other.tree.traverse(ray, t_max, [&](uint32_t triangle) {
+			const double* corner = &other.triangles[9 * size_t(triangle)];
+			double t, w[2];
+			if (intersectTriangle(corner, corner + 3, corner + 6, ray, t_max, t, w, 1e-7)) {
+				t_max = t;
+				hit = triangle;
+				weights[0] = w[0];
+				weights[1] = w[1];
+			}
+		});
+		if (hit < 0) {
+			return Place::outside;
+		}
+		const double* n = faces[other.triangle_face[hit]].outward;
+		double facing = d[0] * n[0] + d[1] * n[1] + d[2] * n[2];
+		Place place = facing > 0 ? Place::inside : Place::outside; // leaving through the hit face
+		if (attempt == 0) {
+			fallback = place;
+		}
+		double margin = min(min(weights[0], weights[1]), 1 - weights[0] - weights[1]);
+		if (t_max > eps && fabs(facing) > 1e-3 && margin > 1e-7) {
+			return place;
+		}
+	}
+	return fallback;
+}
+
+bool keep(Boolean::Operation operation, int side, Place place) {
+	switch (operation) {
+	case Boolean::Operation::unite:
+		return place == Place::outside || (side == 0 && place == Place::same);
+	case Boolean::Operation::intersect:
+		return place == Place::inside || (side == 0 && place == Place::same);
+	case Boolean::Operation::subtract:
+		return side == 0 ? place == Place::outside || place == Place::opposite : place == Place::inside;
+	}
+	return false;
+}
+
+uint32_t findRoot(vector<uint32_t>& parent, uint32_t v) {
+	while (parent[v] != v) {
+		parent[v] = parent[parent[v]];
+		v = parent[v];
+	}
+	return v;
+}
+
+} // namespace
+
+Solid* Boolean::apply(Brep& brep, Solid* a, Solid* b, Operation operation) {
+	error = nullptr;
+	candidate_pairs = cut_faces = 0;
+	if (a == b) {
+		error = "a Boolean needs two different solids";
+		return nullptr;
+	}
+	Box bounds = a->box();
+	bounds.add(b->box());
+	double size = 0;
+	for (int i = 0; i < 3; ++i) {
+		size = max(size, bounds.max[i] - bounds.min[i]);
+	}
+	const double eps = tolerance * max(size, 1.0);
+
+	// faces, planes and triangles of both solids
+	SolidData solids[2];
+	vector<FaceData> faces;
+	uint32_t first_b = 0;
+	for (int side = 0; side < 2; ++side) {
+		SolidData& data = solids[side];
+		data.solid = side == 0 ? a : b;
+		if (side == 1) {
+			first_b = static_cast<uint32_t>(faces.size());
+		}
+		vector<TriangleMesh> meshes;
+		tessellate(data.solid, meshes, threads);
+		double volume = 0;
+		for (Face* face : data.solid->faces) {
+			if (face->outer_loop->first_edge == nullptr) {
+				continue; // a lone vertex (MVFS)
+			}
+			uint32_t index = static_cast<uint32_t>(faces.size());
+			faces.emplace_back();
+			FaceData& f = faces.back();
+			f.face = face;
+			f.side = side;
+			f.plane = face->plane();
+			const double* n = f.plane.normal;
+			if (n[0] == 0 && n[1] == 0 && n[2] == 0) {
+				error = "a face encloses no area";
+				return nullptr;
+			}
+			f.w = fabs(n[0]) > fabs(n[1]) ? (fabs(n[0]) > fabs(n[2]) ? 0 : 2) : (fabs(n[1]) > fabs(n[2]) ? 1 : 2);
+			f.u = (f.w + 1) % 3;
+			f.v = (f.w + 2) % 3;
+			if (n[f.w] < 0) {
+				swap(f.u, f.v);
+			}
+			for (size_t l = 0; l <= face->inner_loops.size(); ++l) {
+				const Loop* loop = l == 0 ? face->outer_loop : face->inner_loops[l - 1];
+				f.loops.emplace_back();
+				HalfEdge* he = loop->first_edge;
+				do {
+					f.loops.back().push_back(he->start);
+					f.box.add(*he->start->point);
+					he = he->next;
+				} while (he != loop->first_edge);
+			}
+			for (int i = 0; i < 3; ++i) {
+				f.box.min[i] -= eps;
+				f.box.max[i] += eps;
+			}
+			const TriangleMesh& mesh = meshes[face->index];
+			for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+				const double* p[3];
+				Box box;
+				for (int k = 0; k < 3; ++k) {
+					p[k] = &mesh.positions[3 * mesh.indices[i + k]];
+					data.triangles.insert(data.triangles.end(), p[k], p[k] + 3);
+					box.add(Point(p[k][0], p[k][1], p[k][2]));
+				}
+				volume += p[0][0] * (p[1][1] * p[2][2] - p[1][2] * p[2][1]) +
+				          p[0][1] * (p[1][2] * p[2][0] - p[1][0] * p[2][2]) +
+				          p[0][2] * (p[1][0] * p[2][1] - p[1][1] * p[2][0]);
+				data.triangle_face.push_back(index);
+				data.boxes.push_back(box);
+			}
+		}
+		if (faces.size() == (side == 0 ? 0 : first_b)) {
+			error = "a solid has no faces";
+			return nullptr;
+		}
+		data.sign = volume < 0 ? -1 : 1;
+		data.tree.build(data.boxes, threads);
+	}
+	for (FaceData& f : faces) {
+		for (int i = 0; i < 3; ++i) {
+			f.outward[i] = solids[f.side].sign * f.plane.normal[i];
+		}
+	}
+
+	// broad phase: the faces of b whose boxes meet each face of a
+	BoxTree tree;
+	{
+		vector<Box> boxes;
+		for (uint32_t i = first_b; i < faces.size(); ++i) {
+			boxes.push_back(faces[i].box);
+		}
+		tree.build(boxes, threads);
+	}
+	vector<vector<uint32_t>> partners(first_b);
+	parallelFor(first_b, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			tree.overlapping(faces[i].box, [&](uint32_t j) {
+				if (faces[i].box.intersects(faces[first_b + j].box)) {
+					partners[i].push_back(first_b + j);
+				}
+			});
+			sort(partners[i].begin(), partners[i].end());
+		}
+	}, threads);
+	vector<pair<uint32_t, uint32_t>> pairs;
+	for (uint32_t i = 0; i < first_b; ++i) {
+		for (uint32_t j : partners[i]) {
+			pairs.push_back({ i, j });
+			faces[i].candidate = faces[j].candidate = true;
+		}
+	}
+	candidate_pairs = pairs.size();
+
+	// narrow phase: the cuts each pair makes in its two faces
+	struct PairCuts {
+		bool coplanar = false;
+		vector<pair<Point, Point>> f, g; // g is f unless coplanar
+	};
+	vector<PairCuts> cuts(pairs.size());
+	parallelFor(pairs.size(), [&](size_t begin, size_t end) {
+		for (size_t k = begin; k < end; ++k) {
+			const FaceData& f = faces[pairs[k].first];
+			const FaceData& g = faces[pairs[k].second];
+			if (onPlane(f, g.plane, eps) && onPlane(g, f.plane, eps)) {
+				cuts[k].coplanar = true;
+				clipEdges(f, g, eps, cuts[k].f);
+				clipEdges(g, f, eps, cuts[k].g);
+			} else {
+				intersectFaces(f, g, eps, cuts[k].f);
+			}
+		}
+	}, threads);
+	for (size_t k = 0; k < pairs.size(); ++k) {
+		FaceData& f = faces[pairs[k].first];
+		FaceData& g = faces[pairs[k].second];
+		f.cuts.insert(f.cuts.end(), cuts[k].f.begin(), cuts[k].f.end());
+		const vector<pair<Point, Point>>& g_cuts = cuts[k].coplanar ? cuts[k].g : cuts[k].f;
+		g.cuts.insert(g.cuts.end(), g_cuts.begin(), g_cuts.end());
+		if (cuts[k].coplanar) {
+			f.coplanar.push_back(pairs[k].second);
+			g.coplanar.push_back(pairs[k].first);
+		}
+	}
+	cuts.clear();
+	cuts.shrink_to_fit();
+
+	// cut faces into regions, place each region (and each face left whole)
+	// and collect what is kept
+	vector<uint32_t> cut;
+	for (uint32_t i = 0; i < faces.size(); ++i) {
+		if (!faces[i].cuts.empty()) {
+			cut.push_back(i);
+		}
+	}
+	cut_faces = cut.size();
+	vector<char> failed(faces.size(), 0);
+	auto orient = [&](FaceData& f, vector<vector<Point>>& loops) {
+		bool flip = (solids[f.side].sign < 0) != (operation == Operation::subtract && f.side == 1);
+		if (flip) {
+			for (vector<Point>& loop : loops) {
+				reverse(loop.begin(), loop.end());
+			}
+		}
+		f.pieces.push_back(move(loops));
+	};
+	auto wholeFace = [&](FaceData& f) {
+		vector<vector<Point>> loops;
+		for (const vector<Vertex*>& loop : f.loops) {
+			loops.emplace_back();
+			for (Vertex* vertex : loop) {
+				loops.back().push_back(*vertex->point);
+			}
+		}
+		orient(f, loops);
+	};
+	parallelFor(cut.size(), [&](size_t begin, size_t end) {
+		Arrangement graph;
+		vector<vector<uint32_t>> cycles;
+		for (size_t k = begin; k < end; ++k) {
+			FaceData& f = faces[cut[k]];
+			arrange(f, eps, graph);
+			if (!traceCycles(graph, graph.alive, cycles)) {
+				failed[cut[k]] = 1;
+				continue;
+			}
+			vector<vector<uint32_t>> regions = groupCycles(graph, cycles);
+			graph.region.assign(graph.from.size(), -1);
+			vector<char> kept(regions.size());
+			for (size_t r = 0; r < regions.size(); ++r) {
+				vector<vector<P2>> loops;
+				for (uint32_t c : regions[r]) {
+					loops.push_back(cyclePoints(graph, cycles[c]));
+					for (uint32_t h : cycles[c]) {
+						graph.region[h] = static_cast<int32_t>(r);
+					}
+				}
+				Point p = f.lift(interiorPoint(loops));
+				kept[r] = keep(operation, f.side, locate(p, f, faces, solids[1 - f.side], eps));
+			}
+			// the outline of the kept regions: pieces of one face that are both
+			// kept stay one face
+			vector<char> outline(graph.from.size(), 0);
+			for (size_t h = 0; h < graph.from.size(); ++h) {
+				int32_t left = graph.region[h];
+				int32_t right = graph.twin[h] < 0 ? -1 : graph.region[graph.twin[h]];
+				outline[h] = graph.alive[h] && left >= 0 && kept[left] && !(right >= 0 && kept[right]);
+			}
+			if (!traceCycles(graph, outline, cycles)) {
+				failed[cut[k]] = 1;
+				continue;
+			}
+			for (const vector<uint32_t>& polygon : groupCycles(graph, cycles)) {
+				vector<vector<Point>> loops;
+				for (uint32_t c : polygon) {
+					loops.emplace_back();
+					for (uint32_t h : cycles[c]) {
+						loops.back().push_back(graph.points[graph.from[h]]);
+					}
+				}
+				orient(f, loops);
+			}
+		}
+	}, threads);
+	if (find(failed.begin(), failed.end(), 1) != failed.end()) {
+		error = "could not cut a face along the intersection";
+		return nullptr;
+	}
+
+	// Whole faces: the ones near the other solid are placed one by one, the
+	// others (no face of the other solid near them, so no edge between them
+	// lies on it) once per connected group.
+	vector<uint32_t> parent(faces.size());
+	iota(parent.begin(), parent.end(), 0);
+	for (int side = 0; side < 2; ++side) {
+		uint32_t base = side == 0 ? 0 : first_b;
+		vector<uint32_t> slot(solids[side].solid->faces.size(), ~0u);
+		for (uint32_t i = base; i < (side == 0 ? first_b : faces.size()); ++i) {
+			slot[faces[i].face->index] = i;
+		}
+		for (Edge* edge : solids[side].solid->edges) {
+			uint32_t f = slot[edge->he1->loop->face->index];
+			uint32_t g = slot[edge->he2->loop->face->index];
+			if (f != ~0u && g != ~0u && !faces[f].candidate && !faces[g].candidate) {
+				parent[findRoot(parent, f)] = findRoot(parent, g);
+			}
+		}
+	}
+	vector<uint32_t> samples;
+	for (uint32_t i = 0; i < faces.size(); ++i) {
+		if (faces[i].cuts.empty() && findRoot(parent, i) == i) {
+			samples.push_back(i);
+		}
+	}
+	vector<char> kept(faces.size(), 0);
+	parallelFor(samples.size(), [&](size_t begin, size_t end) {
+		for (size_t k = begin; k < end; ++k) {
+			const FaceData& f = faces[samples[k]];
+			Point p = f.lift(interiorPoint(f.projectLoops(f)));
+			kept[samples[k]] = keep(operation, f.side, locate(p, f, faces, solids[1 - f.side], eps));
+		}
+	}, threads);
+	for (uint32_t i = 0; i < faces.size(); ++i) {
+		if (faces[i].cuts.empty() && kept[findRoot(parent, i)]) {
+			wholeFace(faces[i]);
+		}
+	}
+
+	// stitch: weld the corners, split edges at corners that lie on them
+	// (where one face was cut at a point its neighbour was not), and pair
+	// the half-edges
+	Welder welder(eps);
+	vector<vector<vector<uint32_t>>> polygons;
+	for (FaceData& f : faces) {
+		for (const vector<vector<Point>>& piece : f.pieces) {
+			vector<vector<uint32_t>> polygon;
+			for (const vector<Point>& loop : piece) {
+				vector<uint32_t> ids;
+				for (const Point& p : loop) {
+					uint32_t id = welder.add(p);
+					if (ids.empty() || ids.back() != id) {
+						ids.push_back(id);
+					}
+				}
+				while (ids.size() > 1 && ids.front() == ids.back()) {
+					ids.pop_back();
+				}
+				if (ids.size() >= 3) {
+					polygon.push_back(move(ids));
+				} else if (polygon.empty()) {
+					break; // the outer loop collapsed: so did its holes
+				}
+			}
+			if (!polygon.empty()) {
+				polygons.push_back(move(polygon));
+			}
+		}
+		f.pieces.clear();
+	}
+	if (polygons.empty()) {
+		error = "the result is empty";
+		return nullptr;
+	}
+	unordered_map<uint64_t, uint32_t> half_edges;
+	auto pairUp = [&]() {
+		half_edges.clear();
+		bool manifold = true;
+		uint32_t h = 0;
+		for (const vector<vector<uint32_t>>& polygon : polygons) {
+			for (const vector<uint32_t>& loop : polygon) {
+				for (size_t i = 0; i < loop.size(); ++i) {
+					manifold &= half_edges.emplace(edgeKey(loop[i], loop[(i + 1) % loop.size()]), h++).second;
+				}
+			}
+		}
+		return manifold;
+	};
+	for (int pass = 0;; ++pass) {
+		if (!pairUp()) {
+			error = "the result is not a manifold";
+			return nullptr;
+		}
+		vector<uint32_t> loose; // corners of half-edges without a partner
+		for (const auto& [key, h] : half_edges) {
+			if (!half_edges.count(key << 32 | key >> 32)) {
+				loose.push_back(static_cast<uint32_t>(key >> 32));
+				loose.push_back(static_cast<uint32_t>(key));
+			}
+		}
+		if (loose.empty()) {
+			break;
+		}
+		if (pass == 2) {
+			error = "the pieces of the result do not close up";
+			return nullptr;
+		}
+		sort(loose.begin(), loose.end());
+		loose.erase(unique(loose.begin(), loose.end()), loose.end());
+		const vector<Point>& points = welder.points;
+		for (vector<vector<uint32_t>>& polygon : polygons) {
+			for (vector<uint32_t>& loop : polygon) {
+				vector<uint32_t> split;
+				for (size_t i = 0; i < loop.size(); ++i) {
+					uint32_t p = loop[i], q = loop[(i + 1) % loop.size()];
+					split.push_back(p);
+					if (half_edges.count(edgeKey(q, p))) {
+						continue;
+					}
+					vector<pair<double, uint32_t>> on_edge;
+					double length2 = distance2(points[p], points[q]);
+					for (uint32_t r : loose) {
+						const Point& x = points[r];
+						double s = ((x.x - points[p].x) * (points[q].x - points[p].x) +
+						            (x.y - points[p].y) * (points[q].y - points[p].y) +
+						            (x.z - points[p].z) * (points[q].z - points[p].z)) / length2;
+						if (r != p && r != q && s > 0 && s < 1 && distance2(x, lerp(points[p], points[q], s)) <= eps * eps) {
+							on_edge.push_back({ s, r });
+						}
+					}
+					sort(on_edge.begin(), on_edge.end());
+					for (const pair<double, uint32_t>& r : on_edge) {
+						split.push_back(r.second);
+					}
+				}
+				loop = move(split);
+			}
+		}
+	}
+
+	// build the solid the way SolidView::expand does
+	Solid* solid = new Solid(&brep.ids);
+	vector<Vertex*> vertices(welder.points.size(), nullptr);
+	vector<HalfEdge*> made(half_edges.size(), nullptr);
+	uint32_t h = 0;
+	for (const vector<vector<uint32_t>>& polygon : polygons) {
+		Face* face = nullptr;
+		for (const vector<uint32_t>& ids : polygon) {
+			Loop* loop = solid->loop_pool.create(solid);
+			HalfEdge* previous = nullptr;
+			for (size_t i = 0; i < ids.size(); ++i) {
+				for (uint32_t id : { ids[i], ids[(i + 1) % ids.size()] }) {
+					if (vertices[id] == nullptr) {
+						const Point& p = welder.points[id];
+						vertices[id] = solid->vertex_pool.create(p.x, p.y, p.z, solid);
+					}
+				}
+				HalfEdge* he = made[h++] =
+					solid->half_edge_pool.create(vertices[ids[i]], vertices[ids[(i + 1) % ids.size()]]);
+				he->loop = loop;
+				vertices[ids[i]]->he = he;
+				auto partner = half_edges.find(edgeKey(ids[(i + 1) % ids.size()], ids[i]));
+				if (made[partner->second]) {
+					solid->edge_pool.create(made[partner->second], he, solid);
+				}
+				if (previous) {
+					previous->next = he;
+					he->pre = previous;
+				} else {
+					loop->first_edge = he;
+				}
+				previous = he;
+			}
+			previous->next = loop->first_edge;
+			loop->first_edge->pre = previous;
+			if (face == nullptr) {
+				face = solid->face_pool.create(loop, solid);
+			} else {
+				loop->face = face;
+				face->inner_loops.push_back(loop);
+			}
+		}
+	}
+	// the pairing above holds by construction; what is left to fail is the
+	// Euler-Poincare formula, at vertices where the solids only touch
+	if (validate(solid)) {
+		delete solid;
+		error = "the result is not a manifold";
+		return nullptr;
+	}
+	brep.insert(solid);
+	brep.remove(a);
+	brep.remove(b);
+	return solid;
+}
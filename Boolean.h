@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+
+#include "Brep.h"
+
+// Boolean operations between two solids of a Brep. A BoxTree over the faces'
+// boxes finds the faces of b that can meet each face of a; those pairs are
+// intersected on several threads, and every face is cut along the segments
+// it got into pieces, again on several threads. A piece is kept or dropped
+// by where it lies relative to the other solid: in or on a face of it
+// (faces lying on each other), or else inside or outside by a ray cast
+// against its triangles. The kept pieces are stitched into a new solid that
+// replaces a and b through Brep::insert and Brep::remove, so with the
+// journal on one endStep makes the whole operation one undoable step.
+// Faces may have holes and either solid may be inside out; the faces of the
+// result point outwards.
+struct Boolean {
+	enum class Operation {
+		unite,
+		subtract, // a minus b
+		intersect,
+	};
+
+	// Returns the new solid, or nullptr with error set and a and b left as
+	// they were when the result is empty or its pieces do not close up into
+	// a manifold (solids touching only along an edge or at a vertex).
+	Solid* apply(Brep& brep, Solid* a, Solid* b, Operation operation);
+
+	unsigned threads = 0; // 0 = one per core
+	double tolerance = 1e-9; // points closer than this times the size of a and b coincide
+	const char* error = nullptr; // static text
+
+	// of the last apply
+	size_t candidate_pairs = 0; // face pairs whose boxes meet
+	size_t cut_faces = 0; // faces split into pieces
+};
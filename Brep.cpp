@@ -0,0 +1,994 @@
+#include "Brep.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "Parallel.h"
+#include "Validator.h"
+
+// Built with CADBREP_VALIDATE, every Euler operator checks the whole solid
+// it changed before returning (quadratic overall, so for debugging only).
+#ifdef CADBREP_VALIDATE
+static void checkTopology(const Solid* solid, const char* operation) {
+	if (TopologyError error = validate(solid)) {
+		fprintf(stderr, "%s broke solid %d: %s (id %d)\n", operation, solid->SolidId, error.problem, error.id);
+		abort();
+	}
+}
+#define POSTCONDITION(solid) checkTopology(solid, __func__)
+#else
+#define POSTCONDITION(solid) ((void)0)
+#endif
+
+Transform Transform::translation(double dx, double dy, double dz) {
+	Transform transform;
+	transform.offset[0] = dx;
+	transform.offset[1] = dy;
+	transform.offset[2] = dz;
+	return transform;
+}
+
+// Rodrigues' formula about the unit axis u, then shifted so that origin
+// stays put.
+Transform Transform::rotation(const Point& origin, const Point& axis, double angle) {
+	double length = sqrt(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+	double u[3] = { axis.x / length, axis.y / length, axis.z / length };
+	double c = cos(angle), s = sin(angle);
+	Transform transform;
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			transform.linear[i][j] = (i == j ? c : 0) + (1 - c) * u[i] * u[j];
+		}
+	}
+	transform.linear[0][1] -= s * u[2];
+	transform.linear[0][2] += s * u[1];
+	transform.linear[1][0] += s * u[2];
+	transform.linear[1][2] -= s * u[0];
+	transform.linear[2][0] -= s * u[1];
+	transform.linear[2][1] += s * u[0];
+	Point moved = transform.apply(origin);
+	transform.offset[0] = origin.x - moved.x;
+	transform.offset[1] = origin.y - moved.y;
+	transform.offset[2] = origin.z - moved.z;
+	return transform;
+}
+
+void Solid::updateBox() const {
+	bounds = Box();
+	for (const Vertex* vertex : vertices) {
+		bounds.add(*vertex->point);
+	}
+	box_stale = false;
+}
+
+void Face::updateBox() const {
+	bounds = Box();
+	auto add = [&](const Loop* loop) {
+		if (const HalfEdge* he = loop->first_edge) {
+			do {
+				bounds.add(*he->start->point);
+				he = he->next;
+			} while (he != loop->first_edge);
+		}
+	};
+	add(outer_loop);
+	for (const Loop* loop : inner_loops) {
+		add(loop);
+	}
+	box_revision = revision;
+}
+
+void Face::updatePlane() const {
+	equation = Plane();
+	const HalfEdge* he = outer_loop->first_edge;
+	if (he == nullptr) {
+		plane_revision = revision;
+		return;
+	}
+	double* normal = equation.normal;
+	double centroid[3] = { 0, 0, 0 };
+	size_t count = 0;
+	do {
+		const Point *a = he->start->point, *b = he->end->point;
+		normal[0] += (a->y - b->y) * (a->z + b->z);
+		normal[1] += (a->z - b->z) * (a->x + b->x);
+		normal[2] += (a->x - b->x) * (a->y + b->y);
+		centroid[0] += a->x;
+		centroid[1] += a->y;
+		centroid[2] += a->z;
+		++count;
+		he = he->next;
+	} while (he != outer_loop->first_edge);
+	double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+	if (length > 0) {
+		for (int i = 0; i < 3; ++i) {
+			normal[i] /= length;
+			equation.d -= normal[i] * centroid[i] / count;
+		}
+	}
+	plane_revision = revision;
+}
+
+Brep::~Brep() {
+	stopJournal();
+	for (Solid* solid : solids) {
+		delete solid;
+	}
+}
+
+Vertex* Brep::MVFS(double x, double y, double z) {
+	Solid* solid = new Solid(&ids);
+	Vertex* vertex = solid->vertex_pool.create(x, y, z, solid);
+	Loop* loop = solid->loop_pool.create(solid);
+	solid->face_pool.create(loop, solid);
+	solids.push_back(solid);
+	record({ Operation::Kind::MVFS, solid });
+	POSTCONDITION(solid);
+	return vertex;
+}
+
+void Brep::remove(Solid* solid) {
+	solids.erase(std::find(solids.begin(), solids.end(), solid));
+	if (!record({ Operation::Kind::KVFS, solid })) {
+		delete solid;
+	}
+}
+
+void Brep::insert(Solid* solid) {
+	solids.push_back(solid);
+	record({ Operation::Kind::MVFS, solid });
+}
+
+void Brep::merge(Solid* solid, Solid* other) {
+	if (journal.recording) {
+		stopJournal(); // its records of other would point into a deleted solid
+		startJournal();
+	}
+	for (Vertex* vertex : other->vertices) {
+		vertex->index = solid->vertices.size();
+		solid->vertices.push_back(vertex);
+	}
+	for (Edge* edge : other->edges) {
+		edge->index = solid->edges.size();
+		solid->edges.push_back(edge);
+	}
+	for (Face* face : other->faces) {
+		face->index = solid->faces.size();
+		face->solid = solid;
+		solid->faces.push_back(face);
+	}
+	solid->point_pool.splice(other->point_pool);
+	solid->vertex_pool.splice(other->vertex_pool);
+	solid->half_edge_pool.splice(other->half_edge_pool);
+	solid->edge_pool.splice(other->edge_pool);
+	solid->loop_pool.splice(other->loop_pool);
+	solid->face_pool.splice(other->face_pool);
+	solid->add(other->box());
+	++solid->revision;
+	solids.erase(std::find(solids.begin(), solids.end(), other));
+	delete other;
+}
+
+void Brep::adopt(Brep& other) {
+	other.stopJournal(); // its history does not carry over
+	for (Solid* solid : other.solids) {
+		solid->SolidId += ids.solid;
+		solid->ids = &ids;
+		for (Vertex* vertex : solid->vertices) {
+			vertex->VertexId += ids.vertex;
+		}
+		for (Edge* edge : solid->edges) {
+			edge->EdgeId += ids.edge;
+		}
+		for (Face* face : solid->faces) {
+			face->faceId += ids.face;
+			face->outer_loop->loopId += ids.loop;
+			for (Loop* loop : face->inner_loops) {
+				loop->loopId += ids.loop;
+			}
+		}
+		solids.push_back(solid);
+	}
+	other.solids.clear();
+	ids.solid += other.ids.solid;
+	ids.vertex += other.ids.vertex;
+	ids.edge += other.ids.edge;
+	ids.loop += other.ids.loop;
+	ids.face += other.ids.face;
+	other.ids = IdAllocator();
+}
+
+Vertex* Brep::MEV(Loop* loop, Vertex* v1, double x, double y, double z) {
+	Solid* solid = loop->face->solid;
+	Vertex* v2 = solid->vertex_pool.create(x, y, z, solid);
+	MEV(loop, v1, v2);
+	return v2;
+}
+
+Vertex* Brep::MEV(Loop* loop, Vertex* v1, Vertex* v2) {
+	if (loop->first_edge == nullptr) {
+		Solid* solid = loop->face->solid;
+		HalfEdge* he1 = solid->half_edge_pool.create(v1, v2);
+		HalfEdge* he2 = solid->half_edge_pool.create(v2, v1);
+		solid->edge_pool.create(he1, he2, solid);
+		he1->loop = he2->loop = loop;
+		he1->next = he1->pre = he2;
+		he2->next = he2->pre = he1;
+		linkEdgeVertex(he1);
+		record({ Operation::Kind::MEV, solid, he1 });
+		POSTCONDITION(solid);
+	} else {
+		MEV(findHalfEdge(loop, v1)->pre, v2);
+	}
+	return v2;
+}
+
+HalfEdge* Brep::MEV(HalfEdge* he, double x, double y, double z) {
+	Solid* solid = he->loop->face->solid;
+	return MEV(he, solid->vertex_pool.create(x, y, z, solid));
+}
+
+HalfEdge* Brep::MEV(HalfEdge* he, Vertex* v2) {
+	Loop* loop = he->loop;
+	Solid* solid = loop->face->solid;
+	Vertex* v1 = he->end;
+	HalfEdge* he1 = solid->half_edge_pool.create(v1, v2);
+	HalfEdge* he2 = solid->half_edge_pool.create(v2, v1);
+	solid->edge_pool.create(he1, he2, solid);
+	he1->loop = he2->loop = loop;
+	he1->pre = he;
+	he1->next = he2;
+	he2->pre = he1;
+	he2->next = he->next;
+	linkEdgeVertex(he1);
+	record({ Operation::Kind::MEV, solid, he1 });
+	POSTCONDITION(solid);
+	return he1;
+}
+
+void Brep::KEV(HalfEdge* he) {
+	Solid* solid = he->loop->face->solid;
+	unlinkEdgeVertex(he);
+	unlist(solid->edges, he->edge);
+	unlist(solid->vertices, he->end);
+	solid->vertexRemoved();
+	if (!record({ Operation::Kind::KEV, solid, he })) {
+		destroyVertex(solid, he->end);
+		destroyEdge(solid, he->edge);
+	}
+	POSTCONDITION(solid);
+}
+
+// he1 already points at its place: he1->pre and he2->next are the
+// neighbours it goes between (he1 and he2 themselves when the loop is
+// empty).
+void Brep::linkEdgeVertex(HalfEdge* he1) {
+	HalfEdge* he2 = he1->partner;
+	Loop* loop = he1->loop;
+	link(he1->pre, he1);
+	link(he2, he2->next);
+	if (loop->first_edge == nullptr) {
+		loop->first_edge = he1;
+	}
+	if (he1->start->he == nullptr) {
+		he1->start->he = he1;
+	}
+	he1->end->he = he2;
+	// a dangling edge: no area, so the plane holds
+	Box added(*he1->start->point);
+	added.add(*he1->end->point);
+	touch(loop->face);
+	grow(loop->face, added);
+	keepPlane(loop->face);
+}
+
+void Brep::unlinkEdgeVertex(HalfEdge* he1) {
+	HalfEdge* he2 = he1->partner;
+	Loop* loop = he1->loop;
+	if (he2->next == he1) {
+		// the only edge of the loop
+		loop->first_edge = nullptr;
+		he1->start->he = nullptr;
+	} else {
+		HalfEdge* after = he2->next;
+		link(he1->pre, after);
+		if (he1->start->he == he1) {
+			he1->start->he = after;
+		}
+		if (loop->first_edge == he1 || loop->first_edge == he2) {
+			loop->first_edge = after;
+		}
+	}
+	touch(loop->face);
+	keepPlane(loop->face);
+}
+
+Face* Brep::MEF(HalfEdge* he1, HalfEdge* he2) {
+	Loop* loop = he1->loop;
+	Solid* solid = loop->face->solid;
+
+	HalfEdge* new_he1 = solid->half_edge_pool.create(he1->end, he2->end);
+	HalfEdge* new_he2 = solid->half_edge_pool.create(he2->end, he1->end);
+	solid->edge_pool.create(new_he1, new_he2, solid);
+
+	new_he1->next = he2->next;
+	new_he1->pre = he1;
+	new_he2->next = he1->next;
+	new_he2->pre = he2;
+
+	Loop* new_loop = solid->loop_pool.create(solid);
+	Face* new_face = solid->face_pool.create(new_loop, solid);
+	new_he1->loop = new_loop;
+	new_he2->loop = loop;
+	linkEdgeFace(new_he1);
+	record({ Operation::Kind::MEF, solid, new_he1 });
+	POSTCONDITION(solid);
+	return new_face;
+}
+
+Face* Brep::KEF(HalfEdge* he) {
+	Loop* loop = he->loop;
+	Face* face = loop->face;
+	Solid* solid = face->solid;
+	Face* other_face = he->partner->loop->face;
+	unlinkEdgeFace(he);
+	unlist(solid->edges, he->edge);
+	unlist(solid->faces, face);
+	if (!record({ Operation::Kind::KEF, solid, he })) {
+		destroyEdge(solid, he->edge);
+		solid->loop_pool.destroy(loop);
+		solid->face_pool.destroy(face);
+	}
+	POSTCONDITION(solid);
+	return other_face;
+}
+
+// he's loop is the outer loop of its (new) face; he and its partner point at
+// their neighbours on either side.
+void Brep::linkEdgeFace(HalfEdge* he) {
+	HalfEdge* partner = he->partner;
+	Loop* new_loop = he->loop;
+	Loop* loop = partner->loop;
+	Face* face = new_loop->face;
+	link(he->pre, he);
+	link(he, he->next);
+	link(partner->pre, partner);
+	link(partner, partner->next);
+	for (HalfEdge* other = he->next; other != he; other = other->next) {
+		other->loop = new_loop;
+	}
+	new_loop->first_edge = he;
+	loop->first_edge = partner;
+	if (!face->inner_loops.empty()) {
+		for (Loop* inner_loop : face->inner_loops) {
+			inner_loop->face = face;
+		}
+		vector<Loop*>& others = loop->face->inner_loops;
+		others.erase(remove_if(others.begin(), others.end(), [&](Loop* other) { return other->face == face; }),
+		             others.end());
+	}
+	touch(loop->face);
+	touch(face);
+}
+
+void Brep::unlinkEdgeFace(HalfEdge* he) {
+	HalfEdge* partner = he->partner;
+	Loop* loop = partner->loop;
+	Face* face = he->loop->face;
+	Face* other_face = loop->face;
+	// only worth a walk over the dying face when the survivor's box is current
+	Box removed = other_face->box_revision == other_face->revision ? face->box() : Box();
+	for (HalfEdge* other = he->next; other != he; other = other->next) {
+		other->loop = loop;
+	}
+	if (he->start->he == he) {
+		he->start->he = partner->next;
+	}
+	if (partner->start->he == partner) {
+		partner->start->he = he->next;
+	}
+	if (loop->first_edge == partner) {
+		loop->first_edge = partner->next;
+	}
+	link(he->pre, partner->next);
+	link(partner->pre, he->next);
+	for (Loop* inner_loop : face->inner_loops) {
+		inner_loop->face = other_face;
+		other_face->inner_loops.push_back(inner_loop);
+	}
+	touch(other_face);
+	grow(other_face, removed);
+}
+
+Loop* Brep::KEMR(HalfEdge* he1) {
+	Face* face = he1->loop->face;
+	Solid* solid = face->solid;
+	Loop* new_loop = solid->loop_pool.create(face);
+	unlinkEdgeRing(he1, new_loop, false);
+	unlist(solid->edges, he1->edge);
+	if (!record({ Operation::Kind::KEMR, solid, he1, new_loop })) {
+		destroyEdge(solid, he1->edge);
+	}
+	POSTCONDITION(solid);
+	return new_loop;
+}
+
+HalfEdge* Brep::MEKR(HalfEdge* he1, HalfEdge* he2) {
+	Loop* loop = he1->loop;
+	Loop* ring = he2->loop;
+	Face* face = loop->face;
+	Solid* solid = face->solid;
+
+	HalfEdge* new_he1 = solid->half_edge_pool.create(he1->end, he2->end);
+	HalfEdge* new_he2 = solid->half_edge_pool.create(he2->end, he1->end);
+	solid->edge_pool.create(new_he1, new_he2, solid);
+	new_he1->pre = he1;
+	new_he1->next = he2->next;
+	new_he2->pre = he2;
+	new_he2->next = he1->next;
+	new_he1->loop = new_he2->loop = loop;
+	bool outer = ring == face->outer_loop;
+	linkEdgeRing(new_he2, ring);
+	if (!record({ Operation::Kind::MEKR, solid, new_he2, ring, nullptr, nullptr, outer })) {
+		solid->loop_pool.destroy(ring);
+	}
+	POSTCONDITION(solid);
+	return new_he1;
+}
+
+// The ring lies beyond he's partner: he->partner->next is on it.
+void Brep::linkEdgeRing(HalfEdge* he, Loop* ring) {
+	HalfEdge* partner = he->partner;
+	Loop* loop = he->loop;
+	Face* face = loop->face;
+	HalfEdge* other = ring->first_edge;
+	do {
+		other->loop = loop;
+		other = other->next;
+	} while (other != ring->first_edge);
+	link(he->pre, he);
+	link(he, he->next);
+	link(partner->pre, partner);
+	link(partner, partner->next);
+	if (he->start->he == nullptr) {
+		he->start->he = he;
+	}
+	if (partner->start->he == nullptr) {
+		partner->start->he = partner;
+	}
+
+	vector<Loop*>& inner_loops = face->inner_loops;
+	if (ring == face->outer_loop) {
+		face->outer_loop = loop;
+		inner_loops.erase(std::find(inner_loops.begin(), inner_loops.end(), loop));
+	} else {
+		inner_loops.erase(std::find(inner_loops.begin(), inner_loops.end(), ring));
+	}
+	touch(face);
+	grow(face, Box()); // same vertices
+}
+
+// Takes the part of the loop beyond he's partner out as ring, which becomes
+// the outer loop of the face when `outer` is set.
+void Brep::unlinkEdgeRing(HalfEdge* he1, Loop* ring, bool outer) {
+	HalfEdge* he2 = he1->partner;
+	Loop* loop = he1->loop;
+	Face* face = loop->face;
+	Vertex *v1 = he1->start, *v2 = he1->end;
+	if (v1->he == he1) {
+		v1->he = he2->next != he1 ? he2->next : nullptr;
+	}
+	if (v2->he == he2) {
+		v2->he = he1->next != he2 ? he1->next : nullptr;
+	}
+	link(he1->pre, he2->next);
+	link(he2->pre, he1->next);
+
+	loop->first_edge = he1->next;
+	ring->first_edge = he2->next;
+	HalfEdge* he = ring->first_edge;
+	do {
+		he->loop = ring;
+		he = he->next;
+	} while (he != ring->first_edge);
+	if (outer) {
+		face->outer_loop = ring;
+		face->inner_loops.push_back(loop);
+	} else {
+		face->inner_loops.push_back(ring);
+	}
+	touch(face);
+	grow(face, Box()); // same vertices
+}
+
+Solid* Brep::KFMRH(Face* outer_face, Face* inner_face) {
+	Solid* solid1 = outer_face->solid;
+	Solid* solid2 = inner_face->solid;
+	if (solid1 == solid2) {
+		unlinkFace(inner_face, outer_face);
+		unlist(solid1->faces, inner_face);
+		if (!record({ Operation::Kind::KFMRH, solid1, nullptr, nullptr, inner_face, outer_face })) {
+			solid1->face_pool.destroy(inner_face);
+		}
+	} else {
+		merge(solid1, solid2);
+		return KFMRH(outer_face, inner_face);
+	}
+	POSTCONDITION(solid1);
+	return solid1;
+}
+
+Face* Brep::MFKRH(Loop* inner_loop) {
+	Face* face = inner_loop->face;
+	Solid* solid = face->solid;
+	Face* new_face = solid->face_pool.create(inner_loop, solid);
+	linkFace(new_face, face);
+	record({ Operation::Kind::MFKRH, solid, nullptr, nullptr, new_face, face });
+	POSTCONDITION(solid);
+	return new_face;
+}
+
+void Brep::linkFace(Face* face, Face* host) {
+	face->outer_loop->face = face;
+	for (Loop* inner_loop : face->inner_loops) {
+		inner_loop->face = face;
+	}
+	vector<Loop*>& inner_loops = host->inner_loops;
+	inner_loops.erase(remove_if(inner_loops.begin(), inner_loops.end(), [&](Loop* loop) { return loop->face == face; }),
+	                  inner_loops.end());
+	touch(host);
+	keepPlane(host); // only inner loops left it
+	touch(face);
+}
+
+void Brep::unlinkFace(Face* face, Face* host) {
+	Box removed = host->box_revision == host->revision ? face->box() : Box();
+	host->inner_loops.push_back(face->outer_loop);
+	face->outer_loop->face = host;
+	for (Loop* inner_loop : face->inner_loops) {
+		inner_loop->face = host;
+		host->inner_loops.push_back(inner_loop);
+	}
+	touch(host);
+	grow(host, removed);
+	keepPlane(host);
+}
+
+Solid* Brep::sweep(Face* face, double dx, double dy, double dz) {
+	Solid* solid = face->solid;
+	Transform offset = Transform::translation(dx, dy, dz);
+	Face* enclosed_face = face->outer_loop->first_edge->partner->loop->face;
+	extrudeLoop(face->outer_loop->first_edge->partner, offset);
+	for (Loop* inner_loop : face->inner_loops) {
+		KFMRH(enclosed_face, extrudeLoop(inner_loop->first_edge->partner, offset)->loop->face);
+	}
+	POSTCONDITION(solid);
+	return solid;
+}
+
+// Each loop of the face is extruded step by step from the half-edge of its
+// image that matches the loop's first edge. A full turn stops one step
+// short; the last images then lie on face's own loops, so the enclosed face
+// is merged into face and every pair of loops is bridged by quads.
+Solid* Brep::revolve(Face* face, const Point& axis_point, const Point& axis_direction, double angle,
+                     int segments) {
+	const double full_turn = 2 * 3.14159265358979323846;
+	bool closed = fabs(angle) >= full_turn - 1e-9;
+	if (closed) {
+		angle = angle < 0 ? -full_turn : full_turn;
+	}
+	segments = max(segments, closed ? 2 : 1);
+	Transform step = Transform::rotation(axis_point, axis_direction, angle / segments);
+
+	vector<HalfEdge*> firsts{ face->outer_loop->first_edge };
+	for (Loop* inner_loop : face->inner_loops) {
+		firsts.push_back(inner_loop->first_edge);
+	}
+	vector<HalfEdge*> sides;
+	for (HalfEdge* first : firsts) {
+		sides.push_back(first->partner);
+	}
+	Face* enclosed_face = sides[0]->loop->face;
+	for (int k = 0; k < (closed ? segments - 1 : segments); ++k) {
+		for (size_t j = 0; j < sides.size(); ++j) {
+			sides[j] = extrudeLoop(sides[j], step);
+			if (k == 0 && j > 0) {
+				KFMRH(enclosed_face, sides[j]->loop->face);
+			}
+		}
+	}
+	if (closed) {
+		KFMRH(face, enclosed_face);
+		bridgeLoops(firsts[0], sides[0]);
+		for (size_t j = 1; j < sides.size(); ++j) {
+			MFKRH(bridgeLoops(firsts[j], sides[j]));
+		}
+	}
+	POSTCONDITION(face->solid);
+	return face->solid;
+}
+
+// Unless faces of the batch depend on each other, every face gets the block
+// of ids a sequential run would give it, so the solids can be swept in any
+// order on any thread: while a face is swept its solid takes ids from that
+// block instead of the Brep's counters.
+void Brep::sweep(const vector<Face*>& faces, const vector<Point>& offsets, unsigned threads) {
+	struct Task {
+		Solid* solid;
+		size_t index; // in faces
+		size_t edges; // in all loops of the face
+		IdAllocator first_ids;
+	};
+	vector<Task> tasks;
+	tasks.reserve(faces.size());
+	vector<Face*> changed; // on the other side of the swept loops
+	for (size_t i = 0; i < faces.size(); ++i) {
+		Face* face = faces[i];
+		size_t edges = 0;
+		for (size_t k = 0; k <= face->inner_loops.size(); ++k) {
+			const HalfEdge* first_edge = (k == 0 ? face->outer_loop : face->inner_loops[k - 1])->first_edge;
+			const HalfEdge* he = first_edge;
+			do {
+				++edges;
+				he = he->next;
+			} while (he != first_edge);
+			changed.push_back(first_edge->partner->loop->face);
+		}
+		tasks.push_back({ face->solid, i, edges, IdAllocator() });
+	}
+	vector<Face*> swept(faces);
+	sort(swept.begin(), swept.end());
+	bool independent = adjacent_find(swept.begin(), swept.end()) == swept.end();
+	for (size_t i = 0; independent && i < changed.size(); ++i) {
+		independent = !binary_search(swept.begin(), swept.end(), changed[i]);
+	}
+	if (!independent || journal.recording) {
+		// later faces depend on earlier sweeps, so neither the sizes nor the
+		// ids can be worked out in advance; a journal needs one order of
+		// operations as well
+		for (size_t i = 0; i < faces.size(); ++i) {
+			const Point& offset = offsets.size() == 1 ? offsets[0] : offsets[i];
+			sweep(faces[i], offset.x, offset.y, offset.z);
+		}
+		return;
+	}
+	for (Task& task : tasks) {
+		int n = static_cast<int>(task.edges);
+		task.first_ids = ids;
+		ids.vertex += n;
+		ids.edge += 2 * n;
+		ids.loop += n;
+		ids.face += n;
+	}
+
+	// runs of tasks on the same solid, each in batch order
+	stable_sort(tasks.begin(), tasks.end(), [](const Task& a, const Task& b) { return a.solid < b.solid; });
+	vector<size_t> group_start;
+	for (size_t i = 0; i < tasks.size(); ++i) {
+		if (i == 0 || tasks[i].solid != tasks[i - 1].solid) {
+			group_start.push_back(i);
+		}
+	}
+	group_start.push_back(tasks.size());
+	auto sweepGroup = [&](size_t first, size_t last) {
+		Solid* solid = tasks[first].solid;
+		size_t edges = 0;
+		for (size_t i = first; i < last; ++i) {
+			edges += tasks[i].edges;
+		}
+		solid->point_pool.reserve(edges);
+		solid->vertex_pool.reserve(edges);
+		solid->half_edge_pool.reserve(4 * edges);
+		solid->edge_pool.reserve(2 * edges);
+		solid->loop_pool.reserve(edges);
+		solid->face_pool.reserve(edges);
+		solid->vertices.reserve(solid->vertices.size() + edges);
+		solid->edges.reserve(solid->edges.size() + 2 * edges);
+		solid->faces.reserve(solid->faces.size() + edges);
+		for (size_t i = first; i < last; ++i) {
+			const Point& offset = offsets.size() == 1 ? offsets[0] : offsets[tasks[i].index];
+			IdAllocator task_ids = tasks[i].first_ids;
+			solid->ids = &task_ids;
+			sweep(faces[tasks[i].index], offset.x, offset.y, offset.z);
+		}
+		solid->ids = &ids;
+	};
+	parallelFor(group_start.size() - 1, [&](size_t first, size_t last) {
+		for (size_t g = first; g < last; ++g) {
+			sweepGroup(group_start[g], group_start[g + 1]);
+		}
+	}, threads);
+}
+
+// Same result as MEV at every vertex followed by MEF between neighbouring
+// struts, entities created in the same order (so ids match), but the
+// half-edges are linked in place instead of being spliced into the loop one
+// operator at a time.
+//
+// With the loop running p_0 = first_side, p_(n-1), ..., p_1, p_i: s_(i+1)
+// -> s_i, and t_i the image of s_i, the lateral face of p_i is t_i ->
+// t_(i+1) -> s_(i+1) -> s_i -> t_i and the loop becomes the ring of top
+// edges t_(i+1) -> t_i.
+HalfEdge* Brep::extrudeLoop(HalfEdge* first_side, const Transform& transform) {
+	Loop* loop = first_side->loop;
+	Solid* solid = loop->face->solid;
+
+	// strut s_i -> t_i hung off the end of p_i
+	auto makeStrut = [&](HalfEdge* side) {
+		Vertex* bottom = side->end;
+		Point image = transform.apply(*bottom->point);
+		Vertex* top = solid->vertex_pool.create(image.x, image.y, image.z, solid);
+		HalfEdge* up = solid->half_edge_pool.create(bottom, top);
+		HalfEdge* down = solid->half_edge_pool.create(top, bottom);
+		solid->edge_pool.create(up, down, solid);
+		top->he = down;
+		record({ Operation::Kind::MEV, solid, up });
+		return up;
+	};
+	// lateral face over p_i between struts i and i + 1; returns the top
+	// half-edge left in the loop
+	auto makeFace = [&](HalfEdge* side, HalfEdge* up, HalfEdge* next_up) {
+		HalfEdge* down = next_up->partner;
+		HalfEdge* top = solid->half_edge_pool.create(up->end, next_up->end);
+		HalfEdge* top_back = solid->half_edge_pool.create(next_up->end, up->end);
+		solid->edge_pool.create(top, top_back, solid);
+		Loop* lateral = solid->loop_pool.create(solid);
+		solid->face_pool.create(lateral, solid);
+		record({ Operation::Kind::MEF, solid, top });
+		lateral->first_edge = top;
+		link(top, down);
+		link(down, side);
+		link(side, up);
+		link(up, top);
+		top->loop = down->loop = side->loop = up->loop = lateral;
+		top_back->loop = loop;
+		return top_back;
+	};
+
+	HalfEdge* first_up = makeStrut(first_side);
+	HalfEdge* next_up = first_up;
+	HalfEdge* first_top = nullptr;
+	HalfEdge* last_top = nullptr;
+	HalfEdge* side = first_side->next;
+	for (;;) {
+		HalfEdge* following = side->next; // before side is linked into its lateral face
+		HalfEdge* up = side == first_side ? first_up : makeStrut(side);
+		HalfEdge* top = makeFace(side, up, next_up);
+		if (last_top) {
+			link(last_top, top);
+		} else {
+			first_top = top;
+		}
+		last_top = top;
+		next_up = up;
+		if (side == first_side) {
+			break;
+		}
+		side = following;
+	}
+	link(last_top, first_top);
+	loop->first_edge = last_top;
+	Face* face = loop->face;
+	bool plane_current = face->plane_revision == face->revision;
+	touch(face);
+	if (plane_current) {
+		if (loop == face->outer_loop) {
+			face->equation = transform.apply(face->equation);
+		}
+		face->plane_revision = face->revision;
+	}
+	return last_top;
+}
+
+// MEKR makes the first bridge, at first->start, and every MEF after it cuts
+// off the quad of one edge of first's loop.
+Loop* Brep::bridgeLoops(HalfEdge* first, HalfEdge* other_first) {
+	HalfEdge* last = first->pre;
+	MEKR(last, other_first);
+	HalfEdge* other = other_first;
+	for (HalfEdge* he = first; he != last;) {
+		HalfEdge* next = he->next;
+		other = other->pre;
+		MEF(he, other);
+		he = next;
+	}
+	return last->loop;
+}
+
+HalfEdge* Brep::findHalfEdge(Loop* loop, Vertex* v, Vertex* end) {
+	HalfEdge* he = v->he;
+	if (he) {
+		do {
+			if (he->loop == loop && (end == nullptr || he->end == end)) {
+				return he;
+			}
+			he = he->pre->partner;
+		} while (he != v->he);
+	}
+	// v is not manifold (several fans): fall back to walking the loop
+	for (he = loop->first_edge; he->start != v || (end != nullptr && he->end != end); he = he->next);
+	return he;
+}
+
+void Brep::destroyEdge(Solid* solid, Edge* edge) {
+	solid->half_edge_pool.destroy(edge->he1);
+	solid->half_edge_pool.destroy(edge->he2);
+	solid->edge_pool.destroy(edge);
+}
+
+void Brep::destroyVertex(Solid* solid, Vertex* vertex) {
+	solid->point_pool.destroy(vertex->point);
+	solid->vertex_pool.destroy(vertex);
+}
+
+bool Brep::record(const Operation& op) {
+	if (!journal.recording) {
+		return false;
+	}
+	if (journal.done < journal.steps.size()) {
+		size_t first = journal.steps[journal.done];
+		for (size_t i = journal.operations.size(); i-- > first;) {
+			release(journal.operations[i], false);
+		}
+		journal.operations.resize(first);
+		journal.steps.resize(journal.done);
+	}
+	if (!journal.step_open) {
+		journal.steps.push_back(journal.operations.size());
+		++journal.done;
+		journal.step_open = true;
+	}
+	journal.operations.push_back(op);
+	return true;
+}
+
+// Undone operations are freed last to first and applied ones first to last,
+// so a solid always goes after the records of its own that other entries
+// free.
+void Brep::stopJournal() {
+	size_t applied = journal.done < journal.steps.size() ? journal.steps[journal.done] : journal.operations.size();
+	for (size_t i = journal.operations.size(); i-- > applied;) {
+		release(journal.operations[i], false);
+	}
+	for (size_t i = 0; i < applied; ++i) {
+		release(journal.operations[i], true);
+	}
+	journal = Journal();
+}
+
+bool Brep::undo() {
+	journal.step_open = false;
+	if (journal.done == 0) {
+		return false;
+	}
+	--journal.done;
+	size_t first = journal.steps[journal.done];
+	size_t last = journal.done + 1 < journal.steps.size() ? journal.steps[journal.done + 1] : journal.operations.size();
+	for (size_t i = last; i-- > first;) {
+		replay(journal.operations[i], false);
+	}
+	return true;
+}
+
+bool Brep::redo() {
+	journal.step_open = false;
+	if (journal.done == journal.steps.size()) {
+		return false;
+	}
+	size_t first = journal.steps[journal.done];
+	++journal.done;
+	size_t last = journal.done < journal.steps.size() ? journal.steps[journal.done] : journal.operations.size();
+	for (size_t i = first; i < last; ++i) {
+		replay(journal.operations[i], true);
+	}
+	return true;
+}
+
+// Every kind is one of the make/kill pairs, so replaying is a matter of
+// which half of the pair runs.
+void Brep::replay(const Operation& op, bool forward) {
+	Solid* solid = op.solid;
+	HalfEdge* he = op.he;
+	switch (op.kind) {
+	case Operation::Kind::MVFS:
+	case Operation::Kind::KVFS:
+		if ((op.kind == Operation::Kind::MVFS) == forward) {
+			solids.push_back(solid);
+		} else {
+			solids.erase(std::find(solids.begin(), solids.end(), solid));
+		}
+		return;
+	case Operation::Kind::MEV:
+	case Operation::Kind::KEV:
+		if ((op.kind == Operation::Kind::MEV) == forward) {
+			linkEdgeVertex(he);
+			enlist(solid->edges, he->edge);
+			enlist(solid->vertices, he->end);
+			solid->add(*he->end->point);
+		} else {
+			unlinkEdgeVertex(he);
+			unlist(solid->edges, he->edge);
+			unlist(solid->vertices, he->end);
+			solid->vertexRemoved();
+		}
+		break;
+	case Operation::Kind::MEF:
+	case Operation::Kind::KEF:
+		if ((op.kind == Operation::Kind::MEF) == forward) {
+			linkEdgeFace(he);
+			enlist(solid->edges, he->edge);
+			enlist(solid->faces, he->loop->face);
+		} else {
+			unlinkEdgeFace(he);
+			unlist(solid->edges, he->edge);
+			unlist(solid->faces, he->loop->face);
+		}
+		break;
+	case Operation::Kind::MEKR:
+	case Operation::Kind::KEMR:
+		if ((op.kind == Operation::Kind::MEKR) == forward) {
+			linkEdgeRing(he, op.loop);
+			enlist(solid->edges, he->edge);
+		} else {
+			unlinkEdgeRing(he, op.loop, op.outer);
+			unlist(solid->edges, he->edge);
+		}
+		break;
+	case Operation::Kind::MFKRH:
+	case Operation::Kind::KFMRH:
+		if ((op.kind == Operation::Kind::MFKRH) == forward) {
+			linkFace(op.face, op.host);
+			enlist(solid->faces, op.face);
+		} else {
+			unlinkFace(op.face, op.host);
+			unlist(solid->faces, op.face);
+		}
+		break;
+	}
+	POSTCONDITION(solid);
+}
+
+void Brep::release(const Operation& op, bool applied) {
+	Solid* solid = op.solid;
+	HalfEdge* he = op.he;
+	switch (op.kind) {
+	case Operation::Kind::MVFS:
+	case Operation::Kind::KVFS:
+		if ((op.kind == Operation::Kind::MVFS) != applied) {
+			delete solid;
+		}
+		break;
+	case Operation::Kind::MEV:
+	case Operation::Kind::KEV:
+		if ((op.kind == Operation::Kind::MEV) != applied) {
+			destroyVertex(solid, he->end);
+			destroyEdge(solid, he->edge);
+		}
+		break;
+	case Operation::Kind::MEF:
+	case Operation::Kind::KEF:
+		if ((op.kind == Operation::Kind::MEF) != applied) {
+			Loop* loop = he->loop;
+			Face* face = loop->face;
+			destroyEdge(solid, he->edge);
+			solid->loop_pool.destroy(loop);
+			solid->face_pool.destroy(face);
+		}
+		break;
+	case Operation::Kind::MEKR:
+	case Operation::Kind::KEMR:
+		if ((op.kind == Operation::Kind::MEKR) != applied) {
+			destroyEdge(solid, he->edge);
+		} else {
+			solid->loop_pool.destroy(op.loop);
+		}
+		break;
+	case Operation::Kind::MFKRH:
+	case Operation::Kind::KFMRH:
+		if ((op.kind == Operation::Kind::MFKRH) != applied) {
+			solid->face_pool.destroy(op.face);
+		}
+		break;
+	}
+}
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <fstream>
 #include <vector>
 #include <iostream>
+#include <limits>
+
+#include "Pool.h"
 
 struct Point;
 struct Vertex;
@@ -13,23 +18,60 @@ struct Solid;
 
 using namespace std;
 
-struct Solid {
-	Solid() : SolidId(num++) {}
-	int SolidId;
-	vector<Face*> faces;
-	vector<Edge*> edges;
-	vector<Vertex*> vertices;
+// Next id of every kind of entity of one Brep. Ids are unique within their
+// Brep and each kind counts from 0, so they only depend on the operations
+// applied to that Brep. A Brep is changed by one thread at a time, hence
+// plain counters: threads building in parallel use Breps of their own and
+// hand the results over with Brep::adopt, which reserves the ids they used
+// in one step.
+struct IdAllocator {
+	int solid = 0;
+	int vertex = 0;
+	int edge = 0;
+	int loop = 0;
+	int face = 0;
+};
 
-	static int num;
+// One entry of a Brep's journal: the operator that ran and the records that
+// pin down what it did, enough to take the operation out again (undo) and
+// put it back (redo).
+struct Operation {
+	enum class Kind {
+		MVFS, // solid: the new solid
+		KVFS, // solid: the killed solid
+		MEV, // he: new half-edge, towards the new vertex
+		KEV, // he: killed half-edge, towards the killed vertex
+		MEF, // he: new half-edge, on the loop of the new face
+		KEF, // he: killed half-edge, on the loop of the killed face
+		KEMR, // he: killed half-edge, on the loop kept; loop: the new ring
+		MEKR, // he: new half-edge, on the loop kept; loop: the killed ring; outer: it was the outer loop
+		KFMRH, // face: the killed face; host: the face that took its loops
+		MFKRH, // face: the new face; host: the face that gave up the loop
+	};
+
+	Kind kind;
+	Solid* solid; // the operation changed
+	HalfEdge* he = nullptr;
+	Loop* loop = nullptr;
+	Face* face = nullptr;
+	Face* host = nullptr;
+	bool outer = false;
 };
 
-int Solid::num = 0;
+// Operations recorded by a Brep, grouped into steps; see Brep::startJournal.
+struct Journal {
+	bool recording = false;
+	vector<Operation> operations;
+	vector<size_t> steps; // first operation of every step
+	size_t done = 0; // steps applied; the ones after them wait for redo
+	bool step_open = false; // the next operation joins the last step
+};
 
 struct Point {
 	Point() = default;
 	Point(double _x, double _y, double _z) : x(_x), y(_y), z(_z) {}
 
-	friend ifstream& operator >>(ifstream& input, Point& p) {
+	friend istream& operator >>(istream& input, Point& p) {
 		input >> p.x >> p.y >> p.z;
 		return input;
 	}
@@ -44,28 +86,156 @@ struct Point {
 	double z = 0;
 };
 
+// Axis-aligned bounding box, empty (min above max) until a point is added.
+struct Box {
+	Box() = default;
+	explicit Box(const Point& p) : min{ p.x, p.y, p.z }, max{ p.x, p.y, p.z } {}
+
+	double min[3] = { numeric_limits<double>::infinity(), numeric_limits<double>::infinity(),
+	                  numeric_limits<double>::infinity() };
+	double max[3] = { -numeric_limits<double>::infinity(), -numeric_limits<double>::infinity(),
+	                  -numeric_limits<double>::infinity() };
+
+	bool empty() const {
+		return min[0] > max[0];
+	}
+
+	void add(const Point& p) {
+		add(Box(p));
+	}
+
+	void add(const Box& other) {
+		for (int i = 0; i < 3; ++i) {
+			min[i] = std::min(min[i], other.min[i]);
+			max[i] = std::max(max[i], other.max[i]);
+		}
+	}
+
+	bool intersects(const Box& other) const {
+		for (int i = 0; i < 3; ++i) {
+			if (min[i] > other.max[i] || other.min[i] > max[i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+// Plane normal . p + d = 0 of a loop: the unit Newell normal, which the loop
+// runs counter-clockwise around, and the offset through the loop's centroid.
+// The normal is zero for a loop that encloses no area.
+struct Plane {
+	double normal[3] = { 0, 0, 0 };
+	double d = 0;
+
+	double distance(const Point& p) const {
+		return normal[0] * p.x + normal[1] * p.y + normal[2] * p.z + d;
+	}
+};
+
+// A solid owns every topology record reachable from it: they are carved out of
+// the per-solid pools below, so deleting the solid frees all of them at once.
+struct Solid {
+	explicit Solid(IdAllocator* _ids) : SolidId(_ids->solid++), ids(_ids) {}
+	int SolidId;
+	IdAllocator* ids; // of the Brep the solid belongs to
+	unsigned revision = 0; // bumped together with the revision of any of its faces
+	vector<Face*> faces;
+	vector<Edge*> edges;
+	vector<Vertex*> vertices;
+
+	Pool<Point> point_pool;
+	Pool<Vertex> vertex_pool;
+	Pool<HalfEdge> half_edge_pool;
+	Pool<Edge> edge_pool;
+	Pool<Loop> loop_pool;
+	Pool<Face> face_pool;
+
+	// Bounding box of the vertices. Every new vertex grows it; after one is
+	// killed it is recomputed on the next call.
+	const Box& box() const {
+		if (box_stale) {
+			updateBox();
+		}
+		return bounds;
+	}
+
+	void add(const Point& p) {
+		bounds.add(p);
+	}
+
+	void add(const Box& box) {
+		bounds.add(box);
+	}
+
+	void vertexRemoved() {
+		box_stale = true;
+	}
+
+private:
+	void updateBox() const;
+
+	mutable Box bounds;
+	mutable bool box_stale = false;
+};
+
+// Affine map p -> linear * p + offset, used to place the copies made by
+// sweep and revolve.
+struct Transform {
+	double linear[3][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+	double offset[3] = { 0, 0, 0 };
+
+	static Transform translation(double dx, double dy, double dz);
+
+	// Right-handed rotation by angle (radians) about the line through origin
+	// along axis, which need not be unit length.
+	static Transform rotation(const Point& origin, const Point& axis, double angle);
+
+	Point apply(const Point& p) const {
+		return Point(linear[0][0] * p.x + linear[0][1] * p.y + linear[0][2] * p.z + offset[0],
+		             linear[1][0] * p.x + linear[1][1] * p.y + linear[1][2] * p.z + offset[1],
+		             linear[2][0] * p.x + linear[2][1] * p.y + linear[2][2] * p.z + offset[2]);
+	}
+
+	// the image of a plane, for a linear part that is a rotation (as in every
+	// transform above)
+	Plane apply(const Plane& plane) const {
+		Plane image;
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 3; ++j) {
+				image.normal[i] += linear[i][j] * plane.normal[j];
+			}
+			image.d -= image.normal[i] * offset[i];
+		}
+		image.d += plane.d;
+		return image;
+	}
+};
+
 struct Vertex {
 	Vertex() = default;
 
-	Vertex(Point* _point, Solid* solid) : VertexId(num++), point(_point) {
+	Vertex(Point* _point, Solid* solid) : VertexId(solid->ids->vertex++), point(_point), index(solid->vertices.size()) {
 		solid->vertices.push_back(this);
+		solid->add(*point);
 	}
 
-	Vertex(double _x, double _y, double _z, Solid* solid): VertexId(num++), point(new Point(_x, _y, _z)) {
+	Vertex(double _x, double _y, double _z, Solid* solid)
+		: VertexId(solid->ids->vertex++), point(solid->point_pool.create(_x, _y, _z)), index(solid->vertices.size()) {
 		solid->vertices.push_back(this);
+		solid->add(*point);
 	}
 
 	int VertexId;
-	Point* point = new Point;
-	static int num;
+	Point* point = nullptr;
+	HalfEdge* he = nullptr; // any half-edge starting here, kept up to date by the Euler operators
+	size_t index = 0; // position in solid->vertices
 
 	void debug() {
 		printf("Vertex debug: %f %f %f\n", point->x, point->y, point->z);
 	}
 };
 
-int Vertex::num = 0;
-
 struct HalfEdge {
 	HalfEdge() = default;
 	HalfEdge(Vertex* v1, Vertex* v2): start(v1), end(v2) {}
@@ -83,7 +253,8 @@ struct HalfEdge {
 struct Edge {
 	Edge() = default;
 
-	Edge(HalfEdge* _he1, HalfEdge* _he2, Solid* solid): he1(_he1), he2(_he2), EdgeId(num++) {
+	Edge(HalfEdge* _he1, HalfEdge* _he2, Solid* solid)
+		: EdgeId(solid->ids->edge++), he1(_he1), he2(_he2), index(solid->edges.size()) {
 		he1->partner = he2;
 		he2->partner = he1;
 		he1->edge = he2->edge = this;
@@ -94,29 +265,23 @@ struct Edge {
 
 	HalfEdge* he1 = nullptr;
 	HalfEdge* he2 = nullptr;
-
-	static int num;
+	size_t index = 0; // position in solid->edges
 };
 
-int Edge::num = 0;
-
 struct Loop {
-	Loop(): loopId(num++) {}
-	Loop(Face* _face): loopId(num++), face(_face) {}
+	explicit Loop(Solid* solid) : loopId(solid->ids->loop++) {}
+	explicit Loop(Face* _face);
 
 	int loopId;
 	Face* face = nullptr;
 	HalfEdge* first_edge = nullptr;
-
-	static int num;
 };
 
-int Loop::num = 0;
-
 struct Face {
 	Face() = default;
 
-	Face(Loop* _outloop, Solid* _solid) : faceId(num++), solid(_solid), outer_loop(_outloop) {
+	Face(Loop* _outloop, Solid* _solid)
+		: faceId(_solid->ids->face++), solid(_solid), outer_loop(_outloop), index(solid->faces.size()) {
 		outer_loop->face = this;
 		solid->faces.push_back(this);
 	}
@@ -125,11 +290,44 @@ struct Face {
 	Solid* solid = nullptr;
 	Loop* outer_loop = nullptr;
 	vector<Loop*> inner_loops;
+	size_t index = 0; // position in solid->faces
+	unsigned revision = 0; // bumped by every Euler operator that changes the face's loops
+
+	// Bounding box of the vertices on the face's loops. It is current while
+	// box_revision matches revision: operators that only add vertices to the
+	// face grow it and keep it so, any other change makes the next call
+	// recompute it (one walk over the loops). Not safe to call concurrently
+	// on the same face.
+	const Box& box() const {
+		if (box_revision != revision) {
+			updateBox();
+		}
+		return bounds;
+	}
+
+	// Plane of the outer loop, cached the same way: it stays current through
+	// operators that leave the outer loop's shape alone (MEV, KEV, KFMRH,
+	// MFKRH) and moves with the loop in sweep and revolve.
+	const Plane& plane() const {
+		if (plane_revision != revision) {
+			updatePlane();
+		}
+		return equation;
+	}
+
+private:
+	friend struct Brep;
 
-	static int num;
+	void updateBox() const;
+	void updatePlane() const;
+
+	mutable Box bounds;
+	mutable unsigned box_revision = ~0u;
+	mutable Plane equation;
+	mutable unsigned plane_revision = ~0u;
 };
 
-int Face::num = 0;
+inline Loop::Loop(Face* _face) : loopId(_face->solid->ids->loop++), face(_face) {}
 
 inline void debug(HalfEdge* he) {
 	printf("(%5.2f,%5.2f,%5.2f) -> (%5.2f,%5.2f,%5.2f), edgeid: %d, loopid: %d\n", he->start->point->x,
@@ -173,187 +371,225 @@ inline void debug(Solid* solid) {
 
 
 struct Brep {
+	Brep() = default;
+	Brep(const Brep&) = delete;
+	Brep& operator=(const Brep&) = delete;
+
+	~Brep();
+
 	vector<Solid*> solids;
+	IdAllocator ids;
+
+	// Moves every solid of other to the end of this Brep and shifts its ids
+	// by the ones this Brep has handed out, so the result is numbered as if
+	// other's operations had been applied here. Leaves other empty.
+	void adopt(Brep& other);
+
+	// Journal for undo and redo, off until startJournal. While it is on every
+	// Euler operator (and remove) records what it did, and the records an
+	// operator kills are kept instead of freed. Undo then links the very
+	// same records back in, and redo takes them out again, so neither
+	// allocates, ids and pointers survive, and the cost is that of the
+	// operations undone rather than of the model. Operations group into
+	// steps closed by endStep; an operation after an undo drops the steps
+	// that were waiting for redo. Loading (CompactSolid, .cbrep) and adopt
+	// are not recorded.
+	Journal journal;
+
+	void startJournal() {
+		journal.recording = true;
+	}
 
-	Vertex* MVFS(double x, double y, double z) {
-		Solid* solid = new Solid;
-		Vertex* vertex = new Vertex(x, y, z, solid);
-		Loop* loop = new Loop;
-		new Face(loop, solid);
-		solids.push_back(solid);
-		return vertex;
-	}
-
-	Vertex* MEV(Loop* loop, Vertex* v1, double x, double y, double z) {
-		Solid* solid = loop->face->solid;
-		Vertex* v2 = new Vertex(x, y, z, solid);
-		MEV(loop, v1, v2);
-		return v2;
-	}
-
-	Vertex* MEV(Loop* loop, Vertex* v1, Vertex* v2) {
-		Solid* solid = loop->face->solid;
-		HalfEdge* he1 = new HalfEdge(v1, v2);
-		HalfEdge* he2 = new HalfEdge(v2, v1);
-		Edge* edge = new Edge(he1, he2, solid);
-		he1->loop = he2->loop = loop;
-
-		he1->next = he2;
-		he2->pre = he1;
-
-		if (loop->first_edge == nullptr) {
-			he2->next = he1;
-			he1->pre = he2;
-			loop->first_edge = he1;
-		} else {
-			HalfEdge* he;
-			for (he = loop->first_edge; he->end != v1; he = he->next);
-			he2->next = he->next;
-			he2->next->pre = he2;
-			he->next = he1;
-			he1->pre = he;
-		}
-		// debug(loop);
-		return v2;
+	// Forgets the history and frees what it kept alive.
+	void stopJournal();
+
+	void endStep() {
+		journal.step_open = false;
 	}
 
-	Face* MEF(Loop* loop, Vertex* e1_start, Vertex* e1_end, Vertex* e2_start, Vertex* e2_end) {
-		Solid* solid = loop->face->solid;
-		HalfEdge *he1, *he2;
-		for (he1 = loop->first_edge; he1->start != e1_start || he1->end != e1_end; he1 = he1->next);
-		for (he2 = he1; he2->start != e2_start || he2->end != e2_end; he2 = he2->next);
-
-		HalfEdge* new_he1 = new HalfEdge(e1_end, e2_end);
-		HalfEdge* new_he2 = new HalfEdge(e2_end, e1_end);
-		new Edge(new_he1, new_he2, solid);
-
-		new_he1->next = he2->next;
-		new_he1->pre = he1;
-		new_he2->next = he1->next;
-		new_he2->pre = he2;
-		new_he1->next->pre = new_he1;
-		new_he1->pre->next = new_he1;
-		new_he2->next->pre = new_he2;
-		new_he2->pre->next = new_he2;
-
-		Loop* new_loop = new Loop;
-		Face* new_face = new Face(new_loop, solid);
-
-		new_loop->first_edge = new_he1;
-		new_he1->loop = new_loop;
-		loop->first_edge = new_he2;
-		new_he2->loop = loop;
-
-		HalfEdge* he = new_he1->next;
-		while (he != new_he1) {
-			he->loop = new_loop;
-			he = he->next;
-		}
-		// printf("old face: \n");
-		// debug(loop);
-		// printf("new face: \n");
-		// debug(new_loop);
+	// Each returns false when there is no step to undo or redo.
+	bool undo();
+	bool redo();
+
+	Vertex* MVFS(double x, double y, double z);
+
+	// Drops a solid together with all of its topology in one go.
+	void remove(Solid* solid);
+
+	// Adds a solid built without the Euler operators (Boolean), recorded
+	// like MVFS, so undo takes it out again. SolidView::expand does not go
+	// through here: loading is not recorded.
+	void insert(Solid* solid);
 
-		return new_face;
+	// Inverse of MVFS, for a solid down to the vertex and face MVFS made.
+	void KVFS(Solid* solid) {
+		remove(solid);
 	}
 
+	Vertex* MEV(Loop* loop, Vertex* v1, double x, double y, double z);
+
+	// When v1 occurs more than once in the loop the new edge goes into the
+	// first wedge found around v1; use the half-edge overload to pick one.
+	Vertex* MEV(Loop* loop, Vertex* v1, Vertex* v2);
+
+	// Inserts the edge he->end -> v2 right after he and returns its half-edge
+	// in that direction.
+	HalfEdge* MEV(HalfEdge* he, double x, double y, double z);
+
+	HalfEdge* MEV(HalfEdge* he, Vertex* v2);
+
+	Face* MEF(Loop* loop, Vertex* e1_start, Vertex* e1_end, Vertex* e2_start, Vertex* e2_end) {
+		return MEF(findHalfEdge(loop, e1_start, e1_end), findHalfEdge(loop, e2_start, e2_end));
+	}
+
+	// Joins he1->end and he2->end, which must lie on the same loop. The new
+	// loop starts with the new half-edge he1->end -> he2->end and gets the
+	// new face.
+	Face* MEF(HalfEdge* he1, HalfEdge* he2);
+
+	// Inverse of MEV: kills the edge of he together with he->end, which
+	// must have no other edge.
+	void KEV(HalfEdge* he);
+
+	// Inverse of MEF: kills the edge of he and the face whose outer loop he
+	// lies on. Its loops join the face across the edge, which is returned.
+	Face* KEF(HalfEdge* he);
+
 	Loop* KEMR(Loop* loop, Vertex* v1, Vertex* v2) {
-		HalfEdge* he1;
-		for (he1 = loop->first_edge; !(he1->start == v1 && he1->end == v2); he1 = he1->next);
-		HalfEdge* he2 = he1->partner;
-
-		he1->next->pre = he2->pre;
-		he1->pre->next = he2->next;
-		he2->next->pre = he1->pre;
-		he2->pre->next = he1->next;
-
-		Face* face = loop->face;
-		Loop* new_loop = new Loop(face);
-		face->inner_loops.push_back(new_loop);
-
-		loop->first_edge = he1->next;
-		new_loop->first_edge = he2->next;
-		he2->next->loop = new_loop;
-
-		HalfEdge* he = new_loop->first_edge->next;
-		while (he != new_loop->first_edge) {
-			he->loop = new_loop;
-			he = he->next;
-		}
+		return KEMR(findHalfEdge(loop, v1, v2));
+	}
 
-		HalfEdge* tmp = loop->first_edge;
-		auto& edge_list = loop->face->solid->edges;
-		auto edge_it = std::find(edge_list.begin(), edge_list.end(), he1->edge);
-		edge_list.erase(edge_it);
-		delete he1->edge;
-		delete he1;
-		delete he2;
-		// printf("KEMR outloop\n");
-		// debug(loop);
-		// for (int i = 0; i < face->inner_loops.size(); ++i) {
-		// 	printf("innerloop %d\n", i);
-		// 	debug(face->inner_loops[i]);
-		// }
-		return new_loop;
-	}
-
-	Solid* KFMRH(Face* outer_face, Face* inner_face) {
-		Solid* solid1 = outer_face->solid;
-		Solid* solid2 = inner_face->solid;
-		auto& face_list = solid1->faces;
-		if (solid1 == solid2) {
-			outer_face->inner_loops.push_back(inner_face->outer_loop);
-			// debug(outer_face);
-			inner_face->outer_loop->face = outer_face;
-			// debug(inner_face);
-			auto face_it = std::find(face_list.begin(), face_list.end(), inner_face);
-			face_list.erase(face_it);
-			delete inner_face;
-		} else {
-			// todo: combine solids
-		}
-		return solid1;
-	}
-
-	Solid* sweep(Face* face, double dx, double dy, double dz) {
-		Solid* solid = face->solid;
-		Loop *loop = face->outer_loop, *enclosed_loop = loop->first_edge->partner->loop;
-		Face* enclosed_face = enclosed_loop->face;
-		HalfEdge* first_edge = loop->first_edge;
-		Vertex *first_vertex = first_edge->start, *last_start = first_vertex;
-		Vertex *first_new_vertex = new Vertex(first_vertex->point->x + dx, first_vertex->point->y + dy,
-		                                      first_vertex->point->z + dz, solid), *last_end = first_new_vertex;
-		MEV(enclosed_loop, first_vertex, first_new_vertex);
-		for (HalfEdge* he = first_edge->pre; he != first_edge; he = he->pre) {
-			Vertex *start = he->start, *end = new Vertex(start->point->x + dx, start->point->y + dy,
-			                                             start->point->z + dz, solid);
-			MEV(enclosed_loop, start, end);
-			MEF(enclosed_loop, start, end, last_start, last_end);
-			last_start = last_end;
-			last_end = end;
+	// Removes the edge of he1; the part of the loop hanging off he1->end
+	// becomes a new inner loop of the face.
+	Loop* KEMR(HalfEdge* he1);
+
+	// Inverse of KEMR: joins he1->end and he2->end, which lie on different
+	// loops of the same face, so the two loops become one (the outer loop if
+	// either was). Returns the new half-edge he1->end -> he2->end.
+	HalfEdge* MEKR(HalfEdge* he1, HalfEdge* he2);
+
+	// The outer loop of inner_face, and any inner loops it has, become inner
+	// loops of outer_face and inner_face is removed. When the faces belong to
+	// different solids the second one is merged into the first (its records
+	// keep their addresses and ids) and deleted. The journal cannot take a
+	// merge back, so it forgets the history before one, as stopJournal does,
+	// and goes on recording.
+	Solid* KFMRH(Face* outer_face, Face* inner_face);
+
+	// Inverse of KFMRH: the inner loop becomes the outer loop of a new face.
+	Face* MFKRH(Loop* inner_loop);
+
+	Solid* sweep(Face* face, double dx, double dy, double dz);
+
+	// Sweeps faces[i] by offsets[i] (every face by offsets[0] when only one
+	// offset is given) with the same result, ids included, as calling sweep
+	// on one face after the other. Storage is sized up front from the loop
+	// lengths, since sweeping a loop of n edges adds exactly n vertices, 2n
+	// edges and n faces, and the faces of different solids are swept on up
+	// to `threads` threads (0 = one per core) when no face of the batch is
+	// the one another sweep extrudes into.
+	void sweep(const vector<Face*>& faces, const vector<Point>& offsets, unsigned threads = 1);
+
+	// Turns the loops on the other side of face about the axis through
+	// axis_point along axis_direction by angle (radians, right-handed) in
+	// `segments` equal steps, each one strut per vertex and one lateral face
+	// per edge like a sweep. A full turn (|angle| >= 2 pi) closes the solid
+	// onto face itself, making a ring, and needs at least 2 segments; the
+	// profile must not touch the axis. Cost is linear in segments times the
+	// number of edges of face.
+	Solid* revolve(Face* face, const Point& axis_point, const Point& axis_direction, double angle,
+	               int segments);
+
+private:
+	// The topology changes behind the operators and their journal entries,
+	// in make/kill pairs that exactly undo each other. They relink the
+	// records around one edge or face and nothing else: no allocation, no
+	// solid lists, and the unlinked records keep their own links, which is
+	// what the make half puts back. The half-edge arguments are oriented as
+	// in Operation.
+	static void linkEdgeVertex(HalfEdge* he);
+	static void unlinkEdgeVertex(HalfEdge* he);
+	static void linkEdgeFace(HalfEdge* he);
+	static void unlinkEdgeFace(HalfEdge* he);
+	static void linkEdgeRing(HalfEdge* he, Loop* ring);
+	static void unlinkEdgeRing(HalfEdge* he, Loop* ring, bool outer);
+	static void linkFace(Face* face, Face* host); // face takes its loops back from host
+	static void unlinkFace(Face* face, Face* host); // face's loops move to host
+
+	// Appends op to the journal, dropping the steps left for redo first.
+	// Returns false when no journal is kept: the caller frees what op killed.
+	bool record(const Operation& op);
+
+	// Applies (forward) or takes back one journal entry.
+	void replay(const Operation& op, bool forward);
+
+	// Frees the records op keeps out of the model: the ones it killed while
+	// it is applied, the ones it made once undone.
+	void release(const Operation& op, bool applied);
+
+	// Moves the records of other into solid, for KFMRH.
+	void merge(Solid* solid, Solid* other);
+
+	static void destroyEdge(Solid* solid, Edge* edge);
+	static void destroyVertex(Solid* solid, Vertex* vertex);
+
+	// Extrudes the loop of first_side: one strut from every vertex to its
+	// image under transform and one lateral face per edge, built directly in
+	// time linear in the loop length. The loop is left running through the
+	// images; returns its new first half-edge, the image of first_side.
+	HalfEdge* extrudeLoop(HalfEdge* first_side, const Transform& transform);
+
+	// Closes the gap between two loops of one face whose vertices pair up:
+	// `first` and `other_first` run in opposite directions with
+	// other_first->end the partner of first->start. Each edge of `first`
+	// gets a quad face; returns the loop left over, the quad of the last
+	// edge, which keeps first's loop.
+	Loop* bridgeLoops(HalfEdge* first, HalfEdge* other_first);
+
+	// Outgoing half-edge of v that lies on loop (and ends at `end` when
+	// given). Rotates around v through the vertex map, so the cost is the
+	// vertex degree rather than the loop length.
+	static HalfEdge* findHalfEdge(Loop* loop, Vertex* v, Vertex* end = nullptr);
+
+	// Also makes the face's cached box and plane stale, unless the operator
+	// follows up with grow or keepPlane.
+	static void touch(Face* face) {
+		++face->revision;
+		++face->solid->revision;
+	}
+
+	// after touch: the face kept its old vertices and gained the ones in
+	// `added`, so a box that was current grows and stays current
+	static void grow(Face* face, const Box& added) {
+		if (face->box_revision + 1 == face->revision) {
+			face->bounds.add(added);
+			face->box_revision = face->revision;
 		}
-		MEF(enclosed_loop, first_vertex, first_new_vertex, last_start, last_end);
-		for (Loop* inner_loop : face->inner_loops) {
-			first_edge = inner_loop->first_edge;
-			enclosed_loop = first_edge->partner->loop;
-			first_vertex = first_edge->start;
-			last_start = first_vertex;
-			first_new_vertex = new Vertex(first_vertex->point->x + dx, first_vertex->point->y + dy,
-			                              first_vertex->point->z + dz, solid);
-			last_end = first_new_vertex;
-			MEV(enclosed_loop, first_vertex, first_new_vertex);
-			// debug(enclosed_loop);
-			for (HalfEdge* he = first_edge->pre; he != first_edge; he = he->pre) {
-				Vertex *start = he->start, *end = new Vertex(start->point->x + dx, start->point->y + dy,
-				                                             start->point->z + dz, solid);
-				MEV(enclosed_loop, start, end);
-				MEF(enclosed_loop, start, end, last_start, last_end);
-				last_start = last_end;
-				last_end = end;
-			}
-			MEF(enclosed_loop, first_vertex, first_new_vertex, last_start, last_end);
-			KFMRH(enclosed_face, enclosed_loop->face);
+	}
+
+	// after touch: the outer loop spans the same plane as before
+	static void keepPlane(Face* face) {
+		if (face->plane_revision + 1 == face->revision) {
+			face->plane_revision = face->revision;
 		}
-		return solid;
 	}
-};
+
+	static void link(HalfEdge* he, HalfEdge* next) {
+		he->next = next;
+		next->pre = he;
+	}
+
+	// O(1) removal from one of the solid's entity lists.
+	template <typename T>
+	static void unlist(vector<T*>& list, T* item) {
+		list[item->index] = list.back();
+		list[item->index]->index = item->index;
+		list.pop_back();
+	}
+
+	template <typename T>
+	static void enlist(vector<T*>& list, T* item) {
+		item->index = list.size();
+		list.push_back(item);
+	}
+};
\ No newline at end of file
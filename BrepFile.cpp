@@ -0,0 +1,182 @@
+#include "BrepFile.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const char MAGIC[8] = { 'C', 'A', 'D', 'b', 'r', 'e', 'p', '\0' };
+const uint32_t BYTE_ORDER_MARK = 0x01020304u;
+
+struct FileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint64_t solid_count;
+};
+
+struct SolidHeader {
+	uint32_t vertex_count, edge_count, loop_count, face_count;
+};
+
+static_assert(sizeof(FileHeader) == 24 && sizeof(SolidHeader) == 16, "file headers must not be padded");
+
+uint64_t padded(uint64_t bytes) {
+	return (bytes + 7) & ~uint64_t(7);
+}
+
+// Bytes taken by a solid with these counts, headers and padding included.
+uint64_t solidSize(const SolidHeader& counts) {
+	uint64_t half_edges = 2 * uint64_t(counts.edge_count);
+	return sizeof(SolidHeader) + 3 * padded(counts.vertex_count * sizeof(double)) +
+	       4 * padded(half_edges * sizeof(uint32_t)) + 3 * padded(counts.loop_count * sizeof(uint32_t)) +
+	       padded(counts.face_count * sizeof(uint32_t));
+}
+
+SolidHeader countEntities(const Solid* solid) {
+	SolidHeader counts;
+	counts.vertex_count = static_cast<uint32_t>(solid->vertices.size());
+	counts.edge_count = static_cast<uint32_t>(solid->edges.size());
+	counts.face_count = static_cast<uint32_t>(solid->faces.size());
+	counts.loop_count = counts.face_count;
+	for (const Face* face : solid->faces) {
+		counts.loop_count += static_cast<uint32_t>(face->inner_loops.size());
+	}
+	return counts;
+}
+
+struct Writer {
+	FILE* file;
+
+	bool bytes(const void* data, size_t size) {
+		return fwrite(data, 1, size, file) == size;
+	}
+
+	template <class T>
+	bool array(const vector<T>& values) {
+		static const char zeros[8] = {};
+		size_t size = values.size() * sizeof(T);
+		return bytes(values.data(), size) && bytes(zeros, padded(size) - size);
+	}
+};
+
+} // namespace
+
+// The offsets only depend on the entity counts, so they are written first
+// and each solid is converted and written in turn.
+bool writeBrepFile(const char* path, const Brep& brep, string& error) {
+	FILE* file = fopen(path, "wb");
+	if (file == nullptr) {
+		error = string(path) + ": " + strerror(errno);
+		return false;
+	}
+	Writer out{ file };
+	FileHeader header;
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = BREP_FILE_VERSION;
+	header.byte_order = BYTE_ORDER_MARK;
+	header.solid_count = brep.solids.size();
+	vector<uint64_t> offsets;
+	uint64_t offset = sizeof(FileHeader) + brep.solids.size() * sizeof(uint64_t);
+	for (const Solid* solid : brep.solids) {
+		offsets.push_back(offset);
+		offset += solidSize(countEntities(solid));
+	}
+	bool ok = out.bytes(&header, sizeof(header)) && out.array(offsets);
+	for (size_t i = 0; ok && i < brep.solids.size(); ++i) {
+		CompactSolid solid(brep.solids[i]);
+		SolidHeader counts{ solid.vertexCount(), solid.edgeCount(), solid.loopCount(), solid.faceCount() };
+		ok = out.bytes(&counts, sizeof(counts)) && out.array(solid.x) && out.array(solid.y) &&
+		     out.array(solid.z) && out.array(solid.he_next) && out.array(solid.he_prev) &&
+		     out.array(solid.he_vertex) && out.array(solid.he_loop) && out.array(solid.loop_first) &&
+		     out.array(solid.loop_face) && out.array(solid.loop_next) && out.array(solid.face_outer);
+	}
+	if (fclose(file) != 0) {
+		ok = false;
+	}
+	if (!ok) {
+		error = string(path) + ": write error";
+	}
+	return ok;
+}
+
+bool BrepFile::open(const char* path, string& error) {
+	solids.clear();
+	if (!window.open(path, error, 0)) {
+		return false;
+	}
+	auto fail = [&](const char* message) {
+		error = string(path) + ": " + message;
+		return false;
+	};
+	const char* data = window.data;
+	uint64_t size = window.size;
+	FileHeader header;
+	if (size < sizeof(header)) {
+		return fail("not a .cbrep file");
+	}
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+		return fail("not a .cbrep file");
+	}
+	if (header.byte_order != BYTE_ORDER_MARK) {
+		return fail("written with a different byte order");
+	}
+	if (header.version != BREP_FILE_VERSION) {
+		return fail("unsupported .cbrep version");
+	}
+	if (header.solid_count > (size - sizeof(header)) / sizeof(uint64_t)) {
+		return fail("truncated file");
+	}
+	const uint64_t* offsets = reinterpret_cast<const uint64_t*>(data + sizeof(header));
+	solids.reserve(static_cast<size_t>(header.solid_count));
+	for (uint64_t i = 0; i < header.solid_count; ++i) {
+		uint64_t offset = offsets[i];
+		if (offset % 8 != 0 || offset > size || size - offset < sizeof(SolidHeader)) {
+			return fail("bad solid offset");
+		}
+		SolidHeader counts;
+		memcpy(&counts, data + offset, sizeof(counts));
+		if (counts.edge_count > NIL / 2 || solidSize(counts) > size - offset) {
+			return fail("truncated file");
+		}
+		SolidView solid;
+		solid.vertex_count = counts.vertex_count;
+		solid.edge_count = counts.edge_count;
+		solid.loop_count = counts.loop_count;
+		solid.face_count = counts.face_count;
+		const char* at = data + offset + sizeof(SolidHeader);
+		auto take = [&at](auto*& array, uint64_t count) {
+			array = reinterpret_cast<remove_reference_t<decltype(array)>>(at);
+			at += padded(count * sizeof(*array));
+		};
+		uint64_t half_edges = 2 * uint64_t(counts.edge_count);
+		take(solid.x, counts.vertex_count);
+		take(solid.y, counts.vertex_count);
+		take(solid.z, counts.vertex_count);
+		take(solid.he_next, half_edges);
+		take(solid.he_prev, half_edges);
+		take(solid.he_vertex, half_edges);
+		take(solid.he_loop, half_edges);
+		take(solid.loop_first, counts.loop_count);
+		take(solid.loop_face, counts.loop_count);
+		take(solid.loop_next, counts.loop_count);
+		take(solid.face_outer, counts.face_count);
+		solids.push_back(solid);
+	}
+	return true;
+}
+
+bool BrepFile::load(Brep& brep, string& error) const {
+	for (size_t i = 0; i < solids.size(); ++i) {
+		if (!solids[i].valid()) {
+			error = "solid " + to_string(i) + " has indices out of range";
+			return false;
+		}
+	}
+	for (const SolidView& solid : solids) {
+		solid.expand(brep);
+	}
+	return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "CompactBrep.h"
+#include "FileWindow.h"
+
+// Binary .cbrep files: every solid of a Brep stored as the arrays of its
+// CompactSolid, so a file is loaded without parsing anything.
+//
+//   header   "CADbrep\0", uint32 version, uint32 byte order mark 0x01020304,
+//            uint64 solid count
+//   offsets  uint64 file offset of each solid
+//   solid    uint32 vertex, edge, loop and face count, then the arrays x, y,
+//            z (double), he_next, he_prev, he_vertex, he_loop, loop_first,
+//            loop_face, loop_next and face_outer (uint32)
+//
+// Every array starts on an 8-byte boundary. Files use the byte order of the
+// machine that wrote them; a reader with the other order rejects them.
+constexpr uint32_t BREP_FILE_VERSION = 1;
+
+// Writes all solids of brep to path. Returns false and fills in error if the
+// file cannot be written.
+bool writeBrepFile(const char* path, const Brep& brep, string& error);
+
+// A .cbrep file mapped into memory. The solids are SolidViews straight into
+// the mapping, so they can be inspected in place; load() expands them into a
+// Brep.
+struct BrepFile {
+	// Maps the file and checks the header and that every solid lies inside
+	// the file. Returns false and fills in error otherwise.
+	bool open(const char* path, string& error);
+
+	size_t solidCount() const {
+		return solids.size();
+	}
+
+	// Only valid while the BrepFile is open; check valid() before walking
+	// the arrays of a file from an untrusted source.
+	SolidView solid(size_t i) const {
+		return solids[i];
+	}
+
+	// Appends every solid to brep after checking its indices.
+	bool load(Brep& brep, string& error) const;
+
+private:
+	FileWindow window;
+	vector<SolidView> solids;
+};
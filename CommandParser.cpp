@@ -0,0 +1,296 @@
+#include "CommandParser.h"
+
+#include <charconv>
+#include <cstring>
+#include <memory>
+
+#include "Parallel.h"
+
+static bool isSpace(char c) {
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+bool CommandParser::parseFile(const char* path, size_t window_size) {
+	if (!window.open(path, error, window_size)) {
+		return false;
+	}
+	return run();
+}
+
+bool CommandParser::parse(const char* text, size_t length) {
+	window.data = text;
+	window.size = length;
+	window.start = 0;
+	window.last = true;
+	return run();
+}
+
+// Part of the script that starts with a `face` (or at the start of the file)
+// and ends before the next one.
+struct CommandParser::Section {
+	uint64_t begin, end;
+	size_t line; // of begin
+	uint64_t line_start;
+};
+
+namespace {
+
+// What one section built, numbered from 0 until it is adopted.
+struct SectionResult {
+	Brep brep;
+	Face* face = nullptr;
+	size_t commands = 0;
+	size_t line = 0, column = 0;
+	bool ok = false;
+};
+
+} // namespace
+
+bool CommandParser::parseFileParallel(const char* path, unsigned threads) {
+	if (!window.open(path, error, 0)) {
+		return false;
+	}
+	// a single pass over the bytes finds the `face` tokens and the line
+	// they are on; `finish` ends the script early
+	const char* data = window.data;
+	uint64_t size = window.size;
+	vector<Section> sections{ { 0, size, 1, 0 } };
+	size_t at_line = 1;
+	uint64_t at_line_start = 0;
+	bool any_token = false;
+	for (uint64_t i = 0; i < size;) {
+		if (isSpace(data[i])) {
+			if (data[i] == '\n') {
+				++at_line;
+				at_line_start = i + 1;
+			}
+			++i;
+			continue;
+		}
+		uint64_t begin = i;
+		while (i < size && !isSpace(data[i])) {
+			++i;
+		}
+		string_view token(data + begin, static_cast<size_t>(i - begin));
+		if (token == "finish") {
+			sections.back().end = i;
+			break;
+		}
+		if (token == "face" && any_token) {
+			sections.back().end = begin;
+			sections.push_back({ begin, size, at_line, at_line_start });
+		}
+		any_token = true;
+	}
+
+	vector<unique_ptr<SectionResult>> results(sections.size());
+	parallelFor(sections.size(), [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; ++i) {
+			results[i] = make_unique<SectionResult>();
+			SectionResult& result = *results[i];
+			Modeler section_modeler(&result.brep);
+			CommandParser section_parser(&section_modeler);
+			result.ok = section_parser.parseSection(data, sections[i]);
+			result.face = section_modeler.face;
+			result.commands = section_modeler.commands;
+			result.line = section_parser.line;
+			result.column = section_parser.column;
+		}
+	}, threads);
+
+	for (const auto& result : results) {
+		if (!result->ok) {
+			// the error is reported exactly as a sequential run reports it
+			results.clear();
+			CommandParser sequential(modeler);
+			bool ok = sequential.parseFile(path);
+			line = sequential.line;
+			column = sequential.column;
+			error = sequential.error;
+			return ok;
+		}
+	}
+	for (const auto& result : results) {
+		modeler->brep->adopt(result->brep);
+		if (result->face) {
+			modeler->face = result->face;
+		}
+		modeler->commands += result->commands;
+		if (result->line) {
+			line = result->line;
+			column = result->column;
+		}
+	}
+	return true;
+}
+
+// Runs the parser over [section.begin, section.end) of the mapped text with
+// positions reported as in the whole file.
+bool CommandParser::parseSection(const char* text, const Section& section) {
+	window.data = text + section.begin;
+	window.size = static_cast<size_t>(section.end - section.begin);
+	window.start = section.begin;
+	window.last = true;
+	next_line = section.line;
+	line_start = section.line_start;
+	return run();
+}
+
+bool CommandParser::run() {
+	// editors on Windows like to start the file with a UTF-8 byte order mark
+	if (window.size >= 3 && memcmp(window.data, "\xEF\xBB\xBF", 3) == 0) {
+		pos = 3;
+		line_start = 3;
+	}
+	string_view token;
+	while (nextToken(token)) {
+		bool ok;
+		if (token == "face") {
+			ok = loop(&Modeler::beginFace);
+		} else if (token == "ring") {
+			ok = loop(&Modeler::beginRing);
+		} else if (token == "sweep") {
+			size_t command_line = line, command_column = column;
+			Point direction;
+			ok = readPoint(direction);
+			if (ok && !modeler->sweep(direction)) {
+				line = command_line;
+				column = command_column;
+				ok = fail(modeler->error);
+			}
+		} else if (token == "revolve") {
+			size_t command_line = line, command_column = column;
+			Point axis_point, axis_direction;
+			double degrees;
+			size_t segments;
+			ok = readPoint(axis_point) && readPoint(axis_direction) && readNumber(degrees) &&
+			     readCount(segments, "segment count");
+			if (ok && !modeler->revolve(axis_point, axis_direction, degrees, segments)) {
+				line = command_line;
+				column = command_column;
+				ok = fail(modeler->error);
+			}
+		} else if (token == "finish") {
+			return true;
+		} else {
+			return fail("unknown command '" + string(token) + "'");
+		}
+		if (!ok) {
+			return false;
+		}
+	}
+	return error.empty();
+}
+
+// Whitespace separated tokens. A token cut off by the end of the window is
+// read again from the start of a window slid up to it.
+bool CommandParser::nextToken(string_view& token) {
+	for (;;) {
+		const char* data = window.data;
+		while (pos < window.size && isSpace(data[pos])) {
+			if (data[pos] == '\n') {
+				++next_line;
+				line_start = window.start + pos + 1;
+			}
+			++pos;
+		}
+		if (pos == window.size) {
+			if (window.last || !slide(pos)) {
+				return false;
+			}
+			continue;
+		}
+		size_t begin = pos;
+		while (pos < window.size && !isSpace(data[pos])) {
+			++pos;
+		}
+		line = next_line;
+		column = static_cast<size_t>(window.start + begin - line_start) + 1;
+		if (pos == window.size && !window.last) {
+			if (begin == 0) {
+				return fail("token does not fit into the read window");
+			}
+			if (!slide(begin)) {
+				return false;
+			}
+			continue;
+		}
+		token = string_view(data + begin, pos - begin);
+		return true;
+	}
+}
+
+bool CommandParser::slide(size_t offset) {
+	if (!window.slide(window.start + offset, error)) {
+		return false;
+	}
+	pos = 0;
+	return true;
+}
+
+bool CommandParser::readCount(size_t& count, const char* what) {
+	string_view token;
+	if (!nextToken(token)) {
+		return error.empty() && fail(string("unexpected end of input, expected a ") + what);
+	}
+	auto [end, status] = from_chars(token.data(), token.data() + token.size(), count);
+	if (status != errc() || end != token.data() + token.size()) {
+		return fail("'" + string(token) + "' is not a " + what);
+	}
+	return true;
+}
+
+bool CommandParser::readPoint(Point& point) {
+	return readNumber(point.x) && readNumber(point.y) && readNumber(point.z);
+}
+
+bool CommandParser::readNumber(double& value) {
+	string_view token;
+	if (!nextToken(token)) {
+		return error.empty() && fail("unexpected end of input, expected a number");
+	}
+	const char* first = token.data();
+	const char* last = first + token.size();
+	if (first != last && *first == '+') {
+		++first; // from_chars only takes a sign for negative numbers
+	}
+	auto [end, status] = from_chars(first, last, value);
+	if (status != errc() || end != last) {
+		return fail("'" + string(token) + "' is not a number");
+	}
+	return true;
+}
+
+// face/ring: the count, then the points, each handed to the modeler as soon
+// as it is read.
+bool CommandParser::loop(bool (Modeler::*begin)(const Point&)) {
+	size_t command_line = line, command_column = column;
+	size_t count = 0;
+	Point point;
+	if (!readCount(count, "point count")) {
+		return false;
+	}
+	if (count < 3) {
+		return fail("a loop needs at least 3 points");
+	}
+	if (!readPoint(point)) {
+		return false;
+	}
+	if (!(modeler->*begin)(point)) {
+		line = command_line;
+		column = command_column;
+		return fail(modeler->error);
+	}
+	for (size_t i = 1; i < count; ++i) {
+		if (!readPoint(point)) {
+			return false;
+		}
+		modeler->addPoint(point);
+	}
+	return modeler->endLoop() || fail(modeler->error);
+}
+
+bool CommandParser::fail(const string& message) {
+	error = message;
+	return false;
+}
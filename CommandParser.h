@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "FileWindow.h"
+#include "Modeler.h"
+
+// One-pass parser for the modeling command language (see Modeler). Tokens
+// are string_views into a FileWindow and numbers are converted with
+// from_chars, so parsing is locale independent and allocates nothing; every
+// point goes straight to the Modeler, so files of any size are read in the
+// memory of a single window.
+struct CommandParser {
+	explicit CommandParser(Modeler* _modeler) : modeler(_modeler) {}
+
+	// Parse a file ("-" reads stdin) or text already in memory; a parser is
+	// meant for a single input. Both return false on the first error and
+	// leave the position of the offending token in line and column and a
+	// description in error.
+	bool parseFile(const char* path, size_t window_size = size_t(1) << 24);
+	bool parse(const char* text, size_t length);
+
+	// Like parseFile, but builds the solids concurrently on up to `threads`
+	// threads (0 = one per core). Every `face` starts a solid that no later
+	// command before the next `face` can reach, so the script is split there,
+	// each part is built into a private Brep, and those are adopted by the
+	// modeler's Brep in file order, which numbers them as a sequential run
+	// would. The whole file is mapped at once; on an error the script is
+	// parsed again sequentially, so error reports and the partial model are
+	// the same as with parseFile.
+	bool parseFileParallel(const char* path, unsigned threads = 0);
+
+	Modeler* modeler;
+	size_t line = 0, column = 0; // 1-based, of the last token read
+	string error;
+
+private:
+	struct Section;
+
+	bool run();
+	bool parseSection(const char* text, const Section& section);
+	bool nextToken(string_view& token);
+	bool slide(size_t offset);
+	bool readCount(size_t& count, const char* what);
+	bool readPoint(Point& point);
+	bool readNumber(double& value);
+	bool loop(bool (Modeler::*begin)(const Point&));
+	bool fail(const string& message);
+
+	FileWindow window; // for parse() it just points at the caller's text
+	size_t pos = 0; // in the current window
+	size_t next_line = 1;
+	uint64_t line_start = 0; // file offset of the first byte of the current line
+};
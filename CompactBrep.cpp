@@ -0,0 +1,369 @@
+#include "CompactBrep.h"
+
+// Every entity knows its position in the solid's lists, so the conversion
+// is a few linear passes without lookup tables.
+CompactSolid::CompactSolid(const Solid* solid) {
+	auto index = [](const HalfEdge* he) {
+		return static_cast<uint32_t>(2 * he->edge->index + (he == he->edge->he2));
+	};
+	size_t half_edge_count = 2 * solid->edges.size();
+	x.reserve(solid->vertices.size());
+	y.reserve(solid->vertices.size());
+	z.reserve(solid->vertices.size());
+	for (const Vertex* vertex : solid->vertices) {
+		addVertex(vertex->point->x, vertex->point->y, vertex->point->z);
+	}
+	he_next.resize(half_edge_count);
+	he_prev.resize(half_edge_count);
+	he_vertex.resize(half_edge_count);
+	he_loop.resize(half_edge_count, NIL);
+	for (const Edge* edge : solid->edges) {
+		for (const HalfEdge* he : { edge->he1, edge->he2 }) {
+			uint32_t h = index(he);
+			he_vertex[h] = static_cast<uint32_t>(he->start->index);
+			he_next[h] = index(he->next);
+			he_prev[h] = index(he->pre);
+		}
+	}
+	face_outer.resize(solid->faces.size());
+	for (uint32_t f = 0; f < faceCount(); ++f) {
+		const Face* face = solid->faces[f];
+		uint32_t previous = NIL;
+		for (size_t k = 0; k <= face->inner_loops.size(); ++k) {
+			const Loop* loop = k == 0 ? face->outer_loop : face->inner_loops[k - 1];
+			uint32_t l = loopCount();
+			loop_first.push_back(loop->first_edge ? index(loop->first_edge) : NIL);
+			loop_face.push_back(f);
+			loop_next.push_back(NIL);
+			(previous == NIL ? face_outer[f] : loop_next[previous]) = l;
+			previous = l;
+			if (const HalfEdge* he = loop->first_edge) {
+				do {
+					he_loop[index(he)] = l;
+					he = he->next;
+				} while (he != loop->first_edge);
+			}
+		}
+	}
+}
+
+SolidView CompactSolid::view() const {
+	SolidView view;
+	view.vertex_count = vertexCount();
+	view.edge_count = edgeCount();
+	view.loop_count = loopCount();
+	view.face_count = faceCount();
+	view.x = x.data();
+	view.y = y.data();
+	view.z = z.data();
+	view.he_next = he_next.data();
+	view.he_prev = he_prev.data();
+	view.he_vertex = he_vertex.data();
+	view.he_loop = he_loop.data();
+	view.loop_first = loop_first.data();
+	view.loop_face = loop_face.data();
+	view.loop_next = loop_next.data();
+	view.face_outer = face_outer.data();
+	return view;
+}
+
+bool SolidView::valid() const {
+	uint32_t half_edge_count = 2 * edge_count;
+	if (edge_count > NIL / 2) {
+		return false;
+	}
+	for (uint32_t h = 0; h < half_edge_count; ++h) {
+		if (he_vertex[h] >= vertex_count || he_next[h] >= half_edge_count || he_prev[h] >= half_edge_count ||
+		    he_loop[h] >= loop_count) {
+			return false;
+		}
+	}
+	for (uint32_t l = 0; l < loop_count; ++l) {
+		if ((loop_first[l] != NIL && loop_first[l] >= half_edge_count) || loop_face[l] >= face_count ||
+		    (loop_next[l] != NIL && loop_next[l] >= loop_count)) {
+			return false;
+		}
+	}
+	// the chains of the faces must cover every loop exactly once
+	uint32_t chained = 0;
+	for (uint32_t f = 0; f < face_count; ++f) {
+		if (face_outer[f] >= loop_count) {
+			return false;
+		}
+		for (uint32_t l = face_outer[f]; l != NIL; l = loop_next[l]) {
+			if (l >= loop_count || loop_face[l] != f || ++chained > loop_count) {
+				return false;
+			}
+		}
+	}
+	if (chained != loop_count) {
+		return false;
+	}
+	// and every half-edge must lie on the cycle of its loop, which runs from
+	// loop_first back to it
+	uint32_t walked = 0;
+	for (uint32_t l = 0; l < loop_count; ++l) {
+		if (loop_first[l] == NIL) {
+			continue;
+		}
+		uint32_t h = loop_first[l];
+		do {
+			if (he_loop[h] != l || he_prev[he_next[h]] != h || ++walked > half_edge_count) {
+				return false;
+			}
+			h = he_next[h];
+		} while (h != loop_first[l]);
+	}
+	return walked == half_edge_count;
+}
+
+Solid* SolidView::expand(Brep& brep) const {
+	Solid* solid = new Solid(&brep.ids);
+	vector<Vertex*> vertices(vertex_count);
+	vector<HalfEdge*> half_edges(2 * size_t(edge_count));
+	vector<Loop*> loops(loop_count);
+	for (uint32_t v = 0; v < vertex_count; ++v) {
+		vertices[v] = solid->vertex_pool.create(x[v], y[v], z[v], solid);
+	}
+	for (uint32_t h = 0; h < half_edges.size(); ++h) {
+		half_edges[h] = solid->half_edge_pool.create(vertices[he_vertex[h]], vertices[end(h)]);
+		vertices[he_vertex[h]]->he = half_edges[h];
+	}
+	for (uint32_t e = 0; e < edge_count; ++e) {
+		solid->edge_pool.create(half_edges[2 * e], half_edges[2 * e + 1], solid);
+	}
+	for (uint32_t l = 0; l < loop_count; ++l) {
+		loops[l] = solid->loop_pool.create(solid);
+		loops[l]->first_edge = loop_first[l] == NIL ? nullptr : half_edges[loop_first[l]];
+	}
+	for (uint32_t f = 0; f < face_count; ++f) {
+		Face* face = solid->face_pool.create(loops[face_outer[f]], solid);
+		for (uint32_t l = loop_next[face_outer[f]]; l != NIL; l = loop_next[l]) {
+			loops[l]->face = face;
+			face->inner_loops.push_back(loops[l]);
+		}
+	}
+	for (uint32_t h = 0; h < half_edges.size(); ++h) {
+		half_edges[h]->next = half_edges[he_next[h]];
+		half_edges[h]->pre = half_edges[he_prev[h]];
+		half_edges[h]->loop = loops[he_loop[h]];
+	}
+	brep.solids.push_back(solid);
+	return solid;
+}
+
+uint32_t CompactSolid::MEV(uint32_t loop, uint32_t v1, double _x, double _y, double _z) {
+	uint32_t v2 = addVertex(_x, _y, _z);
+	uint32_t he1 = addEdge(v1, v2), he2 = he1 ^ 1;
+	he_loop[he1] = he_loop[he2] = loop;
+	he_next[he1] = he_prev[he1] = he2;
+	he_next[he2] = he_prev[he2] = he1;
+	loop_first[loop] = he1;
+	return v2;
+}
+
+uint32_t CompactSolid::MEV(uint32_t he, double _x, double _y, double _z) {
+	return MEV(he, addVertex(_x, _y, _z));
+}
+
+uint32_t CompactSolid::MEV(uint32_t he, uint32_t v2) {
+	uint32_t he1 = addEdge(end(he), v2), he2 = he1 ^ 1;
+	he_loop[he1] = he_loop[he2] = he_loop[he];
+	he_next[he2] = he_next[he];
+	he_prev[he_next[he2]] = he2;
+	he_next[he] = he1;
+	he_prev[he1] = he;
+	he_next[he1] = he2;
+	he_prev[he2] = he1;
+	return he1;
+}
+
+uint32_t CompactSolid::MEF(uint32_t he1, uint32_t he2) {
+	uint32_t loop = he_loop[he1];
+	uint32_t new_he1 = addEdge(end(he1), end(he2)), new_he2 = new_he1 ^ 1;
+
+	he_next[new_he1] = he_next[he2];
+	he_prev[new_he1] = he1;
+	he_next[new_he2] = he_next[he1];
+	he_prev[new_he2] = he2;
+	he_prev[he_next[new_he1]] = new_he1;
+	he_next[he1] = new_he1;
+	he_prev[he_next[new_he2]] = new_he2;
+	he_next[he2] = new_he2;
+
+	uint32_t new_face = addFace();
+	uint32_t new_loop = addLoop(new_face);
+
+	loop_first[new_loop] = new_he1;
+	loop_first[loop] = new_he2;
+	he_loop[new_he2] = loop;
+	uint32_t he = new_he1;
+	do {
+		he_loop[he] = new_loop;
+		he = he_next[he];
+	} while (he != new_he1);
+	return new_face;
+}
+
+uint32_t CompactSolid::KEMR(uint32_t he1) {
+	uint32_t he2 = he1 ^ 1;
+	uint32_t loop = he_loop[he1];
+
+	he_prev[he_next[he2]] = he_prev[he1];
+	he_next[he_prev[he1]] = he_next[he2];
+	he_prev[he_next[he1]] = he_prev[he2];
+	he_next[he_prev[he2]] = he_next[he1];
+
+	uint32_t new_loop = addLoop(loop_face[loop]);
+	loop_first[loop] = he_next[he1];
+	loop_first[new_loop] = he_next[he2];
+	uint32_t he = loop_first[new_loop];
+	do {
+		he_loop[he] = new_loop;
+		he = he_next[he];
+	} while (he != loop_first[new_loop]);
+
+	removeEdge(he1 >> 1);
+	return new_loop;
+}
+
+uint32_t CompactSolid::KFMRH(uint32_t outer_face, uint32_t inner_face) {
+	uint32_t last = faceCount() - 1;
+	uint32_t tail = face_outer[outer_face];
+	while (loop_next[tail] != NIL) {
+		tail = loop_next[tail];
+	}
+	loop_next[tail] = face_outer[inner_face];
+	for (uint32_t l = face_outer[inner_face]; l != NIL; l = loop_next[l]) {
+		loop_face[l] = outer_face;
+	}
+	removeFace(inner_face);
+	return outer_face == last ? inner_face : outer_face;
+}
+
+// Brep::sweep step for step. The loop indices stay put when KFMRH moves a
+// face, so the chain of face can be followed while the holes are merged.
+void CompactSolid::sweep(uint32_t face, double dx, double dy, double dz) {
+	uint32_t outer = face_outer[face];
+	uint32_t enclosed_face = loop_face[he_loop[loop_first[outer] ^ 1]];
+	extrudeLoop(loop_first[outer] ^ 1, dx, dy, dz);
+	for (uint32_t loop = loop_next[outer]; loop != NIL; loop = loop_next[loop]) {
+		uint32_t side = extrudeLoop(loop_first[loop] ^ 1, dx, dy, dz);
+		enclosed_face = KFMRH(enclosed_face, loop_face[he_loop[side]]);
+	}
+}
+
+uint32_t CompactSolid::addVertex(double _x, double _y, double _z) {
+	x.push_back(_x);
+	y.push_back(_y);
+	z.push_back(_z);
+	return vertexCount() - 1;
+}
+
+uint32_t CompactSolid::addEdge(uint32_t v1, uint32_t v2) {
+	uint32_t he = static_cast<uint32_t>(he_next.size());
+	he_vertex.push_back(v1);
+	he_vertex.push_back(v2);
+	he_next.resize(he + 2, NIL);
+	he_prev.resize(he + 2, NIL);
+	he_loop.resize(he + 2, NIL);
+	return he;
+}
+
+uint32_t CompactSolid::addLoop(uint32_t face) {
+	uint32_t loop = loopCount();
+	loop_first.push_back(NIL);
+	loop_face.push_back(face);
+	loop_next.push_back(NIL);
+	if (face_outer[face] == NIL) {
+		face_outer[face] = loop;
+	} else {
+		uint32_t tail = face_outer[face];
+		while (loop_next[tail] != NIL) {
+			tail = loop_next[tail];
+		}
+		loop_next[tail] = loop;
+	}
+	return loop;
+}
+
+uint32_t CompactSolid::addFace() {
+	face_outer.push_back(NIL);
+	return faceCount() - 1;
+}
+
+// The struts and faces come in Brep::extrudeLoop's order: the strut at the
+// end of first_side, then per side after it its strut and the face between
+// that strut and the one before, the face of first_side last.
+uint32_t CompactSolid::extrudeLoop(uint32_t first_side, double dx, double dy, double dz) {
+	uint32_t loop = he_loop[first_side];
+	auto makeStrut = [&](uint32_t side) {
+		uint32_t bottom = end(side);
+		return MEV(side, x[bottom] + dx, y[bottom] + dy, z[bottom] + dz);
+	};
+	uint32_t side = he_next[first_side]; // before the first strut goes in after it
+	uint32_t first_up = makeStrut(first_side);
+	uint32_t last_top = first_up; // on the loop, ending at the top of the last strut
+	for (;;) {
+		uint32_t following = he_next[side];
+		uint32_t up = side == first_side ? first_up : makeStrut(side);
+		MEF(up, last_top);
+		last_top = loop_first[loop];
+		if (side == first_side) {
+			break;
+		}
+		side = following;
+	}
+	return last_top;
+}
+
+void CompactSolid::removeEdge(uint32_t e) {
+	uint32_t last = edgeCount() - 1;
+	if (e != last) {
+		auto moved = [&](uint32_t he) {
+			return he >> 1 == last ? 2 * e + (he & 1) : he;
+		};
+		for (uint32_t k = 0; k < 2; ++k) {
+			uint32_t src = 2 * last + k, dst = 2 * e + k;
+			he_next[dst] = moved(he_next[src]);
+			he_prev[dst] = moved(he_prev[src]);
+			he_vertex[dst] = he_vertex[src];
+			he_loop[dst] = he_loop[src];
+		}
+		for (uint32_t k = 0; k < 2; ++k) {
+			uint32_t dst = 2 * e + k;
+			he_prev[he_next[dst]] = dst;
+			he_next[he_prev[dst]] = dst;
+			if (loop_first[he_loop[dst]] == 2 * last + k) {
+				loop_first[he_loop[dst]] = dst;
+			}
+		}
+	}
+	he_next.resize(2 * last);
+	he_prev.resize(2 * last);
+	he_vertex.resize(2 * last);
+	he_loop.resize(2 * last);
+}
+
+void CompactSolid::removeFace(uint32_t f) {
+	uint32_t last = faceCount() - 1;
+	if (f != last) {
+		face_outer[f] = face_outer[last];
+		for (uint32_t l = face_outer[f]; l != NIL; l = loop_next[l]) {
+			loop_face[l] = f;
+		}
+	}
+	face_outer.pop_back();
+}
+
+uint32_t CompactBrep::MVFS(double x, double y, double z) {
+	CompactSolid& solid = solids.emplace_back();
+	solid.x.push_back(x);
+	solid.y.push_back(y);
+	solid.z.push_back(z);
+	solid.face_outer.push_back(0);
+	solid.loop_first.push_back(NIL);
+	solid.loop_face.push_back(0);
+	solid.loop_next.push_back(NIL);
+	return static_cast<uint32_t>(solids.size() - 1);
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Brep.h"
+
+// Index-based, structure-of-arrays twin of Brep. Every entity of a solid is a
+// slot in a handful of parallel uint32_t/double arrays, so walking a loop
+// touches a few contiguous arrays instead of chasing seven pointers per
+// half-edge, and a whole solid can be written out array by array.
+//
+// Edge e owns half-edges 2e and 2e+1, which makes the twin of h simply h ^ 1
+// and saves both the edge table and a twin array. The loops of a face form a
+// singly linked chain that starts at the outer loop. Removals (KEMR, KFMRH)
+// move the last record into the hole, so indices are only stable until the
+// next killing operator.
+constexpr uint32_t NIL = 0xffffffffu;
+
+// Read-only arrays of one solid in the CompactSolid layout, wherever they
+// live: inside a CompactSolid or in place in a mapped .cbrep file.
+struct SolidView {
+	uint32_t vertex_count = 0, edge_count = 0, loop_count = 0, face_count = 0;
+	const double *x = nullptr, *y = nullptr, *z = nullptr;
+	const uint32_t *he_next = nullptr, *he_prev = nullptr, *he_vertex = nullptr, *he_loop = nullptr;
+	const uint32_t *loop_first = nullptr, *loop_face = nullptr, *loop_next = nullptr;
+	const uint32_t* face_outer = nullptr;
+
+	uint32_t end(uint32_t he) const {
+		return he_vertex[he ^ 1];
+	}
+
+	// Whether every stored index is in range, every face has an outer loop,
+	// the chains of the faces cover each loop once and the half-edges of a
+	// loop form one cycle through loop_first, which is all expand() needs;
+	// data read from disk should be checked first.
+	bool valid() const;
+
+	// Rebuilds the pointer representation of the solid inside brep, in time
+	// linear in its size.
+	Solid* expand(Brep& brep) const;
+};
+
+struct CompactSolid {
+	// vertices
+	vector<double> x, y, z;
+
+	// half-edges: he_vertex is the start vertex, the end is he_vertex[h ^ 1]
+	vector<uint32_t> he_next, he_prev, he_vertex, he_loop;
+
+	// loops
+	vector<uint32_t> loop_first, loop_face, loop_next;
+
+	// faces
+	vector<uint32_t> face_outer;
+
+	CompactSolid() = default;
+
+	// Converts a pointer solid; the indices follow solid->vertices, edges
+	// and faces, with the loops of each face numbered outer loop first.
+	explicit CompactSolid(const Solid* solid);
+
+	static uint32_t twin(uint32_t he) {
+		return he ^ 1;
+	}
+
+	uint32_t end(uint32_t he) const {
+		return he_vertex[he ^ 1];
+	}
+
+	uint32_t vertexCount() const {
+		return static_cast<uint32_t>(x.size());
+	}
+
+	uint32_t edgeCount() const {
+		return static_cast<uint32_t>(he_next.size() / 2);
+	}
+
+	uint32_t loopCount() const {
+		return static_cast<uint32_t>(loop_first.size());
+	}
+
+	uint32_t faceCount() const {
+		return static_cast<uint32_t>(face_outer.size());
+	}
+
+	SolidView view() const;
+
+	// Rebuilds the pointer representation of this solid inside brep.
+	Solid* expand(Brep& brep) const {
+		return view().expand(brep);
+	}
+
+	// The operators below mirror the half-edge overloads of Brep's and make
+	// the same topology, the same records in the same order. They are given
+	// the half-edges to work at, so none of them searches a loop: the cost
+	// is constant apart from relabelling the half-edges that change loop
+	// (MEF, KEMR) and appending to the loop chain of a face (KEMR, KFMRH).
+
+	// Starts the empty loop of a solid fresh from MVFS with the edge
+	// v1 -> new vertex; returns the vertex.
+	uint32_t MEV(uint32_t loop, uint32_t v1, double _x, double _y, double _z);
+
+	// Inserts the edge end(he) -> new vertex right after he and returns its
+	// half-edge in that direction.
+	uint32_t MEV(uint32_t he, double _x, double _y, double _z);
+
+	uint32_t MEV(uint32_t he, uint32_t v2);
+
+	// Joins end(he1) and end(he2), which must lie on the same loop. The new
+	// loop starts with the new half-edge end(he1) -> end(he2) and gets the
+	// new face, which is returned.
+	uint32_t MEF(uint32_t he1, uint32_t he2);
+
+	// Removes the edge of he1; the part of the loop hanging off end(he1)
+	// becomes a new inner loop of the face, which is returned.
+	uint32_t KEMR(uint32_t he1);
+
+	// Only the same-solid case exists here; merging two solids is a matter of
+	// concatenating their arrays and is left to the caller. Returns the index
+	// outer_face has after inner_face is removed.
+	uint32_t KFMRH(uint32_t outer_face, uint32_t inner_face);
+
+	void sweep(uint32_t face, double dx, double dy, double dz);
+
+private:
+	uint32_t addVertex(double _x, double _y, double _z);
+
+	// Appends the half-edge pair of a new edge and returns the v1 -> v2 half.
+	uint32_t addEdge(uint32_t v1, uint32_t v2);
+
+	uint32_t addLoop(uint32_t face);
+
+	uint32_t addFace();
+
+	// Brep::extrudeLoop by translation, with MEV and MEF: one strut per
+	// vertex and one lateral face per edge of first_side's loop, which is
+	// left running through the images. Returns its new first half-edge.
+	uint32_t extrudeLoop(uint32_t first_side, double dx, double dy, double dz);
+
+	// Fills the slot of edge e with the last edge and patches every reference
+	// to the moved half-edges.
+	void removeEdge(uint32_t e);
+
+	void removeFace(uint32_t f);
+};
+
+struct CompactBrep {
+	vector<CompactSolid> solids;
+
+	// Returns the solid index; its first vertex, face and loop are all 0.
+	uint32_t MVFS(double x, double y, double z);
+};
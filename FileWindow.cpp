@@ -0,0 +1,193 @@
+#include "FileWindow.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+FileWindow::~FileWindow() {
+	unmap();
+#ifdef _WIN32
+	if (mapping) {
+		CloseHandle(mapping);
+	}
+	if (file) {
+		CloseHandle(file);
+	}
+#else
+	if (fd >= 0) {
+		close(fd);
+	}
+#endif
+	if (stream && close_stream) {
+		fclose(stream);
+	}
+}
+
+bool FileWindow::open(const char* path, string& error, size_t _window_size) {
+	window_size = _window_size ? max<size_t>(_window_size, 64) : 0;
+	bool from_stdin = strcmp(path, "-") == 0;
+	if (!from_stdin) {
+#ifdef _WIN32
+		HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		                            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (handle == INVALID_HANDLE_VALUE) {
+			error = string(path) + ": cannot open";
+			return false;
+		}
+		file = handle;
+		LARGE_INTEGER length;
+		if (GetFileType(handle) == FILE_TYPE_DISK && GetFileSizeEx(handle, &length)) {
+			file_size = static_cast<uint64_t>(length.QuadPart);
+			// empty files cannot be mapped but need no view either
+			mapping = file_size ? CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+			mapped = file_size == 0 || mapping != nullptr;
+		}
+#else
+		fd = ::open(path, O_RDONLY);
+		if (fd < 0) {
+			error = string(path) + ": " + strerror(errno);
+			return false;
+		}
+		struct stat info;
+		if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+			file_size = static_cast<uint64_t>(info.st_size);
+			mapped = true;
+		}
+#endif
+	}
+	if (mapped) {
+		return map(0, error);
+	}
+
+	if (from_stdin) {
+		stream = stdin;
+	} else {
+#ifdef _WIN32
+		CloseHandle(file);
+		file = nullptr;
+		stream = fopen(path, "rb");
+#else
+		stream = fdopen(fd, "rb");
+		fd = -1;
+#endif
+		close_stream = true;
+		if (stream == nullptr) {
+			error = string(path) + ": cannot open";
+			return false;
+		}
+	}
+	if (window_size == 0) {
+		return readAll(error);
+	}
+	buffer.resize(window_size);
+	data = buffer.data();
+	size = 0;
+	last = false;
+	return read(0, error);
+}
+
+bool FileWindow::slide(uint64_t from, string& error) {
+	return mapped ? map(from, error) : read(from, error);
+}
+
+bool FileWindow::map(uint64_t from, string& error) {
+	unmap();
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	uint64_t granularity = info.dwAllocationGranularity;
+#else
+	uint64_t granularity = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+	uint64_t aligned = from - from % granularity;
+	uint64_t wanted = window_size ? window_size + (from - aligned) : file_size - aligned;
+	size_t length = static_cast<size_t>(min<uint64_t>(wanted, file_size - aligned));
+	start = from;
+	if (length <= from - aligned) {
+		data = nullptr;
+		size = 0;
+		last = true;
+		return true;
+	}
+#ifdef _WIN32
+	view = MapViewOfFile(mapping, FILE_MAP_READ, static_cast<DWORD>(aligned >> 32), static_cast<DWORD>(aligned),
+	                     length);
+	if (view == nullptr) {
+		error = "cannot map the file";
+		return false;
+	}
+#else
+	view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(aligned));
+	if (view == MAP_FAILED) {
+		view = nullptr;
+		error = string("cannot map the file: ") + strerror(errno);
+		return false;
+	}
+	madvise(view, length, MADV_SEQUENTIAL);
+#endif
+	view_size = length;
+	data = static_cast<const char*>(view) + (from - aligned);
+	size = length - static_cast<size_t>(from - aligned);
+	last = from + size == file_size;
+	return true;
+}
+
+// Keeps the unread tail [from, start + size) at the front of the buffer and
+// fills up the rest.
+bool FileWindow::read(uint64_t from, string& error) {
+	size_t keep = static_cast<size_t>(start + size - from);
+	memmove(buffer.data(), buffer.data() + (from - start), keep);
+	size_t count = last ? 0 : fread(buffer.data() + keep, 1, buffer.size() - keep, stream);
+	if (keep + count < buffer.size()) {
+		if (stream && ferror(stream)) {
+			error = string("read error: ") + strerror(errno);
+			return false;
+		}
+		last = true;
+	}
+	start = from;
+	size = keep + count;
+	return true;
+}
+
+// The whole stream into a buffer that grows as needed, for window_size 0.
+bool FileWindow::readAll(string& error) {
+	buffer.resize(size_t(1) << 16);
+	size_t count = 0;
+	while (size_t got = fread(buffer.data() + count, 1, buffer.size() - count, stream)) {
+		count += got;
+		if (count == buffer.size()) {
+			buffer.resize(2 * buffer.size());
+		}
+	}
+	if (ferror(stream)) {
+		error = string("read error: ") + strerror(errno);
+		return false;
+	}
+	data = buffer.data();
+	size = count;
+	start = 0;
+	last = true;
+	return true;
+}
+
+void FileWindow::unmap() {
+	if (view) {
+#ifdef _WIN32
+		UnmapViewOfFile(view);
+#else
+		munmap(view, view_size);
+#endif
+		view = nullptr;
+	}
+}
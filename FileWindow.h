@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Read-only view of a file through a window of bounded size that only moves
+// forward. Regular files are memory-mapped a window at a time, so reading
+// them copies nothing; anything that cannot be mapped (pipes, "-" for stdin)
+// is read into a buffer of the same size instead. Either way memory use stays
+// at about one window however large the file is.
+struct FileWindow {
+	FileWindow() = default;
+	FileWindow(const FileWindow&) = delete;
+	FileWindow& operator=(const FileWindow&) = delete;
+	~FileWindow();
+
+	// Opens the file and loads the first window; a window_size of 0 makes the
+	// window the whole file. Returns false and fills in error if the file
+	// cannot be opened or read.
+	bool open(const char* path, string& error, size_t window_size = size_t(1) << 24);
+
+	// Moves the window so that it starts at file offset `from`, which must lie
+	// inside the current window or right after it.
+	bool slide(uint64_t from, string& error);
+
+	const char* data = nullptr; // file bytes [start, start + size)
+	size_t size = 0;
+	uint64_t start = 0;
+	bool last = true; // the window reaches the end of the file
+
+private:
+	bool map(uint64_t from, string& error);
+	bool read(uint64_t from, string& error);
+	bool readAll(string& error);
+	void unmap();
+
+	size_t window_size = 0;
+	uint64_t file_size = 0;
+	bool mapped = false;
+	void* view = nullptr;
+	size_t view_size = 0;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#else
+	int fd = -1;
+#endif
+	FILE* stream = nullptr; // unmappable input
+	bool close_stream = false;
+	vector<char> buffer;
+};
@@ -0,0 +1,196 @@
+#include "MassProperties.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Parallel.h"
+
+namespace {
+
+// integrals over one face, relative to the origin of its solid, before the
+// constant factors
+struct FaceSums {
+	double newell[3] = { 0, 0, 0 }; // twice the vector area
+	double volume = 0; // 6 times
+	double first[3] = { 0, 0, 0 }; // 24 times the first moments
+	double second[6] = { 0, 0, 0, 0, 0, 0 }; // 120 times xx, yy, zz, xy, yz, zx
+};
+
+constexpr size_t lanes = 4;
+
+// edges a -> b of the loops of one face, one array per coordinate
+struct EdgeBuffer {
+	vector<double> ax, ay, az, bx, by, bz;
+
+	void clear() {
+		ax.clear();
+		ay.clear();
+		az.clear();
+		bx.clear();
+		by.clear();
+		bz.clear();
+	}
+
+	void push(const Point& a, const Point& b, const double* origin) {
+		ax.push_back(a.x - origin[0]);
+		ay.push_back(a.y - origin[1]);
+		az.push_back(a.z - origin[2]);
+		bx.push_back(b.x - origin[0]);
+		by.push_back(b.y - origin[1]);
+		bz.push_back(b.z - origin[2]);
+	}
+};
+
+FaceSums sumFace(const Face* face, const double* origin, EdgeBuffer& edges) {
+	FaceSums sums;
+	const HalfEdge* first = face->outer_loop->first_edge;
+	if (first == nullptr) {
+		return sums; // a lone vertex (MVFS)
+	}
+	edges.clear();
+	for (size_t l = 0; l <= face->inner_loops.size(); ++l) {
+		const Loop* loop = l == 0 ? face->outer_loop : face->inner_loops[l - 1];
+		const HalfEdge* he = loop->first_edge;
+		do {
+			edges.push(*he->start->point, *he->end->point, origin);
+			he = he->next;
+		} while (he != loop->first_edge);
+	}
+	// every edge spans a triangle with the apex; edges from the apex to
+	// itself span nothing and fill up the last batch
+	const Point& apex = *first->start->point;
+	while (edges.ax.size() % lanes) {
+		edges.push(apex, apex, origin);
+	}
+	const double cx = apex.x - origin[0], cy = apex.y - origin[1], cz = apex.z - origin[2];
+	const double *ax = edges.ax.data(), *ay = edges.ay.data(), *az = edges.az.data();
+	const double *bx = edges.bx.data(), *by = edges.by.data(), *bz = edges.bz.data();
+
+	double sum[13][lanes] = {};
+	for (size_t i = 0; i < edges.ax.size(); i += lanes) {
+		for (size_t k = 0; k < lanes; ++k) {
+			size_t j = i + k;
+			// vector area of the triangle (c, a, b)...
+			double ux = ax[j] - cx, uy = ay[j] - cy, uz = az[j] - cz;
+			double vx = bx[j] - cx, vy = by[j] - cy, vz = bz[j] - cz;
+			sum[0][k] += uy * vz - uz * vy;
+			sum[1][k] += uz * vx - ux * vz;
+			sum[2][k] += ux * vy - uy * vx;
+			// ...and the integrals over the tetrahedron (origin, c, a, b):
+			// volume det / 6, first moments det / 24 * s and second moments
+			// det / 120 * (c c + a a + b b + s s) with s = c + a + b
+			double det = cx * (ay[j] * bz[j] - az[j] * by[j]) + cy * (az[j] * bx[j] - ax[j] * bz[j]) +
+			             cz * (ax[j] * by[j] - ay[j] * bx[j]);
+			double sx = cx + ax[j] + bx[j], sy = cy + ay[j] + by[j], sz = cz + az[j] + bz[j];
+			sum[3][k] += det;
+			sum[4][k] += det * sx;
+			sum[5][k] += det * sy;
+			sum[6][k] += det * sz;
+			sum[7][k] += det * (cx * cx + ax[j] * ax[j] + bx[j] * bx[j] + sx * sx);
+			sum[8][k] += det * (cy * cy + ay[j] * ay[j] + by[j] * by[j] + sy * sy);
+			sum[9][k] += det * (cz * cz + az[j] * az[j] + bz[j] * bz[j] + sz * sz);
+			sum[10][k] += det * (cx * cy + ax[j] * ay[j] + bx[j] * by[j] + sx * sy);
+			sum[11][k] += det * (cy * cz + ay[j] * az[j] + by[j] * bz[j] + sy * sz);
+			sum[12][k] += det * (cz * cx + az[j] * ax[j] + bz[j] * bx[j] + sz * sx);
+		}
+	}
+	double total[13];
+	for (int t = 0; t < 13; ++t) {
+		total[t] = (sum[t][0] + sum[t][1]) + (sum[t][2] + sum[t][3]);
+	}
+	copy(total, total + 3, sums.newell);
+	sums.volume = total[3];
+	copy(total + 4, total + 7, sums.first);
+	copy(total + 7, total + 13, sums.second);
+	return sums;
+}
+
+MassProperties combine(const FaceSums* faces, size_t count, const double* origin) {
+	FaceSums solid;
+	MassProperties result;
+	for (size_t i = 0; i < count; ++i) {
+		const FaceSums& face = faces[i];
+		result.area += 0.5 * sqrt(face.newell[0] * face.newell[0] + face.newell[1] * face.newell[1] +
+		                          face.newell[2] * face.newell[2]);
+		solid.volume += face.volume;
+		for (int j = 0; j < 3; ++j) {
+			solid.first[j] += face.first[j];
+		}
+		for (int j = 0; j < 6; ++j) {
+			solid.second[j] += face.second[j];
+		}
+	}
+	result.volume = solid.volume / 6;
+	double g[3] = { 0, 0, 0 }; // centroid relative to the origin
+	if (result.volume != 0) {
+		for (int j = 0; j < 3; ++j) {
+			g[j] = solid.first[j] / 24 / result.volume;
+		}
+	}
+	for (int j = 0; j < 3; ++j) {
+		result.centroid[j] = origin[j] + g[j];
+	}
+	// second moments about the centroid (parallel axis theorem), then the
+	// tensor: diagonal the sum of the other two, off the diagonal negated
+	static const int row[6] = { 0, 1, 2, 0, 1, 2 };
+	static const int column[6] = { 0, 1, 2, 1, 2, 0 };
+	double moment[3][3];
+	for (int j = 0; j < 6; ++j) {
+		int r = row[j], c = column[j];
+		moment[r][c] = moment[c][r] = solid.second[j] / 120 - result.volume * g[r] * g[c];
+	}
+	for (int r = 0; r < 3; ++r) {
+		for (int c = 0; c < 3; ++c) {
+			result.inertia[r][c] = r == c ? moment[(r + 1) % 3][(r + 1) % 3] + moment[(r + 2) % 3][(r + 2) % 3]
+			                              : -moment[r][c];
+		}
+	}
+	return result;
+}
+
+void compute(const Solid* const* solids, size_t count, MassProperties* results, unsigned threads) {
+	// each solid is integrated about the centre of its box, which keeps the
+	// products small and accurate far from the world origin (box() may update
+	// its cache, so this is done here rather than on the workers)
+	vector<double> origins(3 * count, 0.0);
+	vector<size_t> starts(count + 1, 0); // first face of every solid in the pass
+	for (size_t s = 0; s < count; ++s) {
+		const Box& box = solids[s]->box();
+		if (!box.empty()) {
+			for (int j = 0; j < 3; ++j) {
+				origins[3 * s + j] = 0.5 * (box.min[j] + box.max[j]);
+			}
+		}
+		starts[s + 1] = starts[s] + solids[s]->faces.size();
+	}
+
+	vector<FaceSums> sums(starts[count]);
+	parallelFor(sums.size(), [&](size_t begin, size_t end) {
+		EdgeBuffer edges;
+		size_t s = upper_bound(starts.begin(), starts.end(), begin) - starts.begin() - 1;
+		for (size_t i = begin; i < end; ++i) {
+			while (i >= starts[s + 1]) {
+				++s;
+			}
+			sums[i] = sumFace(solids[s]->faces[i - starts[s]], &origins[3 * s], edges);
+		}
+	}, threads, 16);
+
+	for (size_t s = 0; s < count; ++s) {
+		results[s] = combine(sums.data() + starts[s], starts[s + 1] - starts[s], &origins[3 * s]);
+	}
+}
+
+} // namespace
+
+MassProperties massProperties(const Solid* solid, unsigned threads) {
+	MassProperties result;
+	compute(&solid, 1, &result, threads);
+	return result;
+}
+
+vector<MassProperties> massProperties(const Brep& brep, unsigned threads) {
+	vector<MassProperties> results(brep.solids.size());
+	compute(brep.solids.data(), brep.solids.size(), results.data(), threads);
+	return results;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Brep.h"
+
+// Volume, surface area, centroid and inertia tensor of a solid of unit
+// density (scale volume and inertia by the density for a mass). Volume and
+// inertia come out negative for a solid whose faces point inwards; the
+// centroid does not depend on the orientation.
+struct MassProperties {
+	double volume = 0;
+	double area = 0;
+	double centroid[3] = { 0, 0, 0 }; // the centre of the box for a solid without volume
+	double inertia[3][3] = { { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } }; // about the centroid
+};
+
+// Integrates over the faces' loops with the divergence theorem, no
+// triangulation needed: every edge of a face, inner loops included, spans a
+// triangle with the face's first vertex and that triangle a tetrahedron with
+// a point near the solid, whose integrals add up to the solid's (the inner
+// loops run the other way and take their holes back out). The edges of a
+// face are copied into contiguous coordinate arrays and summed four at a
+// time in independent lanes, which compilers turn into SIMD code without
+// reordering the additions, so results do not depend on the flags. Faces
+// are spread over `threads` threads (0 = one per core); their sums are
+// added in face order, so the result does not depend on the thread count
+// either. Faces must be planar.
+MassProperties massProperties(const Solid* solid, unsigned threads = 0);
+
+// The properties of every solid of brep, in solid order, with the faces of
+// all solids in one parallel pass so many small solids balance as well as a
+// few big ones.
+vector<MassProperties> massProperties(const Brep& brep, unsigned threads = 0);
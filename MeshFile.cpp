@@ -0,0 +1,278 @@
+#include "MeshFile.h"
+
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "Parallel.h"
+#include "Tessellator.h"
+
+namespace {
+
+constexpr size_t batch_items = 4096; // encoded in parallel, then written in one go
+constexpr size_t vertex_run = 1024; // OBJ vertices per item
+constexpr size_t large_item = 4096; // bytes of an item buffer that is freed once written rather than kept
+constexpr size_t file_buffer = size_t(1) << 20;
+
+// One piece of output: a face, or for OBJ the vertices [first, last) of a
+// solid.
+struct Item {
+	const Solid* solid;
+	const Face* face; // nullptr for vertices
+	size_t first, last;
+	uint64_t base; // OBJ number of the solid's first vertex
+	uint64_t normal; // OBJ number of the face's normal
+};
+
+// Walks the solids in order and hands out the items a batch at a time, so
+// no list of the whole model is ever built.
+struct Cursor {
+	const Brep& brep;
+	bool vertices; // put each solid's vertices before its faces
+	size_t solid = 0;
+	size_t next = 0; // in the solid: vertex next, or face next minus the vertex count
+	uint64_t base = 1;
+	uint64_t normal = 1;
+
+	bool fill(vector<Item>& items) {
+		items.clear();
+		while (items.size() < batch_items && solid < brep.solids.size()) {
+			const Solid* s = brep.solids[solid];
+			size_t vertex_count = vertices ? s->vertices.size() : 0;
+			if (next < vertex_count) {
+				size_t last = min(vertex_count, next + vertex_run);
+				items.push_back({ s, nullptr, next, last, base, 0 });
+				next = last;
+			} else if (next - vertex_count < s->faces.size()) {
+				const Face* face = s->faces[next++ - vertex_count];
+				if (face->outer_loop->first_edge) { // not a lone vertex (MVFS)
+					items.push_back({ s, face, 0, 0, base, normal++ });
+				}
+			} else {
+				base += vertex_count;
+				++solid;
+				next = 0;
+			}
+		}
+		return !items.empty();
+	}
+};
+
+// per worker, kept for the whole export
+struct Scratch {
+	Tessellator tessellator;
+	TriangleMesh mesh;
+	vector<uint64_t> corners; // OBJ vertex number of every mesh vertex
+};
+
+// Encodes the items of one batch on the workers and writes them in order
+// on a thread of its own while the next batch is encoded.
+template <typename Encode>
+bool stream(FILE* file, Cursor cursor, unsigned threads, Encode encode) {
+	threads = workerCount(threads);
+	// a chunk borrows an idle scratch; no more than `threads` chunks run at
+	// once, so every one finds one
+	vector<Scratch> scratch(threads);
+	vector<Scratch*> idle;
+	for (Scratch& s : scratch) {
+		idle.push_back(&s);
+	}
+	mutex idle_lock;
+	vector<Item> items[2];
+	vector<vector<char>> bytes[2];
+	bool ok = true; // only touched by one writer at a time
+	// the buffers are kept for the next batch, except the ones of big faces,
+	// which would otherwise pile up slot by slot
+	auto write = [file, &ok](vector<vector<char>>& out, size_t count) {
+		for (size_t i = 0; i < count && ok; ++i) {
+			ok = fwrite(out[i].data(), 1, out[i].size(), file) == out[i].size();
+			if (out[i].capacity() > large_item) {
+				vector<char>().swap(out[i]);
+			}
+		}
+	};
+	thread writer;
+	for (int b = 0; cursor.fill(items[b]); b ^= 1) {
+		if (bytes[b].size() < items[b].size()) {
+			bytes[b].resize(items[b].size());
+		}
+		parallelFor(items[b].size(), [&](size_t begin, size_t end) {
+			Scratch* own;
+			{
+				lock_guard<mutex> lock(idle_lock);
+				own = idle.back();
+				idle.pop_back();
+			}
+			for (size_t i = begin; i < end; ++i) {
+				bytes[b][i].clear();
+				encode(items[b][i], *own, bytes[b][i]);
+			}
+			lock_guard<mutex> lock(idle_lock);
+			idle.push_back(own);
+		}, threads);
+		if (writer.joinable()) {
+			writer.join();
+		}
+		if (!ok) {
+			break;
+		}
+		if (threads == 1) {
+			write(bytes[b], items[b].size());
+		} else {
+			writer = thread(write, ref(bytes[b]), items[b].size());
+		}
+	}
+	if (writer.joinable()) {
+		writer.join();
+	}
+	return ok;
+}
+
+FILE* create(const char* path, string& error) {
+	FILE* file = fopen(path, "wb");
+	if (file == nullptr) {
+		error = string(path) + ": " + strerror(errno);
+		return nullptr;
+	}
+	setvbuf(file, nullptr, _IOFBF, file_buffer);
+	return file;
+}
+
+bool finish(FILE* file, bool ok, const char* path, string& error) {
+	if (fclose(file) != 0) {
+		ok = false;
+	}
+	if (!ok && error.empty()) {
+		error = string(path) + ": write error";
+	}
+	return ok;
+}
+
+// STL is little endian whatever the machine
+void putLittleEndian(char* out, uint32_t value) {
+	for (int i = 0; i < 4; ++i) {
+		out[i] = static_cast<char>(value >> 8 * i);
+	}
+}
+
+void putLittleEndian(char* out, float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	putLittleEndian(out, bits);
+}
+
+template <typename T>
+void append(vector<char>& out, T value) {
+	char text[32];
+	out.insert(out.end(), text, to_chars(text, text + sizeof(text), value).ptr);
+}
+
+void append(vector<char>& out, const char* text) {
+	out.insert(out.end(), text, text + strlen(text));
+}
+
+} // namespace
+
+bool writeStlFile(const char* path, const Brep& brep, string& error, unsigned threads) {
+	error.clear();
+	FILE* file = create(path, error);
+	if (file == nullptr) {
+		return false;
+	}
+	char header[80] = "binary STL written by CADbrep";
+	char count[4] = {};
+	bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+	          fwrite(count, 1, sizeof(count), file) == sizeof(count);
+	atomic<uint64_t> triangles(0);
+	ok = ok && stream(file, { brep, false }, threads, [&](const Item& item, Scratch& scratch, vector<char>& out) {
+		TriangleMesh& mesh = scratch.mesh;
+		mesh.clear();
+		scratch.tessellator.triangulate(item.face, mesh);
+		out.resize(50 * mesh.triangleCount());
+		char* record = out.data();
+		for (size_t i = 0; i < mesh.indices.size(); i += 3, record += 50) {
+			for (int k = 0; k < 3; ++k) {
+				putLittleEndian(record + 4 * k, static_cast<float>(mesh.normals[k]));
+				for (int c = 0; c < 3; ++c) {
+					putLittleEndian(record + 4 * (3 + 3 * c + k),
+					                static_cast<float>(mesh.positions[3 * mesh.indices[i + c] + k]));
+				}
+			}
+			record[48] = record[49] = 0; // attribute byte count
+		}
+		triangles.fetch_add(mesh.triangleCount(), memory_order_relaxed);
+	});
+	if (ok && triangles > UINT32_MAX) {
+		error = string(path) + ": too many triangles for STL";
+		ok = false;
+	}
+	putLittleEndian(count, static_cast<uint32_t>(triangles));
+	ok = ok && fseek(file, sizeof(header), SEEK_SET) == 0 && fwrite(count, 1, sizeof(count), file) == sizeof(count);
+	return finish(file, ok, path, error);
+}
+
+bool writeObjFile(const char* path, const Brep& brep, string& error, unsigned threads) {
+	error.clear();
+	FILE* file = create(path, error);
+	if (file == nullptr) {
+		return false;
+	}
+	const char header[] = "# written by CADbrep\n";
+	bool ok = fwrite(header, 1, sizeof(header) - 1, file) == sizeof(header) - 1;
+	ok = ok && stream(file, { brep, true }, threads, [](const Item& item, Scratch& scratch, vector<char>& out) {
+		if (item.face == nullptr) {
+			if (item.first == 0) {
+				append(out, "o solid");
+				append(out, item.solid->SolidId);
+				out.push_back('\n');
+			}
+			for (size_t i = item.first; i < item.last; ++i) {
+				const Point* p = item.solid->vertices[i]->point;
+				append(out, "v ");
+				append(out, p->x);
+				out.push_back(' ');
+				append(out, p->y);
+				out.push_back(' ');
+				append(out, p->z);
+				out.push_back('\n');
+			}
+			return;
+		}
+		const Face* face = item.face;
+		TriangleMesh& mesh = scratch.mesh;
+		mesh.clear();
+		scratch.tessellator.triangulate(face, mesh);
+		// the mesh vertices are the loops' vertices in order
+		scratch.corners.clear();
+		for (size_t l = 0; l <= face->inner_loops.size(); ++l) {
+			const Loop* loop = l == 0 ? face->outer_loop : face->inner_loops[l - 1];
+			const HalfEdge* he = loop->first_edge;
+			do {
+				scratch.corners.push_back(item.base + he->start->index);
+				he = he->next;
+			} while (he != loop->first_edge);
+		}
+		append(out, "vn ");
+		for (int k = 0; k < 3; ++k) {
+			append(out, mesh.normals[k]);
+			out.push_back(k < 2 ? ' ' : '\n');
+		}
+		for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+			out.push_back('f');
+			for (int c = 0; c < 3; ++c) {
+				out.push_back(' ');
+				append(out, scratch.corners[mesh.indices[i + c]]);
+				append(out, "//");
+				append(out, item.normal);
+			}
+			out.push_back('\n');
+		}
+	});
+	return finish(file, ok, path, error);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+
+#include "Brep.h"
+
+// Triangle mesh files for other tools: binary STL and OBJ. Every face is
+// triangulated (outer loop and holes, see Tessellator) and written out as it
+// comes, never as a mesh of the whole model. Faces are taken a batch at a
+// time and triangulated and encoded on `threads` threads (0 = one per core)
+// while the batch before goes to disk through a large stdio buffer, so
+// memory stays at two batches however big the Brep is and the file comes
+// out the same for any thread count.
+//
+// STL: the usual 80-byte header, triangle count and 50 bytes per triangle
+// (float normal and corners), all little endian as the format requires on
+// any machine, the normal being the face's. The count is filled in at the
+// end, so path must be a seekable file.
+//
+// OBJ: one object per solid ("o solid<id>") with the solid's vertices, then
+// one normal per face and its triangles as "f a//n b//n c//n", so the
+// vertices are shared between the faces as in the Brep. Numbers are written
+// in the shortest form that reads back to the same double.
+
+// Each returns false and fills in error if the file cannot be written.
+bool writeStlFile(const char* path, const Brep& brep, string& error, unsigned threads = 0);
+bool writeObjFile(const char* path, const Brep& brep, string& error, unsigned threads = 0);
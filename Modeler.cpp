@@ -0,0 +1,116 @@
+#include "Modeler.h"
+
+namespace {
+
+// Newell vector of the points first->start, ..., last->end taken as a
+// closed loop, dotted with normal: positive when they turn the way normal
+// points.
+double turn(const HalfEdge* first, const HalfEdge* last, const double* normal) {
+	double n[3] = { 0, 0, 0 };
+	auto add = [&n](const Point* a, const Point* b) {
+		n[0] += (a->y - b->y) * (a->z + b->z);
+		n[1] += (a->z - b->z) * (a->x + b->x);
+		n[2] += (a->x - b->x) * (a->y + b->y);
+	};
+	for (const HalfEdge* he = first; he != last; he = he->next) {
+		add(he->start->point, he->end->point);
+	}
+	add(last->start->point, last->end->point);
+	add(last->end->point, first->start->point);
+	return n[0] * normal[0] + n[1] * normal[1] + n[2] * normal[2];
+}
+
+} // namespace
+
+bool Modeler::beginFace(const Point& first_point) {
+	first_vertex = brep->MVFS(first_point.x, first_point.y, first_point.z);
+	loop = brep->solids.back()->faces[0]->outer_loop;
+	building = Building::face;
+	points = 1;
+	return true;
+}
+
+// The ring hangs off the first vertex of the face's solid through a bridge
+// edge that endLoop kills again once the ring is closed.
+bool Modeler::beginRing(const Point& first_point) {
+	if (face == nullptr) {
+		return fail("ring before any face");
+	}
+	loop = face->outer_loop;
+	first_vertex = brep->MEV(loop, face->solid->vertices[0], first_point.x, first_point.y, first_point.z);
+	bridge = last = first_vertex->he->partner;
+	building = Building::ring;
+	points = 1;
+	return true;
+}
+
+void Modeler::addPoint(const Point& point) {
+	if (building == Building::face && points == 1) {
+		brep->MEV(loop, first_vertex, point.x, point.y, point.z);
+		last = loop->first_edge;
+	} else {
+		last = brep->MEV(last, point.x, point.y, point.z);
+	}
+	if (points == 1) {
+		first = last;
+	}
+	++points;
+}
+
+bool Modeler::endLoop() {
+	if (points < 3) {
+		return fail("a loop needs at least three points");
+	}
+	if (building == Building::face) {
+		face = brep->MEF(last, first->partner);
+	} else {
+		// The points run first -> last on one side of the hair hanging off
+		// the bridge and back on the other. Closing the ring at the end of
+		// first->partner leaves the face with the points in the order given,
+		// closing it at the end of the bridge with the reverse; either way
+		// the face keeps the bridge. Rings may be given in either winding and
+		// the face takes the one running against its outer loop, so the ring
+		// bounds a hole.
+		if (turn(first, last, face->plane().normal) > 0) {
+			brep->MEF(last, bridge);
+		} else {
+			brep->MEF(first->partner, last);
+		}
+		brep->KEMR(bridge->partner);
+	}
+	building = Building::nothing;
+	++commands;
+	brep->endStep();
+	return true;
+}
+
+bool Modeler::sweep(const Point& direction) {
+	if (face == nullptr) {
+		return fail("sweep before any face");
+	}
+	brep->sweep(face, direction.x, direction.y, direction.z);
+	++commands;
+	brep->endStep();
+	return true;
+}
+
+bool Modeler::revolve(const Point& axis_point, const Point& axis_direction, double degrees, size_t segments) {
+	if (face == nullptr) {
+		return fail("revolve before any face");
+	}
+	if (axis_direction.x == 0 && axis_direction.y == 0 && axis_direction.z == 0) {
+		return fail("the axis of a revolve needs a direction");
+	}
+	if (segments == 0 || segments > 1000000) {
+		return fail("a revolve needs between 1 and 1000000 segments");
+	}
+	brep->revolve(face, axis_point, axis_direction, degrees * 3.14159265358979323846 / 180, static_cast<int>(segments));
+	++commands;
+	brep->endStep();
+	return true;
+}
+
+bool Modeler::fail(const char* message) {
+	error = message;
+	return false;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+
+#include "Brep.h"
+
+// Executes the modeling command language of input.txt against a Brep:
+//   face n   followed by n points: new solid bounded by that polygon
+//   ring n   followed by n points: hole in the current face, in either
+//            winding
+//   sweep    followed by a vector: extrudes the current face
+//   revolve  followed by a point and a direction (the axis), an angle in
+//            degrees and a segment count: turns the current face about the
+//            axis; 360 closes the solid into a ring
+//   finish   ends the script (so does the end of the input)
+// The current face is the one made by the last `face` command. Every
+// command is one step of the Brep's journal, so undo takes back a whole
+// command.
+//
+// Loops are fed one point at a time (beginFace/beginRing, addPoint, endLoop)
+// and every point becomes an Euler operator right away, so a parser never
+// has to buffer a command. See CommandParser for the text front end.
+struct Modeler {
+	explicit Modeler(Brep* _brep) : brep(_brep) {}
+
+	// Each returns false and fills in error when the command cannot be
+	// applied, e.g. a ring or sweep before the first face.
+	bool beginFace(const Point& first);
+	bool beginRing(const Point& first);
+	void addPoint(const Point& point);
+	bool endLoop(); // needs at least three points
+	bool sweep(const Point& direction);
+	bool revolve(const Point& axis_point, const Point& axis_direction, double degrees, size_t segments);
+
+	Brep* brep;
+	Face* face = nullptr;
+	size_t commands = 0; // commands completed so far
+	string error;
+
+private:
+	enum class Building { nothing, face, ring };
+
+	bool fail(const char* message);
+
+	Building building = Building::nothing;
+	size_t points = 0;
+	Loop* loop = nullptr;
+	Vertex* first_vertex = nullptr;
+	HalfEdge* bridge = nullptr; // ring only: first vertex of the face -> first ring point
+	HalfEdge* first = nullptr; // first -> second point
+	HalfEdge* last = nullptr; // ends at the newest point
+};
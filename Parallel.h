@@ -0,0 +1,41 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Number of threads to use when a caller asks for 0 (= one per core).
+inline unsigned workerCount(unsigned threads = 0) {
+	return threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Runs body(begin, end) over chunks of [0, count) on up to `threads` threads.
+// Chunks are handed out dynamically so uneven work still balances; the calling
+// thread takes part, so small inputs never spawn a thread at all.
+template <typename Body>
+void parallelFor(size_t count, Body body, unsigned threads = 0, size_t grain = 1) {
+	threads = workerCount(threads);
+	size_t chunk = std::max(grain, count / (threads * 8 + 1));
+	if (threads == 1 || count <= chunk) {
+		if (count) {
+			body(size_t(0), count);
+		}
+		return;
+	}
+	std::atomic<size_t> next_chunk(0);
+	auto worker = [&]() {
+		for (size_t begin; (begin = next_chunk.fetch_add(chunk)) < count;) {
+			body(begin, std::min(count, begin + chunk));
+		}
+	};
+	size_t chunks = (count + chunk - 1) / chunk;
+	std::vector<std::thread> pool;
+	for (size_t i = 1; i < std::min<size_t>(threads, chunks); ++i) {
+		pool.emplace_back(worker);
+	}
+	worker();
+	for (std::thread& t : pool) {
+		t.join();
+	}
+}
@@ -0,0 +1,448 @@
+#include "Picker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+#include "Parallel.h"
+
+static const int bins = 16;
+static const uint32_t max_leaf = 8; // a range this small may stay a leaf when no split pays off
+static const uint32_t face_tree_triangles = 32; // smaller faces test their triangles one by one
+
+// half the surface area, what the heuristic weighs a node's cost by
+static double halfArea(const Box& box) {
+	if (box.empty()) {
+		return 0;
+	}
+	double dx = box.max[0] - box.min[0], dy = box.max[1] - box.min[1], dz = box.max[2] - box.min[2];
+	return dx * dy + dy * dz + dz * dx;
+}
+
+static double center(const Box& box, int axis) {
+	return box.empty() ? 0 : (box.min[axis] + box.max[axis]) / 2;
+}
+
+// Splits nodes[root], a leaf over its range of order, until the leaves are
+// small. Nodes over more than `defer` boxes stay leaves and go to deferred
+// with their depth, for the caller to build separately.
+static void buildRange(const vector<Box>& boxes, vector<uint32_t>& order, vector<BoxTree::Node>& nodes, uint32_t root,
+                       int root_depth, size_t defer, vector<pair<uint32_t, int>>* deferred) {
+	vector<pair<uint32_t, int>> stack{ { root, root_depth } };
+	while (!stack.empty()) {
+		auto [node, depth] = stack.back();
+		stack.pop_back();
+		uint32_t begin = nodes[node].first, end = begin + nodes[node].count;
+		Box box, centers;
+		for (uint32_t i = begin; i < end; ++i) {
+			const Box& other = boxes[order[i]];
+			box.add(other);
+			centers.add(Point(center(other, 0), center(other, 1), center(other, 2)));
+		}
+		nodes[node].box = box;
+		uint32_t count = end - begin;
+		if (count <= 2) {
+			continue;
+		}
+		if (deferred && count > defer) {
+			deferred->emplace_back(node, depth);
+			continue;
+		}
+
+		int axis = 0;
+		for (int i = 1; i < 3; ++i) {
+			if (centers.max[i] - centers.min[i] > centers.max[axis] - centers.min[axis]) {
+				axis = i;
+			}
+		}
+		double low = centers.min[axis], extent = centers.max[axis] - centers.min[axis];
+		uint32_t* first = order.data() + begin;
+		uint32_t* last = order.data() + end;
+		uint32_t* middle = nullptr;
+		if (depth < 64 && extent > 0) {
+			auto bin = [&](uint32_t index) {
+				return min(bins - 1, static_cast<int>(bins * (center(boxes[index], axis) - low) / extent));
+			};
+			Box bin_boxes[bins];
+			uint32_t bin_counts[bins] = {};
+			for (uint32_t* i = first; i != last; ++i) {
+				int b = bin(*i);
+				bin_boxes[b].add(boxes[*i]);
+				++bin_counts[b];
+			}
+			// cost of cutting after bin i: boxes times area on either side
+			double right_areas[bins];
+			uint32_t right_counts[bins];
+			Box right;
+			uint32_t right_count = 0;
+			for (int i = bins - 1; i > 0; --i) {
+				right.add(bin_boxes[i]);
+				right_count += bin_counts[i];
+				right_areas[i - 1] = halfArea(right);
+				right_counts[i - 1] = right_count;
+			}
+			Box left;
+			uint32_t left_count = 0;
+			double best_cost = numeric_limits<double>::infinity();
+			int best = -1;
+			for (int i = 0; i < bins - 1; ++i) {
+				left.add(bin_boxes[i]);
+				left_count += bin_counts[i];
+				if (left_count == 0 || right_counts[i] == 0) {
+					continue;
+				}
+				double cost = left_count * halfArea(left) + right_counts[i] * right_areas[i];
+				if (cost < best_cost) {
+					best_cost = cost;
+					best = i;
+				}
+			}
+			// a leaf costs a test per box, a split one step more plus its children
+			double area = halfArea(box);
+			if (count <= max_leaf && (best < 0 || area + best_cost >= count * area)) {
+				continue;
+			}
+			if (best >= 0) {
+				middle = partition(first, last, [&](uint32_t index) { return bin(index) <= best; });
+			}
+		} else if (count <= max_leaf) {
+			continue;
+		}
+		if (middle == nullptr) {
+			// all centers in one bin or too deep: halve the range
+			middle = first + count / 2;
+			nth_element(first, middle, last,
+			            [&](uint32_t a, uint32_t b) { return center(boxes[a], axis) < center(boxes[b], axis); });
+		}
+
+		uint32_t split = static_cast<uint32_t>(middle - order.data());
+		uint32_t children = static_cast<uint32_t>(nodes.size());
+		BoxTree::Node child;
+		child.parent = node;
+		child.first = begin;
+		child.count = split - begin;
+		nodes.push_back(child);
+		child.first = split;
+		child.count = end - split;
+		nodes.push_back(child);
+		nodes[node].first = children;
+		nodes[node].count = 0;
+		stack.emplace_back(children + 1, depth + 1);
+		stack.emplace_back(children, depth + 1);
+	}
+}
+
+void BoxTree::build(const vector<Box>& boxes, unsigned threads) {
+	nodes.clear();
+	order.resize(boxes.size());
+	iota(order.begin(), order.end(), 0);
+	leaves.assign(boxes.size(), 0);
+	if (boxes.empty()) {
+		return;
+	}
+	Node root;
+	root.count = static_cast<uint32_t>(boxes.size());
+	nodes.push_back(root);
+
+	// the top of the tree on this thread, the big subtrees below it in
+	// parallel, each into nodes of its own that are appended afterwards
+	threads = workerCount(threads);
+	size_t defer = threads > 1 ? max<size_t>(4096, boxes.size() / (threads * 4)) : boxes.size();
+	vector<pair<uint32_t, int>> deferred;
+	buildRange(boxes, order, nodes, 0, 0, defer, &deferred);
+	vector<vector<Node>> subtrees(deferred.size());
+	parallelFor(deferred.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			Node subtree_root = nodes[deferred[i].first];
+			subtree_root.parent = 0;
+			subtrees[i].push_back(subtree_root);
+			buildRange(boxes, order, subtrees[i], 0, deferred[i].second, 0, nullptr);
+		}
+	}, threads);
+	for (size_t i = 0; i < deferred.size(); ++i) {
+		uint32_t at = deferred[i].first;
+		uint32_t base = static_cast<uint32_t>(nodes.size()) - 1; // subtree node j > 0 goes to base + j
+		auto place = [&](uint32_t j) { return j == 0 ? at : base + j; };
+		for (uint32_t j = 0; j < subtrees[i].size(); ++j) {
+			Node node = subtrees[i][j];
+			node.parent = j == 0 ? nodes[at].parent : place(node.parent);
+			if (node.count == 0) {
+				node.first = place(node.first);
+			}
+			if (j == 0) {
+				nodes[at] = node;
+			} else {
+				nodes.push_back(node);
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < nodes.size(); ++i) {
+		for (uint32_t j = nodes[i].first; j < nodes[i].first + nodes[i].count; ++j) {
+			leaves[order[j]] = i;
+		}
+	}
+}
+
+void BoxTree::refit(const vector<Box>& boxes, const vector<uint32_t>& changed) {
+	for (uint32_t index : changed) {
+		uint32_t node = leaves[index];
+		Box box;
+		for (uint32_t j = nodes[node].first; j < nodes[node].first + nodes[node].count; ++j) {
+			box.add(boxes[order[j]]);
+		}
+		nodes[node].box = box;
+		while (node != 0) {
+			node = nodes[node].parent;
+			box = nodes[nodes[node].first].box;
+			box.add(nodes[nodes[node].first + 1].box);
+			nodes[node].box = box;
+		}
+	}
+}
+
+double BoxTree::enter(const Box& box, const double origin[3], const double inverse[3], double t_max) {
+	const double miss = numeric_limits<double>::infinity();
+	if (box.empty()) {
+		return miss;
+	}
+	double t_enter = 0, t_exit = t_max;
+	for (int i = 0; i < 3; ++i) {
+		double t1 = (box.min[i] - origin[i]) * inverse[i];
+		double t2 = (box.max[i] - origin[i]) * inverse[i];
+		if (t1 > t2) {
+			swap(t1, t2);
+		}
+		// a ray parallel to the slab and in one of its planes gives NaN (0 * inf),
+		// which fails both tests and leaves the interval as it is
+		if (t1 > t_enter) {
+			t_enter = t1;
+		}
+		if (t2 < t_exit) {
+			t_exit = t2;
+		}
+	}
+	return t_enter <= t_exit ? t_enter : miss;
+}
+
+void Picker::triangulate(FaceEntry& entry, Tessellator& tessellator) {
+	Face* face = entry.face;
+	entry.mesh.clear();
+	entry.corners.clear();
+	entry.triangle_boxes.clear();
+	entry.triangles = BoxTree();
+	if (face->outer_loop->first_edge == nullptr) {
+		return; // a lone vertex (MVFS)
+	}
+	// the same walk as Tessellator::triangulate, so corners[i] leaves vertex i
+	tessellator.triangulate(face, entry.mesh);
+	for (size_t l = 0; l <= face->inner_loops.size(); ++l) {
+		const Loop* loop = l == 0 ? face->outer_loop : face->inner_loops[l - 1];
+		HalfEdge* he = loop->first_edge;
+		do {
+			entry.corners.push_back(he);
+			he = he->next;
+		} while (he != loop->first_edge);
+	}
+	const vector<double>& positions = entry.mesh.positions;
+	const vector<uint32_t>& indices = entry.mesh.indices;
+	entry.triangle_boxes.resize(indices.size() / 3);
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		Box& box = entry.triangle_boxes[i / 3];
+		for (size_t k = 0; k < 3; ++k) {
+			const double* p = &positions[3 * indices[i + k]];
+			box.add(Point(p[0], p[1], p[2]));
+		}
+	}
+	if (entry.triangle_boxes.size() > face_tree_triangles) {
+		entry.triangles.build(entry.triangle_boxes, 1);
+	}
+}
+
+void Picker::update(const Brep& brep, unsigned threads) {
+	++generation;
+	vector<FaceEntry*> changed;
+	bool rebuild = solids.size() != brep.solids.size();
+	for (Solid* solid : brep.solids) {
+		auto [it, inserted] = solids.try_emplace(solid->SolidId);
+		SolidEntry& cached = it->second;
+		if (!inserted && cached.revision == solid->revision) {
+			continue;
+		}
+		// a face of this solid was made, killed or changed: find out which
+		rebuild |= inserted || cached.faces != solid->faces.size();
+		cached.revision = solid->revision;
+		cached.faces = solid->faces.size();
+		for (Face* face : solid->faces) {
+			auto [found, added] = entries.try_emplace(face->faceId);
+			FaceEntry& entry = found->second;
+			rebuild |= added;
+			entry.face = face;
+			if (!entry.built || entry.revision != face->revision) {
+				changed.push_back(&entry);
+			}
+		}
+	}
+
+	parallelFor(changed.size(), [&](size_t begin, size_t end) {
+		Tessellator tessellator;
+		for (size_t i = begin; i < end; ++i) {
+			FaceEntry& entry = *changed[i];
+			triangulate(entry, tessellator);
+			entry.revision = entry.face->revision;
+			entry.built = true;
+		}
+	}, threads);
+
+	if (rebuild) {
+		// the faces of every solid, in solid order; entries of faces that are
+		// gone are dropped, the others keep their triangles
+		solids.clear();
+		faces.clear();
+		face_boxes.clear();
+		for (Solid* solid : brep.solids) {
+			solids[solid->SolidId] = { solid->revision, solid->faces.size() };
+			for (Face* face : solid->faces) {
+				FaceEntry& entry = entries.at(face->faceId);
+				entry.face = face;
+				entry.seen = generation;
+				entry.slot = static_cast<uint32_t>(faces.size());
+				faces.push_back(&entry);
+				face_boxes.push_back(face->box());
+			}
+		}
+		for (auto it = entries.begin(); it != entries.end();) {
+			it = it->second.seen == generation ? next(it) : entries.erase(it);
+		}
+		tree.build(face_boxes, threads);
+	} else if (!changed.empty()) {
+		vector<uint32_t> slots;
+		for (FaceEntry* entry : changed) {
+			face_boxes[entry->slot] = entry->face->box();
+			slots.push_back(entry->slot);
+		}
+		tree.refit(face_boxes, slots);
+	}
+}
+
+bool intersectTriangle(const double* a, const double* b, const double* c, const Ray& ray, double t_max, double& t,
+                       double* weights, double slack) {
+	const double direction[3] = { ray.direction.x, ray.direction.y, ray.direction.z };
+	const double origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+	double e1[3], e2[3], s[3];
+	for (int i = 0; i < 3; ++i) {
+		e1[i] = b[i] - a[i];
+		e2[i] = c[i] - a[i];
+		s[i] = origin[i] - a[i];
+	}
+	double p[3] = { direction[1] * e2[2] - direction[2] * e2[1], direction[2] * e2[0] - direction[0] * e2[2],
+	                direction[0] * e2[1] - direction[1] * e2[0] };
+	double determinant = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+	if (determinant == 0) {
+		return false;
+	}
+	double inverse = 1 / determinant;
+	double u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverse;
+	if (u < -slack || u > 1 + slack) {
+		return false;
+	}
+	double q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+	double v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * inverse;
+	if (v < -slack || u + v > 1 + slack) {
+		return false;
+	}
+	double hit = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inverse;
+	if (hit < 0 || hit >= t_max) {
+		return false;
+	}
+	t = hit;
+	if (weights) {
+		weights[0] = u;
+		weights[1] = v;
+	}
+	return true;
+}
+
+static double distance(const Point& p, const Point& q) {
+	return sqrt((p.x - q.x) * (p.x - q.x) + (p.y - q.y) * (p.y - q.y) + (p.z - q.z) * (p.z - q.z));
+}
+
+static double distanceToSegment(const Point& p, const Point& a, const Point& b) {
+	double ab[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+	double length = ab[0] * ab[0] + ab[1] * ab[1] + ab[2] * ab[2];
+	double s = length > 0 ? ((p.x - a.x) * ab[0] + (p.y - a.y) * ab[1] + (p.z - a.z) * ab[2]) / length : 0;
+	s = max(0.0, min(1.0, s));
+	return distance(p, Point(a.x + s * ab[0], a.y + s * ab[1], a.z + s * ab[2]));
+}
+
+PickHit Picker::pick(const Ray& ray, double tolerance) const {
+	PickHit hit;
+	const FaceEntry* hit_entry = nullptr;
+	size_t hit_triangle = 0;
+	double t_max = numeric_limits<double>::max();
+	tree.traverse(ray, t_max, [&](uint32_t slot) {
+		const FaceEntry& entry = *faces[slot];
+		const vector<double>& positions = entry.mesh.positions;
+		const vector<uint32_t>& indices = entry.mesh.indices;
+		auto test = [&](uint32_t triangle) {
+			const uint32_t* corner = &indices[3 * triangle];
+			double t;
+			if (intersectTriangle(&positions[3 * corner[0]], &positions[3 * corner[1]], &positions[3 * corner[2]], ray,
+			                      t_max, t)) {
+				t_max = t;
+				hit_entry = &entry;
+				hit_triangle = triangle;
+			}
+		};
+		if (entry.triangles.nodes.empty()) {
+			for (uint32_t i = 0; i < indices.size() / 3; ++i) {
+				test(i);
+			}
+		} else {
+			entry.triangles.traverse(ray, t_max, test);
+		}
+	});
+	if (hit_entry == nullptr) {
+		return hit;
+	}
+
+	hit.face = hit_entry->face;
+	hit.t = t_max;
+	hit.point = Point(ray.origin.x + t_max * ray.direction.x, ray.origin.y + t_max * ray.direction.y,
+	                  ray.origin.z + t_max * ray.direction.z);
+	double reach = tolerance * t_max * distance(ray.direction, Point());
+	if (reach <= 0) {
+		return hit;
+	}
+	// snap to the corners of the hit triangle, then to its sides that are
+	// edges of the face (rather than diagonals the tessellator added)
+	const uint32_t* corner = &hit_entry->mesh.indices[3 * hit_triangle];
+	double best = reach;
+	for (int k = 0; k < 3; ++k) {
+		Vertex* vertex = hit_entry->corners[corner[k]]->start;
+		double d = distance(hit.point, *vertex->point);
+		if (d <= best) {
+			best = d;
+			hit.vertex = vertex;
+		}
+	}
+	if (hit.vertex) {
+		return hit;
+	}
+	for (int k = 0; k < 3; ++k) {
+		HalfEdge* a = hit_entry->corners[corner[k]];
+		HalfEdge* b = hit_entry->corners[corner[(k + 1) % 3]];
+		HalfEdge* side = a->next == b ? a : b->next == a ? b : nullptr;
+		if (side == nullptr) {
+			continue;
+		}
+		double d = distanceToSegment(hit.point, *side->start->point, *side->end->point);
+		if (d <= best) {
+			best = d;
+			hit.edge = side->edge;
+		}
+	}
+	return hit;
+}
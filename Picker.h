@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Brep.h"
+#include "Tessellator.h"
+
+// Half-line origin + t * direction for t >= 0; direction need not be unit
+// length.
+struct Ray {
+	Point origin;
+	Point direction;
+};
+
+// Nearest face a ray hit, with the edge or vertex of the hit triangle that
+// lies within the pick tolerance of the hit point (a vertex wins over an
+// edge). Default-constructed (face == nullptr) when nothing was hit.
+struct PickHit {
+	Face* face = nullptr;
+	Edge* edge = nullptr;
+	Vertex* vertex = nullptr;
+	double t = 0; // ray parameter of the hit
+	Point point;
+
+	explicit operator bool() const {
+		return face != nullptr;
+	}
+};
+
+// Bounding volume hierarchy over a list of boxes, built top-down with the
+// binned surface area heuristic and stored flat: the two children of a node
+// sit next to each other, after their parent. Leaves cover ranges of order,
+// which lists the boxes' indices.
+struct BoxTree {
+	struct Node {
+		Box box;
+		uint32_t first = 0; // first child, or for a leaf its first position in order
+		uint32_t count = 0; // boxes in a leaf, 0 for an inner node
+		uint32_t parent = 0; // the root is its own parent
+	};
+
+	vector<Node> nodes;
+	vector<uint32_t> order;
+	vector<uint32_t> leaves; // leaf node of every box
+
+	// nodes deeper than 64 are split at the median, so no path is longer
+	static constexpr int max_depth = 64 + 32;
+
+	// Subtrees of more than a few thousand boxes are built on up to `threads`
+	// threads (0 = one per core); the tree is the same for any count.
+	void build(const vector<Box>& boxes, unsigned threads = 0);
+
+	// Grows or shrinks the nodes on the way from the leaves of the changed
+	// boxes to the root, for boxes that moved a little: the tree keeps its
+	// shape, so a query costs more the further they have moved.
+	void refit(const vector<Box>& boxes, const vector<uint32_t>& changed);
+
+	// Calls visit(index) for the boxes whose leaves the ray reaches before
+	// t_max, nearer subtrees first; visit may lower t_max to prune the rest.
+	template <typename Visit>
+	void traverse(const Ray& ray, double& t_max, Visit visit) const;
+
+	// Calls visit(index) for the boxes in the leaves whose boxes meet box.
+	template <typename Visit>
+	void overlapping(const Box& box, Visit visit) const;
+
+	// ray parameter (at least 0) where the ray enters box, or infinity when
+	// it misses the box or only reaches it after t_max
+	static double enter(const Box& box, const double origin[3], const double inverse[3], double t_max);
+};
+
+// Moeller-Trumbore, accepting either winding: the ray parameter t in
+// [0, t_max) where the ray meets triangle abc, and when weights is given the
+// barycentric weights of b and c there. With slack > 0 points up to slack
+// (in barycentric terms) outside the triangle count as well, so that a ray
+// through an edge cannot slip between the triangles on either side of it.
+bool intersectTriangle(const double* a, const double* b, const double* c, const Ray& ray, double t_max, double& t,
+                       double* weights = nullptr, double slack = 0);
+
+// Ray picking over the faces of a Brep. A BoxTree over the faces' boxes leads
+// to the triangles of each face, which get a BoxTree of their own once there
+// are more than a few dozen of them, so a pick visits O(log n) nodes.
+// update() catches up with the Euler operators applied since the last call:
+// faces whose revision changed are triangulated again and refitted, and only
+// a change in the set of faces rebuilds the tree over them.
+struct Picker {
+	void update(const Brep& brep, unsigned threads = 0);
+
+	// Nearest hit, seen from either side of the face. An edge or vertex is
+	// snapped to when it lies within tolerance * t * |direction| of the hit
+	// point, which for rays from the eye is a fixed size on the screen. The
+	// Brep must not have changed since update().
+	PickHit pick(const Ray& ray, double tolerance = 0) const;
+
+private:
+	struct FaceEntry {
+		Face* face = nullptr;
+		unsigned revision = 0;
+		bool built = false;
+		unsigned seen = 0; // last update that found the face
+		uint32_t slot = 0; // index into faces and face_boxes
+		TriangleMesh mesh;
+		vector<HalfEdge*> corners; // half-edge leaving each vertex of mesh
+		vector<Box> triangle_boxes;
+		BoxTree triangles; // empty for small faces
+	};
+
+	struct SolidEntry {
+		unsigned revision = 0;
+		size_t faces = 0;
+	};
+
+	static void triangulate(FaceEntry& entry, Tessellator& tessellator);
+
+	unordered_map<int, FaceEntry> entries; // keyed by faceId
+	unordered_map<int, SolidEntry> solids; // keyed by SolidId
+	vector<FaceEntry*> faces; // in the order of the tree's boxes
+	vector<Box> face_boxes;
+	BoxTree tree;
+	unsigned generation = 0;
+};
+
+template <typename Visit>
+void BoxTree::traverse(const Ray& ray, double& t_max, Visit visit) const {
+	if (nodes.empty()) {
+		return;
+	}
+	const double origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+	const double inverse[3] = { 1 / ray.direction.x, 1 / ray.direction.y, 1 / ray.direction.z };
+	const double miss = numeric_limits<double>::infinity();
+	if (enter(nodes[0].box, origin, inverse, t_max) == miss) {
+		return;
+	}
+	uint32_t stack[max_depth];
+	int depth = 0;
+	uint32_t node = 0;
+	for (;;) {
+		const Node& current = nodes[node];
+		if (current.count) {
+			for (uint32_t i = current.first; i < current.first + current.count; ++i) {
+				visit(order[i]);
+			}
+		} else {
+			// no near/far: windows.h has macros of those names
+			uint32_t closer = current.first, further = current.first + 1;
+			double t_closer = enter(nodes[closer].box, origin, inverse, t_max);
+			double t_further = enter(nodes[further].box, origin, inverse, t_max);
+			if (t_further < t_closer) {
+				swap(closer, further);
+				swap(t_closer, t_further);
+			}
+			if (t_closer != miss) {
+				if (t_further != miss) {
+					stack[depth++] = further;
+				}
+				node = closer;
+				continue;
+			}
+		}
+		// t_max may have dropped since a node was pushed, so test it again
+		do {
+			if (depth == 0) {
+				return;
+			}
+			node = stack[--depth];
+		} while (enter(nodes[node].box, origin, inverse, t_max) == miss);
+	}
+}
+
+template <typename Visit>
+void BoxTree::overlapping(const Box& box, Visit visit) const {
+	if (nodes.empty() || !nodes[0].box.intersects(box)) {
+		return;
+	}
+	uint32_t stack[max_depth];
+	int depth = 0;
+	uint32_t node = 0;
+	for (;;) {
+		const Node& current = nodes[node];
+		if (current.count) {
+			for (uint32_t i = current.first; i < current.first + current.count; ++i) {
+				visit(order[i]);
+			}
+		} else {
+			bool first = nodes[current.first].box.intersects(box);
+			bool second = nodes[current.first + 1].box.intersects(box);
+			if (first || second) {
+				if (first && second) {
+					stack[depth++] = current.first + 1;
+				}
+				node = first ? current.first : current.first + 1;
+				continue;
+			}
+		}
+		if (depth == 0) {
+			return;
+		}
+		node = stack[--depth];
+	}
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Slab allocator for topology records. Objects are constructed in place inside
+// geometrically growing blocks and never move, so the raw pointers handed out
+// stay valid until the object is destroyed or the whole pool is cleared.
+// Destroyed slots go on a free list and are reused by the next create().
+template <typename T>
+struct Pool {
+	Pool() = default;
+	Pool(const Pool&) = delete;
+	Pool& operator=(const Pool&) = delete;
+
+	~Pool() {
+		clear();
+	}
+
+	template <typename... Args>
+	T* create(Args&&... args) {
+		Slot* slot = free_list;
+		if (slot) {
+			free_list = slot->next;
+		} else {
+			slot = grow();
+		}
+		++count;
+		return new (slot->storage) T(std::forward<Args>(args)...);
+	}
+
+	void destroy(T* object) {
+		object->~T();
+		Slot* slot = reinterpret_cast<Slot*>(object);
+		slot->next = free_list;
+		free_list = slot;
+		--count;
+	}
+
+	// Makes room for n more objects with at most one allocation, for callers
+	// that know how many they are about to create. The unused rest of the
+	// current block goes to the free list first, so nothing is wasted.
+	void reserve(size_t n) {
+		size_t spare = blocks.empty() ? 0 : blocks.back().capacity - used;
+		if (spare >= n) {
+			return;
+		}
+		for (; used < (blocks.empty() ? 0 : blocks.back().capacity); ++used) {
+			Slot* slot = blocks.back().slots + used;
+			slot->next = free_list;
+			free_list = slot;
+		}
+		size_t capacity = std::max(n - spare, blocks.empty() ? first_block : std::min(blocks.back().capacity * 2, max_block));
+		blocks.push_back({ static_cast<Slot*>(::operator new(capacity * sizeof(Slot))), capacity });
+		used = 0;
+	}
+
+	// Takes over every object of other, which is left empty. Its blocks are
+	// moved over as they are, so the objects keep their addresses, and its
+	// free slots (the unused rest of its last block included) join this
+	// pool's free list.
+	void splice(Pool& other) {
+		if (other.blocks.empty()) {
+			return;
+		}
+		for (; other.used < other.blocks.back().capacity; ++other.used) {
+			Slot* slot = other.blocks.back().slots + other.used;
+			slot->next = other.free_list;
+			other.free_list = slot;
+		}
+		if (other.free_list) {
+			Slot* last = other.free_list;
+			while (last->next) {
+				last = last->next;
+			}
+			last->next = free_list;
+			free_list = other.free_list;
+		}
+		if (blocks.empty()) {
+			blocks.swap(other.blocks);
+			used = blocks.back().capacity;
+		} else {
+			// in front of the last block, which create() is still carving up
+			blocks.insert(blocks.end() - 1, other.blocks.begin(), other.blocks.end());
+			other.blocks.clear();
+		}
+		count += other.count;
+		other.free_list = nullptr;
+		other.used = 0;
+		other.count = 0;
+	}
+
+	// Bulk free: runs the destructors of the live objects (only when T needs
+	// it) and returns every block to the system.
+	void clear() {
+		if constexpr (!std::is_trivially_destructible_v<T>) {
+			std::vector<Slot*> free_slots;
+			for (Slot* slot = free_list; slot; slot = slot->next) {
+				free_slots.push_back(slot);
+			}
+			std::sort(free_slots.begin(), free_slots.end());
+			for (size_t i = 0; i < blocks.size(); ++i) {
+				size_t end = i + 1 == blocks.size() ? used : blocks[i].capacity;
+				for (size_t j = 0; j < end; ++j) {
+					Slot* slot = blocks[i].slots + j;
+					if (!std::binary_search(free_slots.begin(), free_slots.end(), slot)) {
+						reinterpret_cast<T*>(slot->storage)->~T();
+					}
+				}
+			}
+		}
+		for (Block& block : blocks) {
+			::operator delete(block.slots);
+		}
+		blocks.clear();
+		free_list = nullptr;
+		used = 0;
+		count = 0;
+	}
+
+	size_t size() const {
+		return count;
+	}
+
+private:
+	union Slot {
+		Slot* next;
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+
+	struct Block {
+		Slot* slots;
+		size_t capacity;
+	};
+
+	static constexpr size_t first_block = 16;
+	static constexpr size_t max_block = 4096;
+
+	Slot* grow() {
+		if (blocks.empty() || used == blocks.back().capacity) {
+			size_t capacity = blocks.empty() ? first_block : std::min(blocks.back().capacity * 2, max_block);
+			blocks.push_back({ static_cast<Slot*>(::operator new(capacity * sizeof(Slot))), capacity });
+			used = 0;
+		}
+		return blocks.back().slots + used++;
+	}
+
+	std::vector<Block> blocks;
+	Slot* free_list = nullptr;
+	size_t used = 0; // slots handed out from the last block
+	size_t count = 0;
+};
@@ -0,0 +1,534 @@
+#include "Tessellator.h"
+
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+#include "Parallel.h"
+
+bool Tessellator::triangulate(const Face* face, TriangleMesh& mesh) {
+	uint32_t base = static_cast<uint32_t>(mesh.positions.size() / 3);
+	size_t first_index = mesh.indices.size();
+
+	const double* normal = face->plane().normal;
+
+	// keep the two coordinates orthogonal to the dominant normal axis,
+	// ordered so that (u, v, axis) stays right-handed
+	int axis = fabs(normal[0]) > fabs(normal[1]) ? 0 : 1;
+	axis = fabs(normal[2]) > fabs(normal[axis]) ? 2 : axis;
+	int u = (axis + 1) % 3, v = (axis + 2) % 3;
+
+	xy.clear();
+	holes.clear();
+	for (size_t l = 0; l <= face->inner_loops.size(); ++l) {
+		const Loop* loop = l == 0 ? face->outer_loop : face->inner_loops[l - 1];
+		if (l) {
+			holes.push_back(static_cast<uint32_t>(xy.size() / 2));
+		}
+		const HalfEdge* he = loop->first_edge;
+		do {
+			const double p[3] = { he->start->point->x, he->start->point->y, he->start->point->z };
+			mesh.positions.insert(mesh.positions.end(), p, p + 3);
+			mesh.normals.insert(mesh.normals.end(), normal, normal + 3);
+			xy.push_back(p[u]);
+			xy.push_back(p[v]);
+			he = he->next;
+		} while (he != loop->first_edge);
+	}
+
+	nodes_used = 0;
+	indices = &mesh.indices;
+	index_base = base;
+	uint32_t outer_count = holes.empty() ? static_cast<uint32_t>(xy.size() / 2) : holes[0];
+	Node* outer = linkedList(0, outer_count, true);
+	if (outer == nullptr || outer->next == outer->prev) {
+		return false;
+	}
+	if (!holes.empty()) {
+		outer = eliminateHoles(outer);
+	}
+
+	// only hash polygons big enough for the O(n^2) ear test to hurt
+	inv_size = 0;
+	if (xy.size() > 80 * 2) {
+		min_x = xy[0];
+		min_y = xy[1];
+		double max_x = min_x, max_y = min_y;
+		for (size_t i = 2; i < outer_count * 2; i += 2) {
+			min_x = min(min_x, xy[i]);
+			min_y = min(min_y, xy[i + 1]);
+			max_x = max(max_x, xy[i]);
+			max_y = max(max_y, xy[i + 1]);
+		}
+		inv_size = max(max_x - min_x, max_y - min_y);
+		inv_size = inv_size != 0 ? 32767 / inv_size : 0;
+	}
+	earcutLinked(outer, 0);
+
+	bool flip = normal[axis] < 0;
+	double covered = 0;
+	for (size_t i = first_index; i < mesh.indices.size(); i += 3) {
+		const double *a = &xy[2 * (mesh.indices[i] - base)], *b = &xy[2 * (mesh.indices[i + 1] - base)],
+		             *c = &xy[2 * (mesh.indices[i + 2] - base)];
+		covered += (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+		if (flip) {
+			swap(mesh.indices[i + 1], mesh.indices[i + 2]);
+		}
+	}
+	double expected = fabs(signedArea(0, outer_count));
+	for (size_t h = 0; h < holes.size(); ++h) {
+		expected -= fabs(signedArea(holes[h], h + 1 < holes.size() ? holes[h + 1] : xy.size() / 2));
+	}
+	// both sums are twice the area
+	return fabs(covered - expected) <= 1e-9 * expected;
+}
+
+Tessellator::Node* Tessellator::newNode(uint32_t i, double x, double y) {
+	if (nodes_used == node_blocks.size() * node_block) {
+		node_blocks.emplace_back(new Node[node_block]);
+	}
+	Node* p = &node_blocks[nodes_used / node_block][nodes_used % node_block];
+	++nodes_used;
+	*p = Node();
+	p->i = i;
+	p->x = x;
+	p->y = y;
+	return p;
+}
+
+void Tessellator::emit(const Node* a, const Node* b, const Node* c) {
+	indices->push_back(index_base + a->i);
+	indices->push_back(index_base + b->i);
+	indices->push_back(index_base + c->i);
+}
+
+double Tessellator::signedArea(size_t start, size_t end) const {
+	double sum = 0;
+	for (size_t i = start, j = end - 1; i < end; j = i++) {
+		sum += (xy[2 * j] - xy[2 * i]) * (xy[2 * i + 1] + xy[2 * j + 1]);
+	}
+	return sum;
+}
+
+Tessellator::Node* Tessellator::linkedList(uint32_t start, uint32_t end, bool clockwise) {
+	Node* last = nullptr;
+	if (clockwise == (signedArea(start, end) > 0)) {
+		for (uint32_t i = start; i < end; ++i) {
+			last = insertNode(i, xy[2 * i], xy[2 * i + 1], last);
+		}
+	} else {
+		for (uint32_t i = end; i-- > start;) {
+			last = insertNode(i, xy[2 * i], xy[2 * i + 1], last);
+		}
+	}
+	if (last && equals(last, last->next)) {
+		removeNode(last);
+		last = last->next;
+	}
+	return last;
+}
+
+Tessellator::Node* Tessellator::filterPoints(Node* start, Node* end) {
+	if (!start) {
+		return start;
+	}
+	if (!end) {
+		end = start;
+	}
+	Node* p = start;
+	bool again;
+	do {
+		again = false;
+		if (!p->steiner && (equals(p, p->next) || area(p->prev, p, p->next) == 0)) {
+			removeNode(p);
+			p = end = p->prev;
+			if (p == p->next) {
+				break;
+			}
+			again = true;
+		} else {
+			p = p->next;
+		}
+	} while (again || p != end);
+	return end;
+}
+
+void Tessellator::earcutLinked(Node* ear, int pass) {
+	if (!ear) {
+		return;
+	}
+	if (!pass && inv_size) {
+		indexCurve(ear);
+	}
+	Node* stop = ear;
+	while (ear->prev != ear->next) {
+		Node *prev = ear->prev, *next = ear->next;
+		if (inv_size ? isEarHashed(ear) : isEar(ear)) {
+			emit(prev, ear, next);
+			removeNode(ear);
+			// skipping the next vertex leads to less sliver triangles
+			ear = next->next;
+			stop = next->next;
+			continue;
+		}
+		ear = next;
+		if (ear == stop) {
+			// no ears left: clean up and retry, then cure intersections,
+			// then split the remaining polygon in two
+			if (!pass) {
+				earcutLinked(filterPoints(ear), 1);
+			} else if (pass == 1) {
+				earcutLinked(cureLocalIntersections(filterPoints(ear)), 2);
+			} else {
+				splitEarcut(ear);
+			}
+			break;
+		}
+	}
+}
+
+bool Tessellator::isEar(const Node* ear) const {
+	const Node *a = ear->prev, *b = ear, *c = ear->next;
+	if (area(a, b, c) >= 0) {
+		return false; // reflex
+	}
+	double x0 = min(a->x, min(b->x, c->x)), y0 = min(a->y, min(b->y, c->y));
+	double x1 = max(a->x, max(b->x, c->x)), y1 = max(a->y, max(b->y, c->y));
+	for (const Node* p = c->next; p != a; p = p->next) {
+		if (p->x >= x0 && p->x <= x1 && p->y >= y0 && p->y <= y1 &&
+		    pointInTriangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y) && area(p->prev, p, p->next) >= 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Tessellator::isEarHashed(const Node* ear) const {
+	const Node *a = ear->prev, *b = ear, *c = ear->next;
+	if (area(a, b, c) >= 0) {
+		return false;
+	}
+	double x0 = min(a->x, min(b->x, c->x)), y0 = min(a->y, min(b->y, c->y));
+	double x1 = max(a->x, max(b->x, c->x)), y1 = max(a->y, max(b->y, c->y));
+	int32_t min_z = zOrder(x0, y0), max_z = zOrder(x1, y1);
+	auto blocks = [&](const Node* p) {
+		return p->x >= x0 && p->x <= x1 && p->y >= y0 && p->y <= y1 && p != a && p != c &&
+		       pointInTriangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y) && area(p->prev, p, p->next) >= 0;
+	};
+	// look for points inside the triangle in both directions of z-order
+	const Node *p = ear->prev_z, *n = ear->next_z;
+	while (p && p->z >= min_z && n && n->z <= max_z) {
+		if (blocks(p) || blocks(n)) {
+			return false;
+		}
+		p = p->prev_z;
+		n = n->next_z;
+	}
+	for (; p && p->z >= min_z; p = p->prev_z) {
+		if (blocks(p)) {
+			return false;
+		}
+	}
+	for (; n && n->z <= max_z; n = n->next_z) {
+		if (blocks(n)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+Tessellator::Node* Tessellator::cureLocalIntersections(Node* start) {
+	Node* p = start;
+	do {
+		Node *a = p->prev, *b = p->next->next;
+		if (!equals(a, b) && intersects(a, p, p->next, b) && locallyInside(a, b) && locallyInside(b, a)) {
+			emit(a, p, b);
+			removeNode(p);
+			removeNode(p->next);
+			p = start = b;
+		}
+		p = p->next;
+	} while (p != start);
+	return filterPoints(p);
+}
+
+void Tessellator::splitEarcut(Node* start) {
+	Node* a = start;
+	do {
+		for (Node* b = a->next->next; b != a->prev; b = b->next) {
+			if (a->i != b->i && isValidDiagonal(a, b)) {
+				Node* c = splitPolygon(a, b);
+				a = filterPoints(a, a->next);
+				c = filterPoints(c, c->next);
+				earcutLinked(a, 0);
+				earcutLinked(c, 0);
+				return;
+			}
+		}
+		a = a->next;
+	} while (a != start);
+}
+
+Tessellator::Node* Tessellator::eliminateHoles(Node* outer) {
+	hole_queue.clear();
+	for (size_t h = 0; h < holes.size(); ++h) {
+		uint32_t end = h + 1 < holes.size() ? holes[h + 1] : static_cast<uint32_t>(xy.size() / 2);
+		Node* list = linkedList(holes[h], end, false);
+		if (list) {
+			if (list == list->next) {
+				list->steiner = true;
+			}
+			hole_queue.push_back(getLeftmost(list));
+		}
+	}
+	sort(hole_queue.begin(), hole_queue.end(), [](const Node* a, const Node* b) {
+		return a->x != b->x ? a->x < b->x : a->y < b->y;
+	});
+	for (Node* hole : hole_queue) {
+		outer = eliminateHole(hole, outer);
+	}
+	return outer;
+}
+
+Tessellator::Node* Tessellator::eliminateHole(Node* hole, Node* outer) {
+	Node* bridge = findHoleBridge(hole, outer);
+	if (!bridge) {
+		return outer;
+	}
+	Node* bridge_reverse = splitPolygon(bridge, hole);
+	filterPoints(bridge_reverse, bridge_reverse->next);
+	return filterPoints(bridge, bridge->next);
+}
+
+Tessellator::Node* Tessellator::findHoleBridge(Node* hole, Node* outer) const {
+	Node* p = outer;
+	double hx = hole->x, hy = hole->y, qx = -numeric_limits<double>::infinity();
+	Node* m = nullptr;
+	do {
+		if (hy <= p->y && hy >= p->next->y && p->next->y != p->y) {
+			double x = p->x + (hy - p->y) * (p->next->x - p->x) / (p->next->y - p->y);
+			if (x <= hx && x > qx) {
+				qx = x;
+				m = p->x < p->next->x ? p : p->next;
+				if (x == hx) {
+					return m; // the hole touches the outer segment
+				}
+			}
+		}
+		p = p->next;
+	} while (p != outer);
+	if (!m) {
+		return nullptr;
+	}
+
+	// among the points inside the triangle (hole point, segment hit, m),
+	// take the one with the smallest angle to the ray
+	Node* stop = m;
+	double mx = m->x, my = m->y, tan_min = numeric_limits<double>::infinity();
+	p = m;
+	do {
+		if (hx >= p->x && p->x >= mx && hx != p->x &&
+		    pointInTriangle(hy < my ? hx : qx, hy, mx, my, hy < my ? qx : hx, hy, p->x, p->y)) {
+			double tan = fabs(hy - p->y) / (hx - p->x);
+			if (locallyInside(p, hole) &&
+			    (tan < tan_min ||
+			     (tan == tan_min && (p->x > m->x || (p->x == m->x && sectorContainsPoint(m, p)))))) {
+				m = p;
+				tan_min = tan;
+			}
+		}
+		p = p->next;
+	} while (p != stop);
+	return m;
+}
+
+void Tessellator::indexCurve(Node* start) const {
+	Node* p = start;
+	do {
+		p->z = zOrder(p->x, p->y);
+		p->prev_z = p->prev;
+		p->next_z = p->next;
+		p = p->next;
+	} while (p != start);
+	p->prev_z->next_z = nullptr;
+	p->prev_z = nullptr;
+	sortLinked(p);
+}
+
+Tessellator::Node* Tessellator::sortLinked(Node* list) {
+	size_t in_size = 1, merges;
+	do {
+		Node *p = list, *tail = nullptr;
+		list = nullptr;
+		merges = 0;
+		while (p) {
+			++merges;
+			Node* q = p;
+			size_t p_size = 0;
+			for (size_t i = 0; i < in_size && q; ++i) {
+				++p_size;
+				q = q->next_z;
+			}
+			size_t q_size = in_size;
+			while (p_size > 0 || (q_size > 0 && q)) {
+				Node* e;
+				if (p_size != 0 && (q_size == 0 || !q || p->z <= q->z)) {
+					e = p;
+					p = p->next_z;
+					--p_size;
+				} else {
+					e = q;
+					q = q->next_z;
+					--q_size;
+				}
+				if (tail) {
+					tail->next_z = e;
+				} else {
+					list = e;
+				}
+				e->prev_z = tail;
+				tail = e;
+			}
+			p = q;
+		}
+		tail->next_z = nullptr;
+		in_size *= 2;
+	} while (merges > 1);
+	return list;
+}
+
+int32_t Tessellator::zOrder(double px, double py) const {
+	int32_t x = static_cast<int32_t>((px - min_x) * inv_size);
+	int32_t y = static_cast<int32_t>((py - min_y) * inv_size);
+	x = (x | (x << 8)) & 0x00FF00FF;
+	x = (x | (x << 4)) & 0x0F0F0F0F;
+	x = (x | (x << 2)) & 0x33333333;
+	x = (x | (x << 1)) & 0x55555555;
+	y = (y | (y << 8)) & 0x00FF00FF;
+	y = (y | (y << 4)) & 0x0F0F0F0F;
+	y = (y | (y << 2)) & 0x33333333;
+	y = (y | (y << 1)) & 0x55555555;
+	return x | (y << 1);
+}
+
+Tessellator::Node* Tessellator::getLeftmost(Node* start) {
+	Node *p = start, *leftmost = start;
+	do {
+		if (p->x < leftmost->x || (p->x == leftmost->x && p->y < leftmost->y)) {
+			leftmost = p;
+		}
+		p = p->next;
+	} while (p != start);
+	return leftmost;
+}
+
+bool Tessellator::pointInTriangle(double ax, double ay, double bx, double by, double cx, double cy, double px,
+                                  double py) {
+	return (cx - px) * (ay - py) >= (ax - px) * (cy - py) && (ax - px) * (by - py) >= (bx - px) * (ay - py) &&
+	       (bx - px) * (cy - py) >= (cx - px) * (by - py);
+}
+
+bool Tessellator::isValidDiagonal(const Node* a, const Node* b) {
+	return a->next->i != b->i && a->prev->i != b->i && !intersectsPolygon(a, b) &&
+	       ((locallyInside(a, b) && locallyInside(b, a) && middleInside(a, b) &&
+	         (area(a->prev, a, b->prev) != 0 || area(a, b->prev, b) != 0)) ||
+	        (equals(a, b) && area(a->prev, a, a->next) > 0 && area(b->prev, b, b->next) > 0));
+}
+
+bool Tessellator::onSegment(const Node* p, const Node* q, const Node* r) {
+	return q->x <= max(p->x, r->x) && q->x >= min(p->x, r->x) && q->y <= max(p->y, r->y) &&
+	       q->y >= min(p->y, r->y);
+}
+
+bool Tessellator::intersects(const Node* p1, const Node* q1, const Node* p2, const Node* q2) {
+	int o1 = sign(area(p1, q1, p2)), o2 = sign(area(p1, q1, q2));
+	int o3 = sign(area(p2, q2, p1)), o4 = sign(area(p2, q2, q1));
+	return (o1 != o2 && o3 != o4) || (o1 == 0 && onSegment(p1, p2, q1)) || (o2 == 0 && onSegment(p1, q2, q1)) ||
+	       (o3 == 0 && onSegment(p2, p1, q2)) || (o4 == 0 && onSegment(p2, q1, q2));
+}
+
+bool Tessellator::intersectsPolygon(const Node* a, const Node* b) {
+	const Node* p = a;
+	do {
+		if (p->i != a->i && p->next->i != a->i && p->i != b->i && p->next->i != b->i &&
+		    intersects(p, p->next, a, b)) {
+			return true;
+		}
+		p = p->next;
+	} while (p != a);
+	return false;
+}
+
+bool Tessellator::locallyInside(const Node* a, const Node* b) {
+	return area(a->prev, a, a->next) < 0 ? area(a, b, a->next) >= 0 && area(a, a->prev, b) >= 0
+	                                     : area(a, b, a->prev) < 0 || area(a, a->next, b) < 0;
+}
+
+bool Tessellator::middleInside(const Node* a, const Node* b) {
+	const Node* p = a;
+	bool inside = false;
+	double px = (a->x + b->x) / 2, py = (a->y + b->y) / 2;
+	do {
+		if ((p->y > py) != (p->next->y > py) && p->next->y != p->y &&
+		    px < (p->next->x - p->x) * (py - p->y) / (p->next->y - p->y) + p->x) {
+			inside = !inside;
+		}
+		p = p->next;
+	} while (p != a);
+	return inside;
+}
+
+Tessellator::Node* Tessellator::splitPolygon(Node* a, Node* b) {
+	Node* a2 = newNode(a->i, a->x, a->y);
+	Node* b2 = newNode(b->i, b->x, b->y);
+	Node *an = a->next, *bp = b->prev;
+	a->next = b;
+	b->prev = a;
+	a2->next = an;
+	an->prev = a2;
+	b2->next = a2;
+	a2->prev = b2;
+	bp->next = b2;
+	b2->prev = bp;
+	return b2;
+}
+
+Tessellator::Node* Tessellator::insertNode(uint32_t i, double x, double y, Node* last) {
+	Node* p = newNode(i, x, y);
+	if (!last) {
+		p->prev = p;
+		p->next = p;
+	} else {
+		p->next = last->next;
+		p->prev = last;
+		last->next->prev = p;
+		last->next = p;
+	}
+	return p;
+}
+
+void Tessellator::removeNode(Node* p) {
+	p->next->prev = p->prev;
+	p->prev->next = p->next;
+	if (p->prev_z) {
+		p->prev_z->next_z = p->next_z;
+	}
+	if (p->next_z) {
+		p->next_z->prev_z = p->prev_z;
+	}
+}
+
+bool tessellate(const Solid* solid, vector<TriangleMesh>& meshes, unsigned threads) {
+	meshes.resize(solid->faces.size());
+	atomic<bool> exact(true);
+	parallelFor(solid->faces.size(), [&](size_t begin, size_t end) {
+		Tessellator tessellator;
+		for (size_t i = begin; i < end; ++i) {
+			meshes[i].clear();
+			if (!tessellator.triangulate(solid->faces[i], meshes[i])) {
+				exact = false;
+			}
+		}
+	}, threads);
+	return exact;
+}
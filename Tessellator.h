@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Brep.h"
+
+// Indexed triangle list. Tessellator::triangulate() appends to it, so one
+// buffer can hold a single face or collect a whole solid.
+struct TriangleMesh {
+	vector<double> positions; // x, y, z per vertex
+	vector<double> normals; // x, y, z per vertex: the normal of its face's plane
+	vector<uint32_t> indices; // three per triangle, into positions / 3
+
+	void clear() {
+		positions.clear();
+		normals.clear();
+		indices.clear();
+	}
+
+	size_t triangleCount() const {
+		return indices.size() / 3;
+	}
+};
+
+// Ear-clipping triangulator for planar faces with holes, independent of GLU.
+// Inner loops are bridged into the outer loop, the resulting polygon is
+// projected onto the plane of the dominant normal axis and clipped; polygons
+// above a few dozen vertices use a z-order curve to keep the ear test local.
+// Degenerate and self-touching input is handled by progressively more
+// forgiving passes (filtering, curing local intersections, splitting).
+//
+// A Tessellator only holds scratch memory that is reused between calls: it
+// has no global state, so each thread simply uses its own instance.
+struct Tessellator {
+	// Appends the vertices of the face's loops (outer loop first, each loop
+	// starting at its first_edge) and the triangles covering the face to
+	// mesh; triangles are wound counter-clockwise around the outer loop's
+	// normal. Returns false when the triangles do not cover the face exactly,
+	// which only happens for self-intersecting loops.
+	bool triangulate(const Face* face, TriangleMesh& mesh);
+
+private:
+	struct Node {
+		uint32_t i; // vertex index relative to the face
+		double x, y;
+		Node* prev = nullptr;
+		Node* next = nullptr;
+		int32_t z = 0; // z-order curve value
+		Node* prev_z = nullptr;
+		Node* next_z = nullptr;
+		bool steiner = false;
+	};
+
+	static constexpr size_t node_block = 1024;
+
+	vector<double> xy; // projected coordinates
+	vector<uint32_t> holes; // first vertex of every inner loop
+	vector<unique_ptr<Node[]>> node_blocks; // stable storage, reused across calls
+	vector<Node*> hole_queue;
+	size_t nodes_used = 0;
+	vector<uint32_t>* indices = nullptr;
+	uint32_t index_base = 0;
+	double min_x = 0, min_y = 0, inv_size = 0;
+
+	Node* newNode(uint32_t i, double x, double y);
+
+	void emit(const Node* a, const Node* b, const Node* c);
+
+	double signedArea(size_t start, size_t end) const;
+
+	// circular doubly linked list over [start, end) in the requested winding
+	Node* linkedList(uint32_t start, uint32_t end, bool clockwise);
+
+	// drops duplicate and collinear points
+	Node* filterPoints(Node* start, Node* end = nullptr);
+
+	void earcutLinked(Node* ear, int pass);
+
+	bool isEar(const Node* ear) const;
+
+	bool isEarHashed(const Node* ear) const;
+
+	Node* cureLocalIntersections(Node* start);
+
+	void splitEarcut(Node* start);
+
+	// links every hole into the outer loop through a bridge, left to right
+	Node* eliminateHoles(Node* outer);
+
+	Node* eliminateHole(Node* hole, Node* outer);
+
+	// David Eberly's algorithm for finding a vertex of the outer polygon that
+	// is visible from the leftmost point of the hole
+	Node* findHoleBridge(Node* hole, Node* outer) const;
+
+	static bool sectorContainsPoint(const Node* m, const Node* p) {
+		return area(m->prev, m, p->prev) < 0 && area(p->next, m, m->next) < 0;
+	}
+
+	void indexCurve(Node* start) const;
+
+	// Simon Tatham's linked list merge sort on the z links
+	static Node* sortLinked(Node* list);
+
+	// z-order of a point given its coordinates scaled to 15 bits
+	int32_t zOrder(double px, double py) const;
+
+	static Node* getLeftmost(Node* start);
+
+	static bool pointInTriangle(double ax, double ay, double bx, double by, double cx, double cy, double px,
+	                            double py);
+
+	// a diagonal that stays inside the polygon and crosses none of its edges
+	static bool isValidDiagonal(const Node* a, const Node* b);
+
+	static double area(const Node* p, const Node* q, const Node* r) {
+		return (q->y - p->y) * (r->x - q->x) - (q->x - p->x) * (r->y - q->y);
+	}
+
+	static bool equals(const Node* p1, const Node* p2) {
+		return p1->x == p2->x && p1->y == p2->y;
+	}
+
+	static int sign(double value) {
+		return (value > 0) - (value < 0);
+	}
+
+	static bool onSegment(const Node* p, const Node* q, const Node* r);
+
+	static bool intersects(const Node* p1, const Node* q1, const Node* p2, const Node* q2);
+
+	static bool intersectsPolygon(const Node* a, const Node* b);
+
+	static bool locallyInside(const Node* a, const Node* b);
+
+	static bool middleInside(const Node* a, const Node* b);
+
+	// splits the polygon along the diagonal a-b and returns the node that
+	// starts the second half
+	Node* splitPolygon(Node* a, Node* b);
+
+	Node* insertNode(uint32_t i, double x, double y, Node* last);
+
+	static void removeNode(Node* p);
+};
+
+// Triangulates every face of the solid into meshes[face index], spreading the
+// faces over `threads` threads (0 = one per core). Returns false if any face
+// could not be covered exactly.
+bool tessellate(const Solid* solid, vector<TriangleMesh>& meshes, unsigned threads = 0);
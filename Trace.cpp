@@ -0,0 +1,20 @@
+#include "Trace.h"
+
+void Trace::dump(FILE* out) const {
+	uint64_t first = recorded > events.size() ? recorded - events.size() : 0;
+	if (first) {
+		fprintf(out, "(%llu earlier events dropped)\n", static_cast<unsigned long long>(first));
+	}
+	for (uint64_t i = first; i < recorded; ++i) {
+		const TraceEvent& event = events[i % events.size()];
+		fputs(event.what, out);
+		if (event.detail) {
+			fprintf(out, " %s", event.detail);
+		}
+		for (int k = 0; k < event.value_count; ++k) {
+			fprintf(out, " %g", event.values[k]);
+		}
+		fputc('\n', out);
+	}
+	fflush(out);
+}
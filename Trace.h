@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// One trace point as recorded: static text and up to three numbers, kept raw
+// so that nothing is formatted until the trace is dumped.
+struct TraceEvent {
+	const char* what = nullptr; // static text
+	const char* detail = nullptr; // static text, optional
+	double values[3] = { 0, 0, 0 };
+	int value_count = 0;
+};
+
+// Bounded event log: a ring buffer holding the last `capacity` events, so a
+// long session costs a fixed amount of memory. Recording stores one event
+// and does nothing while the trace is disabled (the default); dump() does
+// the formatting. Not thread-safe: use one Trace per thread.
+//
+// Trace points go through TRACE(trace, ...), which compiles to nothing
+// unless CADBREP_TRACE is defined.
+struct Trace {
+	explicit Trace(size_t capacity = 4096) : events(capacity ? capacity : 1) {}
+
+	bool enabled = false;
+
+	void record(const char* what, const char* detail = nullptr) {
+		TraceEvent& event = slot();
+		event.what = what;
+		event.detail = detail;
+		event.value_count = 0;
+	}
+
+	void record(const char* what, double x, double y, double z) {
+		TraceEvent& event = slot();
+		event.what = what;
+		event.detail = nullptr;
+		event.values[0] = x;
+		event.values[1] = y;
+		event.values[2] = z;
+		event.value_count = 3;
+	}
+
+	// Writes the events still held, oldest first, one per line.
+	void dump(FILE* out) const;
+
+	void clear() {
+		recorded = 0;
+	}
+
+private:
+	TraceEvent& slot() {
+		return events[recorded++ % events.size()];
+	}
+
+	std::vector<TraceEvent> events;
+	uint64_t recorded = 0; // since the last clear, including those overwritten
+};
+
+#ifdef CADBREP_TRACE
+#define TRACE(trace, ...) \
+	do { \
+		if ((trace).enabled) { \
+			(trace).record(__VA_ARGS__); \
+		} \
+	} while (0)
+#else
+#define TRACE(trace, ...) ((void)0)
+#endif
@@ -0,0 +1,155 @@
+#include "Validator.h"
+
+#include <atomic>
+#include <cstdint>
+
+#include "Parallel.h"
+
+namespace {
+
+TopologyError fail(const Solid* solid, const char* problem, int id = -1) {
+	return { problem, solid, id };
+}
+
+// item is in the solid's list where its index says
+template <typename T>
+bool listed(const vector<T*>& list, const T* item) {
+	return item != nullptr && item->index < list.size() && list[item->index] == item;
+}
+
+uint32_t findRoot(vector<uint32_t>& parent, uint32_t v) {
+	while (parent[v] != v) {
+		parent[v] = parent[parent[v]];
+		v = parent[v];
+	}
+	return v;
+}
+
+} // namespace
+
+TopologyError validate(const Solid* solid) {
+	const vector<Vertex*>& vertices = solid->vertices;
+	const vector<Edge*>& edges = solid->edges;
+	const vector<Face*>& faces = solid->faces;
+
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		const Vertex* vertex = vertices[i];
+		if (vertex == nullptr || vertex->index != i) {
+			return fail(solid, "vertex list out of order");
+		}
+		if (vertex->he == nullptr) {
+			if (!edges.empty()) {
+				return fail(solid, "vertex without a half-edge", vertex->VertexId);
+			}
+		} else if (vertex->he->start != vertex || !listed(edges, vertex->he->edge)) {
+			return fail(solid, "vertex half-edge does not start at the vertex", vertex->VertexId);
+		}
+	}
+
+	for (size_t i = 0; i < edges.size(); ++i) {
+		const Edge* edge = edges[i];
+		if (edge == nullptr || edge->index != i) {
+			return fail(solid, "edge list out of order");
+		}
+		const HalfEdge *he1 = edge->he1, *he2 = edge->he2;
+		if (he1 == nullptr || he2 == nullptr || he1->partner != he2 || he2->partner != he1) {
+			return fail(solid, "partner is not an involution", edge->EdgeId);
+		}
+		if (he1->edge != edge || he2->edge != edge) {
+			return fail(solid, "half-edge points at another edge", edge->EdgeId);
+		}
+		if (he1->start != he2->end || he1->end != he2->start || !listed(vertices, he1->start) ||
+		    !listed(vertices, he1->end)) {
+			return fail(solid, "half-edges of an edge do not share its vertices", edge->EdgeId);
+		}
+	}
+
+	// walking every loop must visit each of the 2E half-edges exactly once
+	size_t half_edges = 0;
+	size_t rings = 0;
+	for (size_t i = 0; i < faces.size(); ++i) {
+		const Face* face = faces[i];
+		if (face == nullptr || face->index != i) {
+			return fail(solid, "face list out of order");
+		}
+		if (face->solid != solid) {
+			return fail(solid, "face of another solid", face->faceId);
+		}
+		if (face->outer_loop == nullptr) {
+			return fail(solid, "face without an outer loop", face->faceId);
+		}
+		rings += face->inner_loops.size();
+		for (size_t k = 0; k <= face->inner_loops.size(); ++k) {
+			const Loop* loop = k == 0 ? face->outer_loop : face->inner_loops[k - 1];
+			if (loop == nullptr || loop->face != face) {
+				return fail(solid, "loop does not point back at its face", face->faceId);
+			}
+			const HalfEdge* first = loop->first_edge;
+			if (first == nullptr) {
+				if (!edges.empty()) {
+					return fail(solid, "empty loop", loop->loopId);
+				}
+				continue;
+			}
+			const HalfEdge* he = first;
+			do {
+				if (++half_edges > 2 * edges.size()) {
+					return fail(solid, "loop does not close", loop->loopId);
+				}
+				if (!listed(edges, he->edge) || (he != he->edge->he1 && he != he->edge->he2)) {
+					return fail(solid, "half-edge of an edge not in the solid", loop->loopId);
+				}
+				if (he->loop != loop) {
+					return fail(solid, "half-edge points at another loop", loop->loopId);
+				}
+				if (he->next == nullptr || he->pre == nullptr || he->next->pre != he || he->pre->next != he) {
+					return fail(solid, "next and pre are not symmetric", loop->loopId);
+				}
+				if (he->end != he->next->start) {
+					return fail(solid, "loop is not connected", loop->loopId);
+				}
+				he = he->next;
+			} while (he != first);
+		}
+	}
+	if (half_edges != 2 * edges.size()) {
+		return fail(solid, "half-edges missing from every loop");
+	}
+
+	// shells by union-find over the edges
+	thread_local vector<uint32_t> parent;
+	parent.resize(vertices.size());
+	for (uint32_t v = 0; v < parent.size(); ++v) {
+		parent[v] = v;
+	}
+	long long shells = static_cast<long long>(vertices.size());
+	for (const Edge* edge : edges) {
+		uint32_t a = findRoot(parent, static_cast<uint32_t>(edge->he1->start->index));
+		uint32_t b = findRoot(parent, static_cast<uint32_t>(edge->he1->end->index));
+		if (a != b) {
+			parent[a] = b;
+			--shells;
+		}
+	}
+	long long chi = static_cast<long long>(vertices.size()) - static_cast<long long>(edges.size()) +
+	                static_cast<long long>(faces.size()) - static_cast<long long>(rings);
+	if (chi % 2 != 0 || shells - chi / 2 < 0) {
+		return fail(solid, "V - E + F - R does not match 2 (S - H)");
+	}
+	return TopologyError();
+}
+
+TopologyError validate(const Brep& brep, unsigned threads) {
+	atomic<size_t> first_bad(brep.solids.size());
+	parallelFor(brep.solids.size(), [&](size_t first, size_t last) {
+		for (size_t i = first; i < last && i < first_bad.load(memory_order_relaxed); ++i) {
+			if (validate(brep.solids[i])) {
+				size_t bad = first_bad.load();
+				while (i < bad && !first_bad.compare_exchange_weak(bad, i));
+				return;
+			}
+		}
+	}, threads);
+	size_t bad = first_bad.load();
+	return bad < brep.solids.size() ? validate(brep.solids[bad]) : TopologyError();
+}
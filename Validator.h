@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Brep.h"
+
+// What validate() found wrong with a solid; a default-constructed error
+// (problem == nullptr) means the solid is valid.
+struct TopologyError {
+	const char* problem = nullptr; // static text
+	const Solid* solid = nullptr;
+	int id = -1; // of the vertex, edge, loop or face concerned, -1 for the whole solid
+
+	explicit operator bool() const {
+		return problem != nullptr;
+	}
+};
+
+// Checks one solid in time linear in its size: list positions (index),
+// edge/half-edge pairing (partner is an involution, both halves point at
+// their edge and run between the same vertices), next/pre symmetry, that
+// every loop closes and every half-edge lies on exactly one loop, the
+// half-edge -> loop -> face -> solid chain, and the Euler-Poincare formula
+// V - E + F = 2 (S - H) + R with S the shells (vertex-connected components),
+// R the inner loops and H >= 0 the genus it implies. Allocates nothing
+// once the per-thread scratch for the shell count has grown to the largest
+// solid seen.
+TopologyError validate(const Solid* solid);
+
+// First error in solid order, checking the solids on up to `threads`
+// threads (0 = one per core).
+TopologyError validate(const Brep& brep, unsigned threads = 1);
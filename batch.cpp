@@ -0,0 +1,178 @@
+// Headless batch driver: builds every model script given on the command line
+// with the same command language as the viewer and reports, per model, the
+// entity counts and the build time. No window or GL context is needed.
+//
+//   batch [-o report.tsv] [-s] [-e stl|obj] [-v] [-m] [-j threads] model.txt|model.cbrep...
+//
+// A model named "-" is read from stdin. Models ending in .cbrep are binary
+// files (see BrepFile) and are loaded instead of built; -s saves every model
+// built from a script as <model>.cbrep, and -e exports every model as a
+// triangle mesh, <model>.stl or <model>.obj (see MeshFile). With -j the solids of each script
+// are built on that many threads (0 = one per core). -v checks the topology
+// of every model (see validate) and fails the models that are broken. -m adds
+// the total volume and surface area of each model's solids (see
+// massProperties) to the report. The report is tab separated with a
+// header line and goes to stdout unless -o is given. Models that fail to
+// parse are reported on stderr and make the exit status non-zero, but do not
+// stop the batch.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Brep.h"
+#include "BrepFile.h"
+#include "CommandParser.h"
+#include "MassProperties.h"
+#include "MeshFile.h"
+#include "Validator.h"
+
+using namespace std;
+
+struct ModelStats {
+	size_t solids = 0;
+	size_t faces = 0;
+	size_t loops = 0;
+	size_t edges = 0;
+	size_t vertices = 0;
+};
+
+ModelStats countEntities(const Brep& brep) {
+	ModelStats stats;
+	stats.solids = brep.solids.size();
+	for (Solid* solid : brep.solids) {
+		stats.faces += solid->faces.size();
+		stats.edges += solid->edges.size();
+		stats.vertices += solid->vertices.size();
+		for (Face* face : solid->faces) {
+			stats.loops += 1 + face->inner_loops.size();
+		}
+	}
+	return stats;
+}
+
+bool endsWith(const string& text, const string& suffix) {
+	return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+int main(int argc, char** argv) {
+	const char* report_path = nullptr;
+	bool save = false;
+	const char* export_format = nullptr;
+	bool check = false;
+	bool mass = false;
+	int threads = 1;
+	vector<const char*> models;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			report_path = argv[++i];
+		} else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-s") == 0) {
+			save = true;
+		} else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+			export_format = argv[++i];
+			if (strcmp(export_format, "stl") != 0 && strcmp(export_format, "obj") != 0) {
+				cerr << "-e takes stl or obj" << endl;
+				return 2;
+			}
+		} else if (strcmp(argv[i], "-v") == 0) {
+			check = true;
+		} else if (strcmp(argv[i], "-m") == 0) {
+			mass = true;
+		} else {
+			models.push_back(argv[i]);
+		}
+	}
+	if (models.empty()) {
+		cerr << "usage: " << argv[0] << " [-o report.tsv] [-s] [-e stl|obj] [-v] [-m] [-j threads] model.txt|model.cbrep..." << endl;
+		return 2;
+	}
+
+	ofstream report_file;
+	if (report_path) {
+		report_file.open(report_path);
+		if (!report_file) {
+			cerr << report_path << ": cannot open for writing" << endl;
+			return 2;
+		}
+	}
+	ostream& report = report_path ? report_file : cout;
+	report << "model\tsolids\tfaces\tloops\tedges\tvertices\tcommands\tms" << (mass ? "\tvolume\tarea\n" : "\n");
+
+	int failed = 0;
+	double total_ms = 0;
+	for (const char* path : models) {
+		Brep brep;
+		Modeler modeler(&brep);
+		CommandParser parser(&modeler);
+		auto start = chrono::steady_clock::now();
+		bool binary = endsWith(path, ".cbrep");
+		bool ok;
+		if (binary) {
+			BrepFile file;
+			ok = file.open(path, parser.error) && file.load(brep, parser.error);
+		} else {
+			ok = threads == 1 ? parser.parseFile(path) : parser.parseFileParallel(path, threads);
+		}
+		double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		if (!ok) {
+			if (parser.line) {
+				cerr << path << ':' << parser.line << ':' << parser.column << ": ";
+			}
+			cerr << parser.error << endl;
+			++failed;
+			continue;
+		}
+		if (check) {
+			if (TopologyError error = validate(brep, threads)) {
+				cerr << path << ": solid " << error.solid->SolidId << ": " << error.problem;
+				if (error.id >= 0) {
+					cerr << " (id " << error.id << ')';
+				}
+				cerr << endl;
+				++failed;
+				continue;
+			}
+		}
+		if (save && !binary) {
+			string error;
+			string save_path = (strcmp(path, "-") == 0 ? string("stdin") : string(path)) + ".cbrep";
+			if (!writeBrepFile(save_path.c_str(), brep, error)) {
+				cerr << error << endl;
+				++failed;
+			}
+		}
+		if (export_format) {
+			string error;
+			string export_path = (strcmp(path, "-") == 0 ? string("stdin") : string(path)) + '.' + export_format;
+			bool written = strcmp(export_format, "stl") == 0
+			                   ? writeStlFile(export_path.c_str(), brep, error, threads)
+			                   : writeObjFile(export_path.c_str(), brep, error, threads);
+			if (!written) {
+				cerr << error << endl;
+				++failed;
+			}
+		}
+		ModelStats stats = countEntities(brep);
+		report << path << '\t' << stats.solids << '\t' << stats.faces << '\t' << stats.loops << '\t'
+		       << stats.edges << '\t' << stats.vertices << '\t' << modeler.commands << '\t' << ms;
+		if (mass) {
+			double volume = 0, area = 0;
+			for (const MassProperties& properties : massProperties(brep, threads)) {
+				volume += properties.volume;
+				area += properties.area;
+			}
+			report << '\t' << volume << '\t' << area;
+		}
+		report << '\n';
+		total_ms += ms;
+	}
+	cerr << models.size() - failed << " of " << models.size() << " models built in " << total_ms << " ms"
+	     << endl;
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,428 @@
+// Microbenchmarks for the Euler operators and sweep. Every case builds a
+// parametric workload from scratch in a fresh Brep, times only the operators
+// under test (set-up and teardown are outside the clock) and repeats until
+// --min-time has been spent, keeping the fastest run.
+//
+//   cadbrep_bench [--json out.json] [--label name] [--max-size n] [--min-time s] [case...]
+//
+// Cases: mvfs, ngon, fan (MEF), plate (ring), kemr, kfmrh, sweep, sweep_plate,
+// cubes, sweep_batch, mass. Naming cases runs only those. Per case the report gives ns per Euler
+// operator call (per face for mass), heap allocations per call, vertices, edges, faces and loops
+// made or killed per second and the process's peak RSS so far.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "Brep.h"
+#include "MassProperties.h"
+
+using namespace std;
+
+// every global allocation goes through here so the cases can count them
+static atomic<size_t> allocation_count(0);
+
+void* operator new(size_t size) {
+	allocation_count.fetch_add(1, memory_order_relaxed);
+	if (void* p = malloc(size ? size : 1)) {
+		return p;
+	}
+	throw bad_alloc();
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+	free(p);
+}
+
+size_t peakRssKb() {
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return counters.PeakWorkingSetSize / 1024;
+#else
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+	return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+	return usage.ru_maxrss;
+#endif
+#endif
+}
+
+struct EntityCount {
+	size_t vertices = 0, edges = 0, faces = 0, loops = 0;
+
+	// entities made or killed to get from `before` to this count
+	size_t changedSince(const EntityCount& before) const {
+		auto delta = [](size_t a, size_t b) { return a > b ? a - b : b - a; };
+		return delta(vertices, before.vertices) + delta(edges, before.edges) + delta(faces, before.faces) +
+		       delta(loops, before.loops);
+	}
+};
+
+EntityCount countEntities(const Brep& brep) {
+	EntityCount count;
+	for (Solid* solid : brep.solids) {
+		count.vertices += solid->vertices.size();
+		count.edges += solid->edges.size();
+		count.faces += solid->faces.size();
+		for (Face* face : solid->faces) {
+			count.loops += 1 + face->inner_loops.size();
+		}
+	}
+	return count;
+}
+
+//=============================================================================
+// workload builders, all working on half-edge handles like the operators do
+//=============================================================================
+
+// n-gon lamina in the z = 0 plane; returns the face on the counter-clockwise
+// side. Costs one MVFS, n - 1 MEV and one MEF.
+Face* makePolygon(Brep& brep, size_t n, double radius, double cx, double cy) {
+	const double step = 2 * 3.14159265358979323846 / n;
+	Vertex* v0 = brep.MVFS(cx + radius, cy, 0);
+	Loop* loop = brep.solids.back()->faces[0]->outer_loop;
+	brep.MEV(loop, v0, cx + radius * cos(step), cy + radius * sin(step), 0);
+	HalfEdge* first = loop->first_edge;
+	HalfEdge* last = first;
+	for (size_t i = 2; i < n; ++i) {
+		last = brep.MEV(last, cx + radius * cos(step * i), cy + radius * sin(step * i), 0);
+	}
+	return brep.MEF(last, first->partner);
+}
+
+// Square plate spanning [-1, 1]^2.
+Face* makePlate(Brep& brep) {
+	return makePolygon(brep, 4, sqrt(2.0), 0, 0);
+}
+
+// Adds `holes` square rings on a grid to a plate, exactly like the `ring`
+// command: bridge MEV from the plate's first vertex, MEV along the ring, MEF
+// to close it and KEMR to drop the bridge (6 operators per ring). Without
+// `bridges` the KEMR is done right away; with it the bridges are collected
+// instead so KEMR can be timed on its own.
+void addRings(Brep& brep, Face* face, size_t holes, vector<HalfEdge*>* bridges = nullptr,
+              vector<Face*>* hole_faces = nullptr) {
+	HalfEdge* into_v0 = face->outer_loop->first_edge; // stays on the outer loop throughout
+	size_t side = max<size_t>(1, static_cast<size_t>(ceil(sqrt(static_cast<double>(holes)))));
+	double cell = 2.0 / side;
+	for (size_t h = 0; h < holes; ++h) {
+		double x0 = -1 + cell * (h % side + 0.2), x1 = x0 + cell * 0.6;
+		double y0 = -1 + cell * (h / side + 0.2), y1 = y0 + cell * 0.6;
+		HalfEdge* bridge = brep.MEV(into_v0, x1, y1, 0);
+		HalfEdge* ring = brep.MEV(bridge, x0, y1, 0);
+		HalfEdge* last = brep.MEV(ring, x0, y0, 0);
+		last = brep.MEV(last, x1, y0, 0);
+		Face* hole = brep.MEF(ring->partner, last);
+		if (hole_faces) {
+			hole_faces->push_back(hole);
+		}
+		if (bridges) {
+			bridges->push_back(bridge->partner);
+		} else {
+			brep.KEMR(bridge->partner);
+		}
+	}
+}
+
+//=============================================================================
+// measurement
+//=============================================================================
+
+struct Result {
+	string name;
+	size_t size = 0;
+	size_t ops = 0;
+	size_t reps = 0;
+	double seconds = 0; // fastest run
+	size_t allocations = 0;
+	size_t entities = 0;
+	size_t peak_rss_kb = 0;
+};
+
+// set_up builds the untimed part of the workload and returns whatever the
+// timed part needs; run performs the operators and returns how many it called
+template <typename SetUp, typename Run>
+Result measure(const string& name, size_t size, double min_time, SetUp set_up, Run run) {
+	Result result;
+	result.name = name;
+	result.size = size;
+	result.seconds = 1e300;
+	double spent = 0;
+	while (result.reps == 0 || (spent < min_time && result.reps < 100000)) {
+		Brep brep;
+		auto state = set_up(brep);
+		EntityCount before = countEntities(brep);
+		size_t allocations = allocation_count.load(memory_order_relaxed);
+		auto start = chrono::steady_clock::now();
+		size_t ops = run(brep, state);
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		allocations = allocation_count.load(memory_order_relaxed) - allocations;
+		if (seconds < result.seconds) {
+			result.seconds = seconds;
+			result.ops = ops;
+			result.allocations = allocations;
+			result.entities = countEntities(brep).changedSince(before);
+		}
+		spent += seconds;
+		++result.reps;
+	}
+	result.peak_rss_kb = peakRssKb();
+	return result;
+}
+
+vector<size_t> sizes(size_t from, size_t to, size_t max_size) {
+	vector<size_t> list;
+	for (size_t n = from; n <= min(to, max_size); n *= 10) {
+		list.push_back(n);
+	}
+	return list;
+}
+
+struct NoState {};
+
+void runCases(const vector<string>& only, size_t max_size, double min_time, vector<Result>& results) {
+	auto wanted = [&](const char* name) {
+		return only.empty() || find(only.begin(), only.end(), name) != only.end();
+	};
+	auto report = [&](Result result) {
+		fprintf(stderr, "%-12s %8zu  %10.1f ns/op  %7.3f allocs/op  %12.0f entities/s  %8zu KB\n",
+		        result.name.c_str(), result.size, result.seconds * 1e9 / max<size_t>(1, result.ops),
+		        double(result.allocations) / max<size_t>(1, result.ops), result.entities / result.seconds,
+		        result.peak_rss_kb);
+		results.push_back(result);
+	};
+
+	if (wanted("mvfs")) {
+		for (size_t m : sizes(10, 100000, max_size)) {
+			report(measure("mvfs", m, min_time, [](Brep&) { return NoState(); }, [m](Brep& brep, NoState) {
+				for (size_t i = 0; i < m; ++i) {
+					brep.MVFS(double(i), 0, 0);
+				}
+				return m;
+			}));
+		}
+	}
+	if (wanted("ngon")) {
+		vector<size_t> ngon_sizes = sizes(10, 1000000, max_size);
+		ngon_sizes.insert(ngon_sizes.begin(), 3);
+		for (size_t n : ngon_sizes) {
+			report(measure("ngon", n, min_time, [](Brep&) { return NoState(); }, [n](Brep& brep, NoState) {
+				makePolygon(brep, n, 1, 0, 0);
+				return n + 1;
+			}));
+		}
+	}
+	if (wanted("fan")) {
+		// triangle fan over an n-gon: n - 3 MEF, each cutting off one triangle
+		for (size_t n : sizes(10, 1000000, max_size)) {
+			report(measure("fan", n, min_time, [n](Brep& brep) {
+				Face* face = makePolygon(brep, n, 1, 0, 0);
+				return face->outer_loop->first_edge; // ends at the fan's apex
+			}, [n](Brep& brep, HalfEdge* apex) {
+				for (size_t i = 3; i < n; ++i) {
+					brep.MEF(apex->next->next, apex);
+				}
+				return n - 3;
+			}));
+		}
+	}
+	if (wanted("plate")) {
+		for (size_t k : sizes(1, 10000, max_size)) {
+			report(measure("plate", k, min_time, [](Brep& brep) { return makePlate(brep); },
+			               [k](Brep& brep, Face* face) {
+				addRings(brep, face, k);
+				return 6 * k;
+			}));
+		}
+	}
+	if (wanted("kemr")) {
+		for (size_t k : sizes(1, 10000, max_size)) {
+			report(measure("kemr", k, min_time, [k](Brep& brep) {
+				vector<HalfEdge*> bridges;
+				addRings(brep, makePlate(brep), k, &bridges);
+				return bridges;
+			}, [](Brep& brep, const vector<HalfEdge*>& bridges) {
+				for (HalfEdge* bridge : bridges) {
+					brep.KEMR(bridge);
+				}
+				return bridges.size();
+			}));
+		}
+	}
+	if (wanted("kfmrh")) {
+		// punch every ring of a plate through to the other side of the lamina
+		for (size_t k : sizes(1, 10000, max_size)) {
+			report(measure("kfmrh", k, min_time, [k](Brep& brep) {
+				vector<Face*> holes;
+				addRings(brep, makePlate(brep), k, nullptr, &holes);
+				return holes;
+			}, [](Brep& brep, const vector<Face*>& holes) {
+				Solid* solid = brep.solids.back();
+				Face* back = solid->faces[0];
+				for (Face* hole : holes) {
+					brep.KFMRH(back, hole);
+				}
+				return holes.size();
+			}));
+		}
+	}
+	if (wanted("sweep")) {
+		// one MEV and one MEF per vertex of the swept n-gon
+		for (size_t n : sizes(10, 1000000, max_size)) {
+			report(measure("sweep", n, min_time, [n](Brep& brep) { return makePolygon(brep, n, 1, 0, 0); },
+			               [n](Brep& brep, Face* face) {
+				brep.sweep(face, 0, 0, -1);
+				return 2 * n;
+			}));
+		}
+	}
+	if (wanted("sweep_plate")) {
+		// 4 + 4k vertices swept, plus one KFMRH per hole
+		for (size_t k : sizes(1, 10000, max_size)) {
+			report(measure("sweep_plate", k, min_time, [k](Brep& brep) {
+				Face* face = makePlate(brep);
+				addRings(brep, face, k);
+				return face;
+			},
+			               [k](Brep& brep, Face* face) {
+				brep.sweep(face, 0, 0, -0.5);
+				return 2 * (4 + 4 * k) + k;
+			}));
+		}
+	}
+	if (wanted("cubes")) {
+		// many independent solids: a square swept into a cube, 13 operators each
+		for (size_t m : sizes(1, 100000, max_size)) {
+			report(measure("cubes", m, min_time, [](Brep&) { return NoState(); }, [m](Brep& brep, NoState) {
+				for (size_t i = 0; i < m; ++i) {
+					brep.sweep(makePolygon(brep, 4, 0.5, 2.0 * i, 0), 0, 0, 1);
+				}
+				return 13 * m;
+			}));
+		}
+	}
+	if (wanted("sweep_batch")) {
+		// m squares swept by one batched call on every core, 8 operators each
+		for (size_t m : sizes(1, 100000, max_size)) {
+			report(measure("sweep_batch", m, min_time, [m](Brep& brep) {
+				vector<Face*> faces;
+				for (size_t i = 0; i < m; ++i) {
+					faces.push_back(makePolygon(brep, 4, 0.5, 2.0 * i, 0));
+				}
+				return faces;
+			},
+			               [m](Brep& brep, const vector<Face*>& faces) {
+				brep.sweep(faces, { Point(0, 0, 1) }, 0);
+				return 8 * m;
+			}));
+		}
+	}
+	if (wanted("mass")) {
+		// mass properties of m cubes on every core, 6 faces each
+		for (size_t m : sizes(1, 100000, max_size)) {
+			report(measure("mass", m, min_time, [m](Brep& brep) {
+				for (size_t i = 0; i < m; ++i) {
+					brep.sweep(makePolygon(brep, 4, 0.5, 2.0 * i, 0), 0, 0, 1);
+				}
+				return NoState();
+			}, [m](Brep& brep, NoState) {
+				vector<MassProperties> properties = massProperties(brep, 0);
+				return 6 * m;
+			}));
+		}
+	}
+}
+
+void writeJson(ostream& out, const string& label, const vector<Result>& results) {
+	out << "{\n  \"label\": \"" << label << "\",\n  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); ++i) {
+		const Result& r = results[i];
+		size_t ops = max<size_t>(1, r.ops);
+		char line[512];
+		snprintf(line, sizeof(line),
+		         "    {\"name\": \"%s\", \"size\": %zu, \"ops\": %zu, \"reps\": %zu, \"seconds\": %.9g, "
+		         "\"ns_per_op\": %.6g, \"allocs_per_op\": %.6g, \"entities\": %zu, \"entities_per_sec\": %.6g, "
+		         "\"peak_rss_kb\": %zu}%s\n",
+		         r.name.c_str(), r.size, r.ops, r.reps, r.seconds, r.seconds * 1e9 / ops,
+		         double(r.allocations) / ops, r.entities, r.entities / r.seconds, r.peak_rss_kb,
+		         i + 1 < results.size() ? "," : "");
+		out << line;
+	}
+	out << "  ]\n}\n";
+}
+
+int main(int argc, char** argv) {
+	const char* json_path = nullptr;
+	string label;
+	size_t max_size = 1000000;
+	double min_time = 0.2;
+	vector<string> only;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+			json_path = argv[++i];
+		} else if (strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+			label = argv[++i];
+		} else if (strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) {
+			max_size = strtoull(argv[++i], nullptr, 10);
+		} else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+			min_time = atof(argv[++i]);
+		} else if (argv[i][0] == '-') {
+			cerr << "usage: " << argv[0]
+			     << " [--json out.json] [--label name] [--max-size n] [--min-time s] [case...]" << endl;
+			return 2;
+		} else {
+			only.push_back(argv[i]);
+		}
+	}
+
+	vector<Result> results;
+	runCases(only, max_size, min_time, results);
+
+	if (json_path) {
+		ofstream out(json_path);
+		if (!out) {
+			cerr << json_path << ": cannot open for writing" << endl;
+			return 2;
+		}
+		writeJson(out, label, results);
+	} else {
+		writeJson(cout, label, results);
+	}
+	return 0;
+}
@@ -0,0 +1,121 @@
+#include "Support.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "CommandParser.h"
+#include "Test.h"
+
+void build(Brep& brep, const std::string& script) {
+	Modeler modeler(&brep);
+	CommandParser parser(&modeler);
+	bool ok = parser.parse(script.data(), script.size());
+	if (!ok) {
+		test::fail(__FILE__, __LINE__, "script does not parse: " + parser.error);
+		throw test::Abort();
+	}
+}
+
+std::vector<std::string> commands(const std::string& script) {
+	std::vector<std::string> parts;
+	std::istringstream lines(script);
+	for (std::string line; std::getline(lines, line);) {
+		size_t first = line.find_first_not_of(" \t\r");
+		if (first != std::string::npos && isalpha(static_cast<unsigned char>(line[first]))) {
+			if (line.compare(first, 6, "finish") == 0) {
+				break;
+			}
+			parts.emplace_back();
+		}
+		if (!parts.empty()) {
+			parts.back() += line + '\n';
+		}
+	}
+	return parts;
+}
+
+std::string sourcePath(const char* name) {
+	return std::string(CADBREP_SOURCE_DIR) + "/" + name;
+}
+
+std::string writeFile(const char* name, const std::string& text) {
+	std::ofstream(name, std::ios::binary) << text;
+	return name;
+}
+
+namespace {
+
+// half-edge as "<edge id>+" (he1) or "<edge id>-" (he2)
+std::pair<int, int> key(const HalfEdge* he) {
+	return { he->edge->EdgeId, he == he->edge->he1 ? 0 : 1 };
+}
+
+void dumpLoop(std::ostringstream& out, const Loop* loop) {
+	out << "  loop " << loop->loopId << ':';
+	std::vector<std::pair<int, int>> keys;
+	if (const HalfEdge* he = loop->first_edge) {
+		do {
+			keys.push_back(key(he));
+			he = he->next;
+		} while (he != loop->first_edge);
+	}
+	std::rotate(keys.begin(), std::min_element(keys.begin(), keys.end()), keys.end());
+	for (auto [edge, side] : keys) {
+		out << ' ' << edge << (side ? '-' : '+');
+	}
+	out << '\n';
+}
+
+template <typename T, typename Id>
+std::vector<const T*> sorted(const std::vector<T*>& list, Id id) {
+	std::vector<const T*> items(list.begin(), list.end());
+	std::sort(items.begin(), items.end(), [&](const T* a, const T* b) { return id(a) < id(b); });
+	return items;
+}
+
+} // namespace
+
+std::string dump(const Brep& brep) {
+	std::ostringstream out;
+	out.precision(17);
+	for (const Solid* solid : sorted(brep.solids, [](const Solid* s) { return s->SolidId; })) {
+		out << "solid " << solid->SolidId << '\n';
+		for (const Vertex* v : sorted(solid->vertices, [](const Vertex* v) { return v->VertexId; })) {
+			out << " vertex " << v->VertexId << ' ' << v->point->x << ' ' << v->point->y << ' ' << v->point->z
+			    << '\n';
+		}
+		for (const Edge* e : sorted(solid->edges, [](const Edge* e) { return e->EdgeId; })) {
+			out << " edge " << e->EdgeId << ' ' << e->he1->start->VertexId << ' ' << e->he1->end->VertexId << ' '
+			    << e->he1->loop->loopId << ' ' << e->he2->loop->loopId << '\n';
+		}
+		for (const Face* f : sorted(solid->faces, [](const Face* f) { return f->faceId; })) {
+			out << " face " << f->faceId << '\n';
+			dumpLoop(out, f->outer_loop);
+			for (const Loop* loop : sorted(f->inner_loops, [](const Loop* l) { return l->loopId; })) {
+				dumpLoop(out, loop);
+			}
+		}
+	}
+	return out.str();
+}
+
+HalfEdge* findHalfEdge(const Face* face, const Point& a, const Point& b) {
+	auto same = [](const Point* p, const Point& q) { return p->x == q.x && p->y == q.y && p->z == q.z; };
+	for (size_t l = 0; l <= face->inner_loops.size(); ++l) {
+		const Loop* loop = l == 0 ? face->outer_loop : face->inner_loops[l - 1];
+		HalfEdge* he = loop->first_edge;
+		if (he == nullptr) {
+			continue;
+		}
+		do {
+			if (same(he->start->point, a) && same(he->end->point, b)) {
+				return he;
+			}
+			he = he->next;
+		} while (he != loop->first_edge);
+	}
+	return nullptr;
+}
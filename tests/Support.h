@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Brep.h"
+
+// Helpers shared by the test groups.
+
+// Runs a script of the command language (see Modeler) on brep; the case
+// fails and stops if the script does not parse.
+void build(Brep& brep, const std::string& script);
+
+// The script cut before every command keyword, one command per part, up
+// to finish.
+std::vector<std::string> commands(const std::string& script);
+
+// A file of the source tree, e.g. sourcePath("input.txt").
+std::string sourcePath(const char* name);
+
+// Writes text to name in the working directory (the build tree under
+// CTest) and returns the path.
+std::string writeFile(const char* name, const std::string& text);
+
+// Every solid, vertex, edge, face and loop with its id, coordinates and
+// links, each kind sorted by id and every loop starting at its smallest
+// half-edge. Two Breps dump the same exactly when they have the same ids
+// and topology, whatever the order of the entity lists.
+std::string dump(const Brep& brep);
+
+// The half-edges of a face running from a to b, or nullptr.
+HalfEdge* findHalfEdge(const Face* face, const Point& a, const Point& b);
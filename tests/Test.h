@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Minimal test registry for cadbrep_tests, which needs nothing beyond the
+// core library. TEST(group, name) defines a case and registers it as
+// "group.name"; tests/<group>.cpp holds the cases of a group and CTest runs
+// every group as one test (cadbrep_tests <group>). CHECK records a failure
+// and lets the case go on, REQUIRE ends the case there.
+namespace test {
+
+struct Case {
+	const char* group;
+	const char* name;
+	void (*run)();
+};
+
+std::vector<Case>& cases();
+
+struct Registrar {
+	Registrar(const char* group, const char* name, void (*run)()) {
+		cases().push_back({ group, name, run });
+	}
+};
+
+// thrown by REQUIRE, caught by the runner
+struct Abort {};
+
+void fail(const char* file, int line, const std::string& what);
+
+} // namespace test
+
+#define TEST(group, name) \
+	static void test_##group##_##name(); \
+	static test::Registrar registrar_##group##_##name(#group, #name, test_##group##_##name); \
+	static void test_##group##_##name()
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			test::fail(__FILE__, __LINE__, #condition); \
+		} \
+	} while (0)
+
+#define REQUIRE(condition) \
+	do { \
+		if (!(condition)) { \
+			test::fail(__FILE__, __LINE__, #condition); \
+			throw test::Abort(); \
+		} \
+	} while (0)
+
+// |a - b| <= tolerance, with both values in the failure message
+#define CHECK_NEAR(a, b, tolerance) \
+	do { \
+		double check_a = (a), check_b = (b); \
+		if (!(check_a - check_b <= (tolerance) && check_b - check_a <= (tolerance))) { \
+			test::fail(__FILE__, __LINE__, \
+			           std::string(#a " == " #b ": ") + std::to_string(check_a) + " vs " + std::to_string(check_b)); \
+		} \
+	} while (0)
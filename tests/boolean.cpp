@@ -0,0 +1,128 @@
+// Boolean operations: volumes of the results against values worked out by
+// hand, faces with holes in either winding, solids in contact along whole
+// faces, and the rejection of solids that only touch along an edge.
+
+#include "Boolean.h"
+#include "MassProperties.h"
+#include "Support.h"
+#include "Test.h"
+#include "Validator.h"
+
+namespace {
+
+const double tolerance = 1e-9;
+
+// axis-aligned box with outward faces
+string box(double x0, double y0, double z0, double x1, double y1, double z1) {
+	auto point = [](double x, double y, double z) {
+		return to_string(x) + ' ' + to_string(y) + ' ' + to_string(z) + '\n';
+	};
+	return "face 4\n" + point(x0, y0, z1) + point(x1, y0, z1) + point(x1, y1, z1) + point(x0, y1, z1) +
+	       "sweep\n0 0 " + to_string(z0 - z1) + '\n';
+}
+
+// 4 by 4 by 1 plate with a 1 by 1 hole from 1 1 to 2 2, its ring given in
+// either winding
+string holedPlate(bool ring_against) {
+	return string("face 4\n0 0 0\n4 0 0\n4 4 0\n0 4 0\n") +
+	       (ring_against ? "ring 4\n1 1 0\n1 2 0\n2 2 0\n2 1 0\n" : "ring 4\n1 1 0\n2 1 0\n2 2 0\n1 2 0\n") +
+	       "sweep\n0 0 -1\n";
+}
+
+// Builds the script, applies the operation to the last two solids and
+// returns the volume of the result (checked to be valid and to have
+// replaced them).
+double apply(const string& script, Boolean::Operation operation, unsigned threads = 0) {
+	Brep brep;
+	build(brep, script);
+	size_t count = brep.solids.size();
+	REQUIRE(count >= 2);
+	Boolean boolean;
+	boolean.threads = threads;
+	Solid* result = boolean.apply(brep, brep.solids[count - 2], brep.solids[count - 1], operation);
+	if (result == nullptr) {
+		test::fail(__FILE__, __LINE__, boolean.error);
+		throw test::Abort();
+	}
+	CHECK(brep.solids.size() == count - 1);
+	CHECK(brep.solids.back() == result);
+	CHECK(!validate(result));
+	return massProperties(result).volume;
+}
+
+} // namespace
+
+TEST(boolean, boxes) {
+	string boxes = box(0, 0, 0, 2, 2, 2) + box(1, 1, 1, 3, 4, 5);
+	CHECK_NEAR(apply(boxes, Boolean::Operation::unite), 8 + 24 - 1, tolerance);
+	CHECK_NEAR(apply(boxes, Boolean::Operation::subtract), 8 - 1, tolerance);
+	CHECK_NEAR(apply(boxes, Boolean::Operation::intersect), 1, tolerance);
+	CHECK_NEAR(apply(boxes, Boolean::Operation::unite, 1), 8 + 24 - 1, tolerance);
+}
+
+TEST(boolean, holes) {
+	for (bool ring_against : { true, false }) {
+		// a box over the hole and 0.5 around it, through the plate
+		string script = holedPlate(ring_against) + box(0.5, 0.5, -2, 2.5, 2.5, 1);
+		CHECK_NEAR(apply(script, Boolean::Operation::unite), 15 + 12 - 3, tolerance);
+		CHECK_NEAR(apply(script, Boolean::Operation::subtract), 15 - 3, tolerance);
+		CHECK_NEAR(apply(script, Boolean::Operation::intersect), 3, tolerance);
+	}
+	// input.txt's first solid, its rings the same way as its outer loop,
+	// less a box over the corner of one hole
+	string script = "face 4\n1 1 0.5\n-1 1 0.5\n-1 -1 0.5\n1 -1 0.5\n"
+	                "ring 4\n0.2 0.2 0.5\n0.8 0.2 0.5\n0.8 0.8 0.5\n0.2 0.8 0.5\n"
+	                "ring 4\n-0.8 0.2 0.5\n-0.2 0.2 0.5\n-0.2 0.8 0.5\n-0.8 0.8 0.5\n"
+	                "ring 4\n-0.8 -0.8 0.5\n-0.2 -0.8 0.5\n-0.2 -0.2 0.5\n-0.8 -0.2 0.5\n"
+	                "ring 4\n0.2 -0.8 0.5\n0.8 -0.8 0.5\n0.8 -0.2 0.5\n0.2 -0.2 0.5\n"
+	                "sweep\n0 0 -0.5\n" +
+	                box(0.5, 0.5, -1, 1.5, 1.5, 2);
+	CHECK_NEAR(apply(script, Boolean::Operation::subtract), 1.28 - (0.25 - 0.09) * 0.5, tolerance);
+}
+
+TEST(boolean, coplanar_contact) {
+	// sharing a whole face
+	string side_by_side = box(0, 0, 0, 1, 1, 1) + box(1, 0, 0, 2, 1, 1);
+	CHECK_NEAR(apply(side_by_side, Boolean::Operation::unite), 2, tolerance);
+	CHECK_NEAR(apply(side_by_side, Boolean::Operation::subtract), 1, tolerance);
+	// overlapping, with four pairs of faces in the same planes
+	string overlapping = box(0, 0, 0, 2, 1, 1) + box(1, 0, 0, 3, 1, 1);
+	CHECK_NEAR(apply(overlapping, Boolean::Operation::unite), 3, tolerance);
+	CHECK_NEAR(apply(overlapping, Boolean::Operation::subtract), 1, tolerance);
+	CHECK_NEAR(apply(overlapping, Boolean::Operation::intersect), 1, tolerance);
+	// one inside the other, touching it from within
+	string inside = box(0, 0, 0, 3, 3, 3) + box(0, 1, 1, 1, 2, 2);
+	CHECK_NEAR(apply(inside, Boolean::Operation::subtract), 27 - 1, tolerance);
+	CHECK_NEAR(apply(inside, Boolean::Operation::intersect), 1, tolerance);
+}
+
+TEST(boolean, edge_touch_is_rejected) {
+	string boxes = box(0, 0, 0, 1, 1, 1) + box(1, 1, 0, 2, 2, 1);
+	for (Boolean::Operation operation : { Boolean::Operation::unite, Boolean::Operation::intersect }) {
+		Brep brep;
+		build(brep, boxes);
+		string before = dump(brep);
+		Boolean boolean;
+		CHECK(boolean.apply(brep, brep.solids[0], brep.solids[1], operation) == nullptr);
+		CHECK(boolean.error != nullptr);
+		CHECK(dump(brep) == before);
+	}
+	// the difference is the first box, untouched
+	CHECK_NEAR(apply(boxes, Boolean::Operation::subtract), 1, tolerance);
+}
+
+TEST(boolean, one_undo_step) {
+	Brep brep;
+	brep.startJournal();
+	build(brep, holedPlate(true) + box(0.5, 0.5, -2, 2.5, 2.5, 1));
+	string before = dump(brep);
+	Boolean boolean;
+	REQUIRE(boolean.apply(brep, brep.solids[0], brep.solids[1], Boolean::Operation::subtract) != nullptr);
+	brep.endStep();
+	string after = dump(brep);
+	REQUIRE(brep.undo());
+	CHECK(dump(brep) == before);
+	CHECK(!validate(brep));
+	REQUIRE(brep.redo());
+	CHECK(dump(brep) == after);
+}
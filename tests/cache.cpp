@@ -0,0 +1,152 @@
+// The boxes and planes the Euler operators keep up to date against ones
+// computed from scratch, after every command, undo and redo.
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+
+#include "CommandParser.h"
+#include "Support.h"
+#include "Test.h"
+
+namespace {
+
+const char* holed_revolves = "face 4\n2 0 0\n4 0 0\n4 0 2\n2 0 2\n"
+                             "ring 4\n2.5 0 0.5\n2.5 0 1.5\n3.5 0 1.5\n3.5 0 0.5\n"
+                             "revolve\n0 0 0\n0 0 1\n360 8\n"
+                             "face 4\n10 0 0\n12 0 0\n12 0 2\n10 0 2\n"
+                             "ring 4\n10.5 0 0.5\n10.5 0 1.5\n11.5 0 1.5\n11.5 0 0.5\n"
+                             "revolve\n0 0 0\n0 0 1\n-90 5\n";
+
+string inputTxt() {
+	ifstream file(sourcePath("input.txt"), ios::binary);
+	return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+}
+
+bool same(const Box& a, const Box& b) {
+	for (int i = 0; i < 3; ++i) {
+		if (a.min[i] != b.min[i] || a.max[i] != b.max[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void checkBoxes(const Brep& brep) {
+	for (const Solid* solid : brep.solids) {
+		Box box;
+		for (const Vertex* vertex : solid->vertices) {
+			box.add(*vertex->point);
+		}
+		CHECK(same(solid->box(), box));
+		for (const Face* face : solid->faces) {
+			Box face_box;
+			for (size_t l = 0; l <= face->inner_loops.size(); ++l) {
+				const Loop* loop = l == 0 ? face->outer_loop : face->inner_loops[l - 1];
+				if (const HalfEdge* he = loop->first_edge) {
+					do {
+						face_box.add(*he->start->point);
+						he = he->next;
+					} while (he != loop->first_edge);
+				}
+			}
+			CHECK(same(face->box(), face_box));
+		}
+	}
+}
+
+// sweep and revolve move planes with the loops instead of computing them
+// again, so they agree up to rounding
+void checkPlanes(const Brep& brep) {
+	for (const Solid* solid : brep.solids) {
+		for (const Face* face : solid->faces) {
+			double normal[3] = { 0, 0, 0 }, centroid[3] = { 0, 0, 0 };
+			size_t count = 0;
+			if (const HalfEdge* he = face->outer_loop->first_edge) {
+				do {
+					const Point *a = he->start->point, *b = he->end->point;
+					normal[0] += (a->y - b->y) * (a->z + b->z);
+					normal[1] += (a->z - b->z) * (a->x + b->x);
+					normal[2] += (a->x - b->x) * (a->y + b->y);
+					centroid[0] += a->x;
+					centroid[1] += a->y;
+					centroid[2] += a->z;
+					++count;
+					he = he->next;
+				} while (he != face->outer_loop->first_edge);
+			}
+			double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			double d = 0;
+			for (int i = 0; i < 3; ++i) {
+				normal[i] = length > 0 ? normal[i] / length : 0;
+				d -= count ? normal[i] * centroid[i] / count : 0;
+			}
+			const Plane& plane = face->plane();
+			for (int i = 0; i < 3; ++i) {
+				CHECK_NEAR(plane.normal[i], normal[i], 1e-12);
+			}
+			CHECK_NEAR(plane.d, d, 1e-12 * (1 + fabs(d)));
+		}
+	}
+}
+
+// Runs the script one command at a time with the journal on, then undoes
+// every command and redoes them all, calling check after each.
+void walk(const string& script, const function<void(const Brep&)>& check) {
+	Brep brep;
+	brep.startJournal();
+	Modeler modeler(&brep);
+	vector<string> parts = commands(script);
+	for (const string& part : parts) {
+		CommandParser parser(&modeler); // one per input
+		REQUIRE(parser.parse(part.data(), part.size()));
+		check(brep);
+	}
+	while (brep.undo()) {
+		check(brep);
+	}
+	while (brep.redo()) {
+		check(brep);
+	}
+}
+
+} // namespace
+
+TEST(cache, boxes) {
+	walk(inputTxt(), checkBoxes);
+	walk(holed_revolves, checkBoxes);
+}
+
+TEST(cache, planes) {
+	walk(inputTxt(), checkPlanes);
+	walk(holed_revolves, checkPlanes);
+	// far from the origin, where a plane moved by a sweep must still match
+	walk("face 4\n1000000 2000000 3\n1000002 2000000 3\n1000002 2000003 3\n1000000 2000003 3\n"
+	     "ring 3\n1000000.5 2000000.5 3\n1000001.5 2000000.5 3\n1000001 2000002 3\nsweep\n0.5 0 -4\n",
+	     checkPlanes);
+}
+
+TEST(cache, local_edits) {
+	// a dangling edge grows the face and solid boxes, killing it shrinks
+	// them; the plane stays that of the square
+	Brep brep;
+	build(brep, "face 4\n0 0 0\n1 0 0\n1 1 0\n0 1 0\nsweep\n0 0 -1\n");
+	checkBoxes(brep);
+	checkPlanes(brep);
+	Solid* solid = brep.solids[0];
+	Face* face = solid->faces.back();
+	Plane plane = face->plane();
+	brep.MEV(face->outer_loop, face->outer_loop->first_edge->start, 0.5, 0.5, 5);
+	CHECK(solid->box().max[2] == 5);
+	checkBoxes(brep);
+	CHECK(memcmp(&face->plane(), &plane, sizeof(Plane)) == 0);
+	HalfEdge* he = face->outer_loop->first_edge;
+	while (he->next != he->partner) {
+		he = he->next;
+	}
+	brep.KEV(he);
+	CHECK(solid->box().max[2] == 0);
+	checkBoxes(brep);
+	checkPlanes(brep);
+}
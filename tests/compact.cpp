@@ -0,0 +1,143 @@
+// Euler operators on CompactSolid: the same calls as on a Brep make the same
+// arrays as converting the Brep's solid.
+
+#include <cmath>
+
+#include "CompactBrep.h"
+#include "Test.h"
+#include "Validator.h"
+
+namespace {
+
+// corner i of a regular n-gon of radius 10 around the origin
+Point corner(int n, int i) {
+	double angle = 2 * 3.14159265358979323846 * i / n;
+	return Point(10 * cos(angle), 10 * sin(angle), 0);
+}
+
+// corner j of the square ring k, the rings in a row along the x axis,
+// half of them running the other way
+Point ringCorner(int k, int j) {
+	const double xs[4] = { 0, 1, 1, 0 }, ys[4] = { 0, 0, 1, 1 };
+	int m = k % 2 ? 3 - j : j;
+	return Point(-4 + 2 * k + xs[m], -0.5 + ys[m], 0);
+}
+
+// The n-gon with the rings, built the way Modeler does it; returns the face.
+Face* buildPlate(Brep& brep, int n, int rings) {
+	Point p = corner(n, 0);
+	Vertex* v0 = brep.MVFS(p.x, p.y, p.z);
+	Loop* loop = brep.solids.back()->faces[0]->outer_loop;
+	p = corner(n, 1);
+	brep.MEV(loop, v0, p.x, p.y, p.z);
+	HalfEdge* first = loop->first_edge;
+	HalfEdge* last = first;
+	for (int i = 2; i < n; ++i) {
+		p = corner(n, i);
+		last = brep.MEV(last, p.x, p.y, p.z);
+	}
+	Face* face = brep.MEF(last, first->partner);
+	for (int k = 0; k < rings; ++k) {
+		HalfEdge* he = face->outer_loop->first_edge;
+		while (he->end != v0) {
+			he = he->next;
+		}
+		p = ringCorner(k, 0);
+		HalfEdge* bridge = brep.MEV(he, p.x, p.y, p.z);
+		last = bridge;
+		for (int j = 1; j < 4; ++j) {
+			p = ringCorner(k, j);
+			last = brep.MEV(last, p.x, p.y, p.z);
+			if (j == 1) {
+				first = last;
+			}
+		}
+		if (k % 2) {
+			brep.MEF(last, bridge);
+		} else {
+			brep.MEF(first->partner, last);
+		}
+		brep.KEMR(bridge->partner);
+	}
+	return face;
+}
+
+uint32_t buildPlate(CompactSolid& solid, int n, int rings) {
+	Point p = corner(n, 1);
+	solid.MEV(0, 0, p.x, p.y, p.z);
+	uint32_t first = solid.loop_first[0];
+	uint32_t last = first;
+	for (int i = 2; i < n; ++i) {
+		p = corner(n, i);
+		last = solid.MEV(last, p.x, p.y, p.z);
+	}
+	uint32_t face = solid.MEF(last, first ^ 1);
+	for (int k = 0; k < rings; ++k) {
+		uint32_t he = solid.loop_first[solid.face_outer[face]];
+		while (solid.end(he) != 0) {
+			he = solid.he_next[he];
+		}
+		p = ringCorner(k, 0);
+		uint32_t bridge = solid.MEV(he, p.x, p.y, p.z);
+		last = bridge;
+		for (int j = 1; j < 4; ++j) {
+			p = ringCorner(k, j);
+			last = solid.MEV(last, p.x, p.y, p.z);
+			if (j == 1) {
+				first = last;
+			}
+		}
+		if (k % 2) {
+			solid.MEF(last, bridge);
+		} else {
+			solid.MEF(first ^ 1, last);
+		}
+		solid.KEMR(bridge ^ 1);
+	}
+	return face;
+}
+
+// compact against the conversion of solid, field by field
+void checkSame(const CompactSolid& compact, const Solid* solid) {
+	REQUIRE(compact.view().valid());
+	CompactSolid expected(solid);
+	CHECK(compact.x == expected.x);
+	CHECK(compact.y == expected.y);
+	CHECK(compact.z == expected.z);
+	CHECK(compact.he_next == expected.he_next);
+	CHECK(compact.he_prev == expected.he_prev);
+	CHECK(compact.he_vertex == expected.he_vertex);
+	CHECK(compact.faceCount() == expected.faceCount());
+	// the operators number loops in the order they make them, the
+	// conversion face by face; going through a Solid renumbers them
+	Brep brep;
+	CompactSolid renumbered(compact.expand(brep));
+	CHECK(!validate(brep));
+	CHECK(renumbered.he_loop == expected.he_loop);
+	CHECK(renumbered.loop_first == expected.loop_first);
+	CHECK(renumbered.loop_face == expected.loop_face);
+	CHECK(renumbered.loop_next == expected.loop_next);
+	CHECK(renumbered.face_outer == expected.face_outer);
+}
+
+} // namespace
+
+TEST(compact, plates) {
+	for (int n : { 3, 8, 50 }) {
+		for (int rings : { 0, 1, 4 }) {
+			Brep brep;
+			Face* face = buildPlate(brep, n, rings);
+			CompactBrep compact;
+			CompactSolid& solid = compact.solids[compact.MVFS(corner(n, 0).x, corner(n, 0).y, corner(n, 0).z)];
+			uint32_t compact_face = buildPlate(solid, n, rings);
+			checkSame(solid, brep.solids[0]);
+
+			brep.sweep(face, 0, 0, -1);
+			solid.sweep(compact_face, 0, 0, -1);
+			checkSame(solid, brep.solids[0]);
+			CHECK(!validate(brep));
+			CHECK(solid.faceCount() == uint32_t(2 + n + 4 * rings));
+			CHECK(solid.loopCount() == uint32_t(2 + n + 6 * rings));
+		}
+	}
+}
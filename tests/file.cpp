@@ -0,0 +1,139 @@
+// .cbrep files: saving a loaded model writes the same bytes again, and
+// damaged files are turned away.
+
+#include <cstring>
+#include <fstream>
+
+#include "BrepFile.h"
+#include "MassProperties.h"
+#include "Support.h"
+#include "Test.h"
+#include "Validator.h"
+
+namespace {
+
+const char* holed_revolve = "face 4\n2 0 0\n4 0 0\n4 0 2\n2 0 2\n"
+                            "ring 4\n2.5 0 0.5\n2.5 0 1.5\n3.5 0 1.5\n3.5 0 0.5\n"
+                            "revolve\n0 0 0\n0 0 1\n360 8\n"
+                            "face 4\n10 0 0\n12 0 0\n12 0 2\n10 0 2\nrevolve\n0 0 0\n0 0 1\n-90 5\n";
+
+string readBytes(const string& path) {
+	ifstream file(path, ios::binary);
+	return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+}
+
+string save(const Brep& brep, const char* name) {
+	string error;
+	bool ok = writeBrepFile(name, brep, error);
+	if (!ok) {
+		test::fail(__FILE__, __LINE__, error);
+		throw test::Abort();
+	}
+	return readBytes(name);
+}
+
+// what open or load says about the file, empty when it loads
+string loadError(const char* name, const string& bytes) {
+	writeFile(name, bytes);
+	BrepFile file;
+	Brep brep;
+	string error;
+	if (file.open(name, error) && file.load(brep, error)) {
+		return string();
+	}
+	return error;
+}
+
+void roundTrip(const string& script) {
+	Brep brep;
+	build(brep, script);
+	string saved = save(brep, "round_trip.cbrep");
+	BrepFile file;
+	Brep loaded;
+	string error;
+	REQUIRE(file.open("round_trip.cbrep", error));
+	REQUIRE(file.solidCount() == brep.solids.size());
+	REQUIRE(file.load(loaded, error));
+	CHECK(!validate(loaded));
+	REQUIRE(loaded.solids.size() == brep.solids.size());
+	for (size_t s = 0; s < brep.solids.size(); ++s) {
+		const Solid* a = brep.solids[s];
+		const Solid* b = loaded.solids[s];
+		CHECK(a->vertices.size() == b->vertices.size());
+		CHECK(a->edges.size() == b->edges.size());
+		CHECK(a->faces.size() == b->faces.size());
+		MassProperties ma = massProperties(a), mb = massProperties(b);
+		CHECK(ma.volume == mb.volume);
+		CHECK(ma.area == mb.area);
+	}
+	CHECK(save(loaded, "round_trip_again.cbrep") == saved);
+
+	// the same through a CompactSolid in memory
+	Brep expanded;
+	for (const Solid* solid : brep.solids) {
+		CompactSolid(solid).expand(expanded);
+	}
+	CHECK(!validate(expanded));
+	CHECK(save(expanded, "round_trip_compact.cbrep") == saved);
+}
+
+} // namespace
+
+TEST(file, round_trip) {
+	roundTrip(readBytes(sourcePath("input.txt")));
+	roundTrip(holed_revolve);
+}
+
+TEST(file, damaged_files) {
+	Brep brep;
+	build(brep, holed_revolve);
+	string saved = save(brep, "damaged.cbrep");
+	CHECK(loadError("damaged.cbrep", saved).empty());
+
+	CHECK(loadError("damaged.cbrep", "") == "damaged.cbrep: not a .cbrep file");
+	string bytes = saved;
+	bytes[0] = 'X';
+	CHECK(loadError("damaged.cbrep", bytes) == "damaged.cbrep: not a .cbrep file");
+	CHECK(loadError("damaged.cbrep", saved.substr(0, saved.size() - 8)) == "damaged.cbrep: truncated file");
+
+	// the first he_next of solid 1 pointing past the half-edges
+	uint64_t offset;
+	memcpy(&offset, saved.data() + 24 + 8, sizeof(offset));
+	uint32_t vertex_count;
+	memcpy(&vertex_count, saved.data() + offset, sizeof(vertex_count));
+	size_t he_next = offset + 16 + 3 * ((8 * size_t(vertex_count) + 7) / 8 * 8);
+	bytes = saved;
+	uint32_t out_of_range = 0x7fffffff;
+	memcpy(&bytes[he_next], &out_of_range, sizeof(out_of_range));
+	CHECK(loadError("damaged.cbrep", bytes) == "solid 1 has indices out of range");
+
+	// the first half-edge of solid 1 claiming the loop of its partner
+	uint32_t edge_count;
+	memcpy(&edge_count, saved.data() + offset + 4, sizeof(edge_count));
+	size_t he_loop = he_next + 3 * ((8 * size_t(edge_count) + 7) / 8 * 8);
+	bytes = saved;
+	memcpy(&bytes[he_loop], &saved[he_loop + 4], sizeof(uint32_t));
+	CHECK(loadError("damaged.cbrep", bytes) == "solid 1 has indices out of range");
+
+	// one vertex, no edges and one loop, as left by MVFS, with one face or
+	// with a second face that has no outer loop
+	auto append = [](string& bytes, auto value) {
+		bytes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	};
+	for (uint32_t face_count : { 1u, 2u }) {
+		bytes = saved.substr(0, 16);
+		append(bytes, uint64_t(1));
+		append(bytes, uint64_t(32));
+		for (uint32_t count : { 1u, 0u, 1u, face_count }) {
+			append(bytes, count);
+		}
+		for (int i = 0; i < 3; ++i) {
+			append(bytes, 0.0);
+		}
+		// loop_first, loop_face, loop_next and face_outer, 8 bytes each
+		for (uint32_t index : { NIL, 0u, 0u, 0u, NIL, 0u, 0u, face_count == 2 ? NIL : 0u }) {
+			append(bytes, index);
+		}
+		CHECK(loadError("damaged.cbrep", bytes) == (face_count == 2 ? "solid 0 has indices out of range" : ""));
+	}
+}
@@ -0,0 +1,134 @@
+// Undo and redo through the journal: every step taken back and put again
+// must give exactly the model (ids and topology) that existed after that
+// step, and a valid one.
+
+#include <fstream>
+
+#include "Support.h"
+#include "Test.h"
+#include "Validator.h"
+
+namespace {
+
+// states[k] is the dump after k steps; the Brep holds all of them, built
+// with the journal on. Undoes down to nothing and redoes up to the end
+// twice, checking every state on the way.
+void walk(Brep& brep, const vector<string>& states) {
+	size_t steps = states.size() - 1;
+	REQUIRE(dump(brep) == states[steps]);
+	for (int round = 0; round < 2; ++round) {
+		for (size_t k = steps; k-- > 0;) {
+			REQUIRE(brep.undo());
+			CHECK(dump(brep) == states[k]);
+			CHECK(!validate(brep));
+		}
+		CHECK(!brep.undo());
+		for (size_t k = 1; k <= steps; ++k) {
+			REQUIRE(brep.redo());
+			CHECK(dump(brep) == states[k]);
+			CHECK(!validate(brep));
+		}
+		CHECK(!brep.redo());
+	}
+}
+
+// builds the commands of script one at a time into a journaled Brep and
+// compares every state with a fresh build of the same prefix
+void walkScript(const string& script) {
+	vector<string> parts = commands(script);
+	REQUIRE(parts.size() > 1);
+	vector<string> states{ dump(Brep()) };
+	string prefix;
+	for (const string& part : parts) {
+		prefix += part;
+		Brep fresh;
+		build(fresh, prefix);
+		states.push_back(dump(fresh));
+	}
+	Brep brep;
+	brep.startJournal();
+	build(brep, script);
+	CHECK(brep.journal.steps.size() == parts.size());
+	walk(brep, states);
+}
+
+} // namespace
+
+TEST(journal, input_txt) {
+	ifstream file(sourcePath("input.txt"), ios::binary);
+	walkScript(string(istreambuf_iterator<char>(file), istreambuf_iterator<char>()));
+}
+
+TEST(journal, holed_revolve) {
+	walkScript("face 4\n2 0 0\n4 0 0\n4 0 2\n2 0 2\n"
+	           "ring 4\n2.5 0 0.5\n2.5 0 1.5\n3.5 0 1.5\n3.5 0 0.5\n"
+	           "revolve\n0 0 0\n0 0 1\n360 8\n"
+	           "face 4\n10 0 0\n12 0 0\n12 0 2\n10 0 2\n"
+	           "ring 4\n10.5 0 0.5\n10.5 0 1.5\n11.5 0 1.5\n11.5 0 0.5\n"
+	           "revolve\n0 0 0\n0 0 1\n-90 5\n");
+}
+
+TEST(journal, kill_operators) {
+	// a square face taken apart again with KEF, KEV and KVFS, one step each
+	Brep brep;
+	brep.startJournal();
+	vector<string> states{ dump(brep) };
+	build(brep, "face 4\n0 0 0\n1 0 0\n1 1 0\n0 1 0\n");
+	states.push_back(dump(brep));
+	Solid* solid = brep.solids[0];
+	REQUIRE(solid->faces.size() == 2);
+	brep.KEF(solid->faces[1]->outer_loop->first_edge);
+	brep.endStep();
+	states.push_back(dump(brep));
+	CHECK(solid->faces.size() == 1);
+	CHECK(solid->edges.size() == 3);
+	while (!solid->edges.empty()) {
+		// a half-edge running into a vertex of degree one
+		HalfEdge* leaf = nullptr;
+		for (Edge* edge : solid->edges) {
+			for (HalfEdge* he : { edge->he1, edge->he2 }) {
+				if (he->next == he->partner) {
+					leaf = he;
+				}
+			}
+		}
+		REQUIRE(leaf);
+		brep.KEV(leaf);
+		brep.endStep();
+		states.push_back(dump(brep));
+		CHECK(!validate(brep));
+	}
+	brep.KVFS(solid);
+	brep.endStep();
+	states.push_back(dump(brep));
+	CHECK(brep.solids.empty());
+	walk(brep, states);
+}
+
+TEST(journal, new_step_drops_redo) {
+	Brep brep;
+	brep.startJournal();
+	build(brep, "face 3\n0 0 0\n1 0 0\n0 1 0\nsweep\n0 0 1\n");
+	string swept = dump(brep);
+	REQUIRE(brep.undo());
+	string face = dump(brep);
+	build(brep, "face 3\n5 0 0\n6 0 0\n5 1 0\n");
+	CHECK(!brep.redo());
+	REQUIRE(brep.undo());
+	CHECK(dump(brep) == face);
+	REQUIRE(brep.undo());
+	CHECK(brep.solids.empty());
+	CHECK(swept != face);
+}
+
+TEST(journal, stop_forgets_history) {
+	Brep brep;
+	brep.startJournal();
+	build(brep, "face 3\n0 0 0\n1 0 0\n0 1 0\nsweep\n0 0 1\n");
+	REQUIRE(brep.undo());
+	brep.stopJournal();
+	CHECK(!brep.undo());
+	CHECK(!brep.redo());
+	CHECK(!validate(brep));
+	CHECK(brep.solids[0]->faces.size() == 2);
+}
@@ -0,0 +1,64 @@
+// cadbrep_tests [group | group.name]...: runs the cases named, or all of
+// them, and exits non-zero if any check failed.
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+#include "Test.h"
+
+namespace test {
+
+std::vector<Case>& cases() {
+	static std::vector<Case> all;
+	return all;
+}
+
+static int failures = 0;
+
+void fail(const char* file, int line, const std::string& what) {
+	fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what.c_str());
+	++failures;
+}
+
+} // namespace test
+
+static bool selected(const test::Case& c, int argc, char** argv) {
+	if (argc < 2) {
+		return true;
+	}
+	for (int i = 1; i < argc; ++i) {
+		size_t group = strlen(c.group);
+		if (strcmp(argv[i], c.group) == 0 ||
+		    (strncmp(argv[i], c.group, group) == 0 && argv[i][group] == '.' && strcmp(argv[i] + group + 1, c.name) == 0)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+int main(int argc, char** argv) {
+	int run = 0, failed = 0;
+	for (const test::Case& c : test::cases()) {
+		if (!selected(c, argc, argv)) {
+			continue;
+		}
+		int before = test::failures;
+		try {
+			c.run();
+		} catch (const test::Abort&) {
+		} catch (const std::exception& e) {
+			test::fail(c.group, 0, std::string(c.name) + " threw " + e.what());
+		}
+		++run;
+		bool ok = test::failures == before;
+		failed += !ok;
+		fprintf(stderr, "%s %s.%s\n", ok ? "ok  " : "FAIL", c.group, c.name);
+	}
+	if (run == 0) {
+		fprintf(stderr, "no test matches\n");
+		return 2;
+	}
+	fprintf(stderr, "%d of %d cases passed\n", run - failed, run);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,136 @@
+// Mass properties against values worked out by hand, and the same to the
+// last bit on any number of threads.
+
+#include <cmath>
+#include <cstring>
+
+#include "CommandParser.h"
+#include "MassProperties.h"
+#include "Support.h"
+#include "Test.h"
+#include "Validator.h"
+
+namespace {
+
+const double tolerance = 1e-9;
+
+// 2 by 2 by 0.5 plate with four 0.6 by 0.6 holes, the rings either
+// against the outer loop or the same way as in input.txt
+string holedPlate(bool rings_against) {
+	string text = "face 4\n1 1 0.5\n-1 1 0.5\n-1 -1 0.5\n1 -1 0.5\n";
+	const double corners[4][2] = { { 0.2, 0.2 }, { -0.8, 0.2 }, { -0.8, -0.8 }, { 0.2, -0.8 } };
+	for (const auto& c : corners) {
+		double x[4] = { c[0], c[0] + 0.6, c[0] + 0.6, c[0] };
+		double y[4] = { c[1], c[1], c[1] + 0.6, c[1] + 0.6 };
+		text += "ring 4\n";
+		for (int i = 0; i < 4; ++i) {
+			int k = rings_against ? 3 - i : i;
+			text += to_string(x[k]) + ' ' + to_string(y[k]) + " 0.5\n";
+		}
+	}
+	return text + "sweep\n0 0 -0.5\n";
+}
+
+// Newell vector of a loop dotted with the plane normal of its face
+double turn(const Loop* loop) {
+	double n[3] = { 0, 0, 0 };
+	const HalfEdge* he = loop->first_edge;
+	do {
+		const Point *a = he->start->point, *b = he->end->point;
+		n[0] += (a->y - b->y) * (a->z + b->z);
+		n[1] += (a->z - b->z) * (a->x + b->x);
+		n[2] += (a->x - b->x) * (a->y + b->y);
+		he = he->next;
+	} while (he != loop->first_edge);
+	const double* normal = loop->face->plane().normal;
+	return n[0] * normal[0] + n[1] * normal[1] + n[2] * normal[2];
+}
+
+void checkInertia(const MassProperties& m, const double (&expected)[3][3]) {
+	for (int r = 0; r < 3; ++r) {
+		for (int c = 0; c < 3; ++c) {
+			CHECK_NEAR(m.inertia[r][c], expected[r][c], tolerance);
+		}
+	}
+}
+
+} // namespace
+
+TEST(mass, rings_in_either_winding) {
+	for (bool rings_against : { true, false }) {
+		Brep brep;
+		build(brep, holedPlate(rings_against));
+		CHECK(!validate(brep));
+		for (const Face* face : brep.solids[0]->faces) {
+			for (const Loop* loop : face->inner_loops) {
+				CHECK(turn(loop) < 0);
+			}
+		}
+		MassProperties m = massProperties(brep.solids[0]);
+		CHECK_NEAR(m.volume, 2 * 2 * 0.5 - 4 * 0.6 * 0.6 * 0.5, tolerance);
+		CHECK_NEAR(m.area, 2 * (4 - 4 * 0.36) + 8 * 0.5 + 4 * 4 * 0.6 * 0.5, tolerance);
+		CHECK_NEAR(m.centroid[2], 0.25, tolerance);
+	}
+}
+
+TEST(mass, input_txt) {
+	Brep brep;
+	Modeler modeler(&brep);
+	CommandParser parser(&modeler);
+	REQUIRE(parser.parseFile(sourcePath("input.txt").c_str()));
+	vector<MassProperties> m = massProperties(brep);
+	REQUIRE(m.size() == 2);
+	CHECK_NEAR(m[0].volume, 1.28, tolerance);
+	CHECK_NEAR(m[0].area, 13.92, tolerance);
+	for (int j = 0; j < 3; ++j) {
+		CHECK_NEAR(m[0].centroid[j], j == 2 ? 0.25 : 0.0, tolerance);
+	}
+	// triangle of area 0.75 less a hole of 0.125, 0.2 thick
+	CHECK_NEAR(m[1].volume, 0.625 * 0.2, tolerance);
+	CHECK_NEAR(m[1].area, 2 * 0.625 + 0.2 * (1 + 2 * sqrt(2.5) + 0.5 + 2 * sqrt(0.3125)), tolerance);
+}
+
+TEST(mass, box_far_from_the_origin) {
+	Brep brep;
+	build(brep, "face 4\n1000000 2000000 3\n1000002 2000000 3\n1000002 2000003 3\n1000000 2000003 3\n"
+	            "sweep\n0 0 -4\n");
+	MassProperties m = massProperties(brep.solids[0]);
+	CHECK_NEAR(m.volume, 24, tolerance);
+	CHECK_NEAR(m.area, 52, tolerance);
+	CHECK_NEAR(m.centroid[0], 1000001, tolerance);
+	CHECK_NEAR(m.centroid[1], 2000001.5, tolerance);
+	CHECK_NEAR(m.centroid[2], 1, tolerance);
+	// V (b b + c c) / 12 and so on
+	checkInertia(m, { { 50, 0, 0 }, { 0, 40, 0 }, { 0, 0, 26 } });
+}
+
+TEST(mass, l_prism) {
+	Brep brep;
+	build(brep, "face 6\n0 0 0\n0 2 0\n1 2 0\n1 1 0\n2 1 0\n2 0 0\nsweep\n0 0 1\n");
+	MassProperties m = massProperties(brep.solids[0]);
+	CHECK_NEAR(m.volume, 3, tolerance);
+	CHECK_NEAR(m.area, 14, tolerance);
+	CHECK_NEAR(m.centroid[0], 5.0 / 6, tolerance);
+	CHECK_NEAR(m.centroid[1], 5.0 / 6, tolerance);
+	CHECK_NEAR(m.centroid[2], 0.5, tolerance);
+	checkInertia(m, { { 7.0 / 6, 1.0 / 3, 0 }, { 1.0 / 3, 7.0 / 6, 0 }, { 0, 0, 11.0 / 6 } });
+}
+
+TEST(mass, thread_count) {
+	Brep brep;
+	string script;
+	for (int i = 0; i < 50; ++i) {
+		script += "face 3\n" + to_string(i) + " 0 0\n" + to_string(i + 0.5) + " 0 0\n" + to_string(i) +
+		          " 0.7 0\nsweep\n0.1 0 " + to_string(1 + i % 5) + '\n';
+	}
+	script += holedPlate(false);
+	build(brep, script);
+	vector<MassProperties> one = massProperties(brep, 1);
+	for (unsigned threads : { 2u, 4u, 7u }) {
+		vector<MassProperties> many = massProperties(brep, threads);
+		REQUIRE(many.size() == one.size());
+		for (size_t s = 0; s < one.size(); ++s) {
+			CHECK(memcmp(&many[s], &one[s], sizeof(MassProperties)) == 0);
+		}
+	}
+}
@@ -0,0 +1,187 @@
+// STL and OBJ export read back: every triangle of every face, the volume
+// they enclose, and the same bytes on any number of threads.
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "MassProperties.h"
+#include "MeshFile.h"
+#include "Support.h"
+#include "Test.h"
+#include "Tessellator.h"
+
+namespace {
+
+// holed prisms, one face big enough to be written from a buffer of its own,
+// and revolved rings
+string model() {
+	string text = "face 4\n1 1 0.5\n-1 1 0.5\n-1 -1 0.5\n1 -1 0.5\n"
+	              "ring 4\n0.2 0.2 0.5\n0.8 0.2 0.5\n0.8 0.8 0.5\n0.2 0.8 0.5\nsweep\n0 0 -0.5\n"
+	              "face 4\n0 5 0\n12 5 0\n12 8 0\n0 8 0\n";
+	for (int i = 0; i < 30; ++i) {
+		double x = 0.5 + 0.35 * i, y = 5.5 + 0.7 * (i % 3);
+		text += "ring 4\n" + to_string(x) + ' ' + to_string(y) + " 0\n" + to_string(x) + ' ' +
+		        to_string(y + 0.5) + " 0\n" + to_string(x + 0.2) + ' ' + to_string(y + 0.5) + " 0\n" +
+		        to_string(x + 0.2) + ' ' + to_string(y) + " 0\n";
+	}
+	text += "sweep\n0 0 -1\n";
+	for (int i = 0; i < 40; ++i) {
+		double x = 20 + 6 * i;
+		text += "face 4\n" + to_string(x + 2) + " 0 0\n" + to_string(x + 3) + " 0 0\n" + to_string(x + 3) +
+		        " 0 1\n" + to_string(x + 2) + " 0 1\nrevolve\n" + to_string(x) + " 0 0\n0 0 1\n" +
+		        (i % 2 ? "360 24\n" : "200 7\n");
+	}
+	return text;
+}
+
+string readBytes(const string& path) {
+	ifstream file(path, ios::binary);
+	return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+}
+
+// the little-endian uint32 at bytes
+uint32_t littleEndian(const char* bytes) {
+	uint32_t value = 0;
+	for (int i = 3; i >= 0; --i) {
+		value = value << 8 | static_cast<unsigned char>(bytes[i]);
+	}
+	return value;
+}
+
+size_t triangleCount(const Brep& brep) {
+	Tessellator tessellator;
+	TriangleMesh mesh;
+	size_t count = 0;
+	for (const Solid* solid : brep.solids) {
+		for (const Face* face : solid->faces) {
+			if (face->outer_loop->first_edge) {
+				mesh.clear();
+				CHECK(tessellator.triangulate(face, mesh)); // covers the face exactly
+				count += mesh.triangleCount();
+			}
+		}
+	}
+	return count;
+}
+
+} // namespace
+
+TEST(mesh, stl) {
+	Brep brep;
+	build(brep, model());
+	string error;
+	REQUIRE(writeStlFile("mesh.stl", brep, error, 1));
+	string bytes = readBytes("mesh.stl");
+	REQUIRE(bytes.size() >= 84);
+	uint32_t count = littleEndian(bytes.data() + 80);
+	CHECK(count == triangleCount(brep));
+	REQUIRE(bytes.size() == 84 + 50 * size_t(count));
+
+	// every record is a triangle of the tessellation in face order, rounded
+	// to float and stored little endian, and the triangles of each solid enclose its volume
+	vector<MassProperties> properties = massProperties(brep);
+	Tessellator tessellator;
+	TriangleMesh mesh;
+	const char* record = bytes.data() + 84;
+	bool same = true;
+	for (size_t s = 0; s < brep.solids.size(); ++s) {
+		const Point& apex = *brep.solids[s]->vertices[0]->point;
+		double volume = 0;
+		for (const Face* face : brep.solids[s]->faces) {
+			if (face->outer_loop->first_edge == nullptr) {
+				continue;
+			}
+			mesh.clear();
+			tessellator.triangulate(face, mesh);
+			for (size_t i = 0; i < mesh.indices.size(); i += 3, record += 50) {
+				float expected[12];
+				double p[3][3];
+				for (int k = 0; k < 3; ++k) {
+					expected[k] = static_cast<float>(mesh.normals[k]);
+					for (int c = 0; c < 3; ++c) {
+						double value = mesh.positions[3 * mesh.indices[i + c] + k];
+						expected[3 + 3 * c + k] = static_cast<float>(value);
+						p[c][k] = value - (k == 0 ? apex.x : k == 1 ? apex.y : apex.z);
+					}
+				}
+				for (int j = 0; j < 12; ++j) {
+					uint32_t bits;
+					memcpy(&bits, &expected[j], sizeof(bits));
+					same = same && littleEndian(record + 4 * j) == bits;
+				}
+				volume += (p[0][0] * (p[1][1] * p[2][2] - p[1][2] * p[2][1]) +
+				           p[0][1] * (p[1][2] * p[2][0] - p[1][0] * p[2][2]) +
+				           p[0][2] * (p[1][0] * p[2][1] - p[1][1] * p[2][0])) / 6;
+			}
+		}
+		CHECK_NEAR(volume, properties[s].volume, 1e-9);
+	}
+	CHECK(same);
+
+	for (unsigned threads : { 2u, 4u }) {
+		REQUIRE(writeStlFile("mesh_threads.stl", brep, error, threads));
+		CHECK(readBytes("mesh_threads.stl") == bytes);
+	}
+}
+
+TEST(mesh, obj) {
+	Brep brep;
+	build(brep, model());
+	string error;
+	REQUIRE(writeObjFile("mesh.obj", brep, error, 1));
+	string text = readBytes("mesh.obj");
+	vector<Point> points;
+	size_t faces = 0, objects = 0, normals = 0;
+	bool in_range = true;
+	istringstream lines(text);
+	for (string line; getline(lines, line);) {
+		istringstream in(line);
+		string kind;
+		in >> kind;
+		if (kind == "v") {
+			Point p;
+			in >> p.x >> p.y >> p.z;
+			points.push_back(p);
+		} else if (kind == "vn") {
+			++normals;
+		} else if (kind == "o") {
+			++objects;
+		} else if (kind == "f") {
+			++faces;
+			for (string corner; in >> corner;) {
+				size_t v = stoul(corner), n = stoul(corner.substr(corner.find("//") + 2));
+				in_range = in_range && v >= 1 && v <= points.size() && n >= 1 && n <= normals;
+			}
+		}
+	}
+	CHECK(in_range);
+	CHECK(objects == brep.solids.size());
+	CHECK(faces == triangleCount(brep));
+	// the vertices of every solid in order, read back to the same doubles
+	size_t i = 0;
+	bool same = true;
+	for (const Solid* solid : brep.solids) {
+		for (const Vertex* vertex : solid->vertices) {
+			const Point& p = *vertex->point;
+			same = same && i < points.size() && points[i].x == p.x && points[i].y == p.y && points[i].z == p.z;
+			++i;
+		}
+	}
+	CHECK(same && i == points.size());
+
+	for (unsigned threads : { 2u, 4u }) {
+		REQUIRE(writeObjFile("mesh_threads.obj", brep, error, threads));
+		CHECK(readBytes("mesh_threads.obj") == text);
+	}
+}
+
+TEST(mesh, unwritable_path) {
+	Brep brep;
+	build(brep, "face 3\n0 0 0\n1 0 0\n0 1 0\nsweep\n0 0 -1\n");
+	string error;
+	CHECK(!writeStlFile("no such directory/mesh.stl", brep, error));
+	CHECK(error.compare(0, 28, "no such directory/mesh.stl: ") == 0);
+	CHECK(!writeObjFile("no such directory/mesh.obj", brep, error));
+	CHECK(error.compare(0, 28, "no such directory/mesh.obj: ") == 0);
+}
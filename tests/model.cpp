@@ -0,0 +1,81 @@
+// Building models from the command language: the shipped input.txt, error
+// positions, and that the read window does not change the result.
+
+#include <cstring>
+
+#include "CommandParser.h"
+#include "Support.h"
+#include "Test.h"
+#include "Validator.h"
+
+namespace {
+
+struct Counts {
+	size_t solids = 0, faces = 0, loops = 0, edges = 0, vertices = 0;
+};
+
+Counts count(const Brep& brep) {
+	Counts counts;
+	counts.solids = brep.solids.size();
+	for (const Solid* solid : brep.solids) {
+		counts.faces += solid->faces.size();
+		counts.edges += solid->edges.size();
+		counts.vertices += solid->vertices.size();
+		for (const Face* face : solid->faces) {
+			counts.loops += 1 + face->inner_loops.size();
+		}
+	}
+	return counts;
+}
+
+// parses script and expects it to fail at line:column with error
+void expectError(const char* script, size_t line, size_t column, const char* error) {
+	Brep brep;
+	Modeler modeler(&brep);
+	CommandParser parser(&modeler);
+	CHECK(!parser.parse(script, strlen(script)));
+	CHECK(parser.line == line);
+	CHECK(parser.column == column);
+	CHECK(parser.error == error);
+}
+
+} // namespace
+
+TEST(model, input_txt) {
+	Brep brep;
+	Modeler modeler(&brep);
+	CommandParser parser(&modeler);
+	REQUIRE(parser.parseFile(sourcePath("input.txt").c_str()));
+	Counts counts = count(brep);
+	CHECK(counts.solids == 2);
+	CHECK(counts.faces == 30);
+	CHECK(counts.loops == 40);
+	CHECK(counts.edges == 78);
+	CHECK(counts.vertices == 52);
+	CHECK(modeler.commands == 9);
+	CHECK(!validate(brep));
+}
+
+TEST(model, small_window) {
+	// tokens straddling the window boundaries must not change anything
+	Brep whole, windowed;
+	Modeler whole_modeler(&whole), windowed_modeler(&windowed);
+	CommandParser whole_parser(&whole_modeler), windowed_parser(&windowed_modeler);
+	REQUIRE(whole_parser.parseFile(sourcePath("input.txt").c_str()));
+	REQUIRE(windowed_parser.parseFile(sourcePath("input.txt").c_str(), 64));
+	CHECK(dump(whole) == dump(windowed));
+}
+
+TEST(model, finish_ends_the_script) {
+	Brep brep;
+	build(brep, "face 3\n0 0 0\n1 0 0\n0 1 0\nfinish\nnot a command");
+	CHECK(brep.solids.size() == 1);
+}
+
+TEST(model, errors) {
+	expectError("ring 3\n0 0 0\n1 0 0\n0 1 0\n", 1, 1, "ring before any face");
+	expectError("face 3\n0 0 0\n1 0 0\n1 x 0\n", 4, 3, "'x' is not a number");
+	expectError("face 2\n0 0 0\n1 0 0\n", 1, 6, "a loop needs at least 3 points");
+	expectError("face 3\n0 0 0\n1 0 0\n0 1 0\nextrude 0 0 1\n", 5, 1, "unknown command 'extrude'");
+	expectError("face 3\n0 0 0\n1 0 0\n", 3, 5, "unexpected end of input, expected a number");
+}
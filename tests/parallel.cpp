@@ -0,0 +1,211 @@
+// Building in parallel must give the ids and topology of a sequential run,
+// whatever the thread count.
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CommandParser.h"
+#include "Support.h"
+#include "Test.h"
+#include "Validator.h"
+
+namespace {
+
+// plate i of the scripts: 4 by 4 with i % 3 holes, at x = 10 i
+string plate(int i) {
+	string text;
+	double x = 10.0 * i;
+	auto point = [&](double px, double py, double pz) {
+		text += to_string(x + px) + ' ' + to_string(py) + ' ' + to_string(pz) + '\n';
+	};
+	text += "face 4\n";
+	point(1, 0, 0);
+	point(5, 0, 0);
+	point(5, 0, 4);
+	point(1, 0, 4);
+	for (int h = 0; h < i % 3; ++h) {
+		text += "ring 4\n";
+		point(1.5 + 2 * h, 0, 1);
+		point(1.5 + 2 * h, 0, 3);
+		point(2.5 + 2 * h, 0, 3);
+		point(2.5 + 2 * h, 0, 1);
+	}
+	return text;
+}
+
+// n solids: plates swept, revolved or left flat
+string script(int n) {
+	string text;
+	for (int i = 0; i < n; ++i) {
+		text += plate(i);
+		if (i % 4 == 1) {
+			text += "sweep\n0 -1 0\n";
+		} else if (i % 4 == 2) {
+			text += "revolve\n" + to_string(10.0 * i) + " 0 0\n0 0 1\n" + (i % 8 == 2 ? "360 6\n" : "120 3\n");
+		}
+	}
+	return text;
+}
+
+// n flat plates; returns the face of each
+vector<Face*> plates(Brep& brep, int n) {
+	Modeler modeler(&brep);
+	vector<Face*> faces;
+	for (int i = 0; i < n; ++i) {
+		string text = plate(i);
+		CommandParser parser(&modeler); // one per input
+		bool ok = parser.parse(text.data(), text.size());
+		REQUIRE(ok);
+		faces.push_back(modeler.face);
+	}
+	return faces;
+}
+
+vector<Point> offsets(size_t n) {
+	vector<Point> result;
+	for (size_t i = 0; i < n; ++i) {
+		result.emplace_back(0.0, -1.0 - 0.5 * (i % 3), 0.25 * (i % 2));
+	}
+	return result;
+}
+
+// one sweep after the other, as the batch promises to match
+void sweepEach(Brep& brep, const vector<Face*>& faces, const vector<Point>& offsets) {
+	for (size_t i = 0; i < faces.size(); ++i) {
+		const Point& offset = offsets.size() == 1 ? offsets[0] : offsets[i];
+		brep.sweep(faces[i], offset.x, offset.y, offset.z);
+	}
+}
+
+struct Parsed {
+	bool ok;
+	string dump;
+	size_t commands, line, column;
+	string error;
+};
+
+Parsed parse(const string& path, unsigned threads) {
+	Brep brep;
+	Modeler modeler(&brep);
+	CommandParser parser(&modeler);
+	bool ok = threads == 0 ? parser.parseFile(path.c_str()) : parser.parseFileParallel(path.c_str(), threads);
+	return { ok, dump(brep), modeler.commands, parser.line, parser.column, parser.error };
+}
+
+} // namespace
+
+TEST(parallel, parse) {
+	string path = writeFile("parallel_parse.txt", script(40) + "finish\nface 3\n");
+	Parsed sequential = parse(path, 0);
+	REQUIRE(sequential.ok);
+	for (unsigned threads : { 1u, 2u, 4u, 7u }) {
+		Parsed parallel = parse(path, threads);
+		CHECK(parallel.ok);
+		CHECK(parallel.dump == sequential.dump);
+		CHECK(parallel.commands == sequential.commands);
+	}
+}
+
+TEST(parallel, parse_error_falls_back) {
+	// the error is in the middle of the script, so sections before and
+	// after it parse fine on their own
+	string text = script(12) + "face 3\n0 0 0\n1 0 0\n0 1 0\nsweep\n0 0 q\n" + script(12);
+	string path = writeFile("parallel_error.txt", text);
+	Parsed sequential = parse(path, 0);
+	REQUIRE(!sequential.ok);
+	CHECK(sequential.error == "'q' is not a number");
+	for (unsigned threads : { 1u, 4u }) {
+		Parsed parallel = parse(path, threads);
+		CHECK(!parallel.ok);
+		CHECK(parallel.dump == sequential.dump);
+		CHECK(parallel.commands == sequential.commands);
+		CHECK(parallel.line == sequential.line);
+		CHECK(parallel.column == sequential.column);
+		CHECK(parallel.error == sequential.error);
+	}
+}
+
+TEST(parallel, parse_before_any_face) {
+	// a script that fails in its first section, before any face
+	string path = writeFile("parallel_ring.txt", "ring 3\n0 0 0\n1 0 0\n0 1 0\n" + script(3));
+	Parsed sequential = parse(path, 0);
+	Parsed parallel = parse(path, 4);
+	CHECK(!sequential.ok);
+	CHECK(!parallel.ok);
+	CHECK(parallel.error == sequential.error);
+	CHECK(parallel.line == sequential.line);
+	CHECK(parallel.dump == sequential.dump);
+}
+
+TEST(parallel, adopt) {
+	// sections built on threads of their own, then adopted in order
+	const int sections = 5;
+	vector<Brep> parts(sections);
+	vector<thread> workers;
+	for (int i = 0; i < sections; ++i) {
+		workers.emplace_back([&parts, i] { build(parts[i], script(3 + i)); });
+	}
+	for (thread& worker : workers) {
+		worker.join();
+	}
+	Brep adopted, sequential;
+	Brep empty;
+	adopted.adopt(empty);
+	for (int i = 0; i < sections; ++i) {
+		adopted.adopt(parts[i]);
+		build(sequential, script(3 + i));
+		CHECK(parts[i].solids.empty());
+		CHECK(parts[i].ids.vertex == 0 && parts[i].ids.face == 0);
+	}
+	CHECK(!validate(adopted));
+	CHECK(dump(adopted) == dump(sequential));
+
+	// operations after the adoption go on numbering where the sections stopped
+	build(adopted, script(2));
+	build(sequential, script(2));
+	CHECK(dump(adopted) == dump(sequential));
+}
+
+TEST(parallel, sweep) {
+	const int n = 30;
+	Brep reference;
+	vector<Face*> faces = plates(reference, n);
+	sweepEach(reference, faces, offsets(n));
+	string expected = dump(reference);
+	for (unsigned threads : { 1u, 4u }) {
+		Brep brep;
+		brep.sweep(plates(brep, n), offsets(n), threads);
+		CHECK(!validate(brep));
+		CHECK(dump(brep) == expected);
+	}
+
+	// one offset for every face
+	Brep single_reference, single;
+	sweepEach(single_reference, plates(single_reference, n), { Point(1, -2, 0) });
+	single.sweep(plates(single, n), { Point(1, -2, 0) }, 4);
+	CHECK(dump(single) == dump(single_reference));
+}
+
+TEST(parallel, sweep_dependent) {
+	// the same face twice: the second sweep extrudes the first one's
+	// result, so the batch falls back to sweeping in order
+	Brep reference, brep;
+	vector<Face*> faces = plates(reference, 4);
+	faces.push_back(faces[2]);
+	sweepEach(reference, faces, offsets(faces.size()));
+	faces = plates(brep, 4);
+	faces.push_back(faces[2]);
+	brep.sweep(faces, offsets(faces.size()), 4);
+	CHECK(!validate(brep));
+	CHECK(dump(brep) == dump(reference));
+
+	// so does a journaled one
+	Brep journaled;
+	faces = plates(journaled, 4);
+	journaled.startJournal();
+	journaled.sweep(faces, offsets(4), 4);
+	Brep plain;
+	sweepEach(plain, plates(plain, 4), offsets(4));
+	CHECK(dump(journaled) == dump(plain));
+}
@@ -0,0 +1,153 @@
+// Picking against brute-force ray casting over every triangle of the model,
+// as the model changes, and snapping to edges and vertices.
+
+#include <cmath>
+#include <random>
+
+#include "Picker.h"
+#include "Support.h"
+#include "Test.h"
+
+namespace {
+
+struct Hit {
+	double t = numeric_limits<double>::infinity();
+	const Face* face = nullptr;
+};
+
+Hit bruteForce(const Brep& brep, const Ray& ray) {
+	Hit best;
+	Tessellator tessellator;
+	TriangleMesh mesh;
+	for (const Solid* solid : brep.solids) {
+		for (const Face* face : solid->faces) {
+			if (face->outer_loop->first_edge == nullptr) {
+				continue;
+			}
+			mesh.clear();
+			tessellator.triangulate(face, mesh);
+			for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+				const double* p = mesh.positions.data();
+				double t;
+				if (intersectTriangle(p + 3 * mesh.indices[i], p + 3 * mesh.indices[i + 1],
+				                      p + 3 * mesh.indices[i + 2], ray, best.t, t)) {
+					best = { t, face };
+				}
+			}
+		}
+	}
+	return best;
+}
+
+// rays from around the model's box towards points inside it
+void compare(const Brep& brep, const Picker& picker, mt19937& random, int rays) {
+	Box box;
+	for (const Solid* solid : brep.solids) {
+		box.add(solid->box());
+	}
+	uniform_real_distribution<double> unit(0, 1);
+	auto inside = [&](double grow) {
+		double c[3];
+		for (int i = 0; i < 3; ++i) {
+			double size = box.max[i] - box.min[i];
+			c[i] = box.min[i] - grow * size + (1 + 2 * grow) * size * unit(random);
+		}
+		return Point(c[0], c[1], c[2]);
+	};
+	for (int r = 0; r < rays; ++r) {
+		Point from = inside(1), to = inside(0);
+		Ray ray = { from, Point(to.x - from.x, to.y - from.y, to.z - from.z) };
+		Hit expected = bruteForce(brep, ray);
+		PickHit hit = picker.pick(ray);
+		CHECK(bool(hit) == (expected.face != nullptr));
+		if (hit && expected.face) {
+			CHECK_NEAR(hit.t, expected.t, 1e-9);
+			// a ray through an edge may be given either face
+			CHECK(hit.face == expected.face || fabs(hit.t - expected.t) <= 1e-9);
+		}
+	}
+}
+
+// input.txt's plate, a plate with 30 holes (enough triangles for a tree of
+// its own) and a row of revolved rings
+string model() {
+	string text = "face 4\n1 1 0.5\n-1 1 0.5\n-1 -1 0.5\n1 -1 0.5\n"
+	              "ring 4\n0.2 0.2 0.5\n0.8 0.2 0.5\n0.8 0.8 0.5\n0.2 0.8 0.5\nsweep\n0 0 -0.5\n"
+	              "face 4\n0 5 0\n12 5 0\n12 8 0\n0 8 0\n";
+	for (int i = 0; i < 30; ++i) {
+		double x = 0.5 + 0.35 * i, y = 5.5 + 0.7 * (i % 3);
+		text += "ring 4\n" + to_string(x) + ' ' + to_string(y) + " 0\n" + to_string(x) + ' ' +
+		        to_string(y + 0.5) + " 0\n" + to_string(x + 0.2) + ' ' + to_string(y + 0.5) + " 0\n" +
+		        to_string(x + 0.2) + ' ' + to_string(y) + " 0\n";
+	}
+	text += "sweep\n0 0 -1\n";
+	for (int i = 0; i < 4; ++i) {
+		double x = 20 + 6 * i;
+		text += "face 4\n" + to_string(x + 2) + " 0 0\n" + to_string(x + 3) + " 0 0\n" + to_string(x + 3) +
+		        " 0 1\n" + to_string(x + 2) + " 0 1\nrevolve\n" + to_string(x) + " 0 0\n0 0 1\n" +
+		        (i % 2 ? "360 12\n" : "200 7\n");
+	}
+	return text;
+}
+
+} // namespace
+
+TEST(picker, against_brute_force) {
+	mt19937 random(7);
+	Brep brep;
+	brep.startJournal();
+	build(brep, model());
+	Picker picker;
+	picker.update(brep, 4);
+	compare(brep, picker, random, 2000);
+
+	// dangling edges change faces without changing the set of faces
+	for (Solid* solid : brep.solids) {
+		Face* face = solid->faces[0];
+		Vertex* vertex = face->outer_loop->first_edge->start;
+		brep.MEV(face->outer_loop, vertex, vertex->point->x + 0.1, vertex->point->y, vertex->point->z + 0.1);
+	}
+	brep.endStep();
+	picker.update(brep, 4);
+	compare(brep, picker, random, 1000);
+
+	// undo takes solids away again, redo brings them back
+	for (int k = 0; k < 4; ++k) {
+		REQUIRE(brep.undo());
+		picker.update(brep);
+		compare(brep, picker, random, 300);
+	}
+	while (brep.redo()) {
+		picker.update(brep);
+	}
+	compare(brep, picker, random, 1000);
+}
+
+TEST(picker, snaps_to_edges_and_vertices) {
+	Brep brep;
+	build(brep, "face 4\n0 0 1\n1 0 1\n1 1 1\n0 1 1\nsweep\n0 0 -1\n");
+	Picker picker;
+	picker.update(brep);
+	Point down(0, 0, -1);
+
+	PickHit hit = picker.pick({ Point(0.5, 0.5, 5), down }, 0.01);
+	REQUIRE(hit);
+	CHECK_NEAR(hit.t, 4, 1e-12);
+	CHECK_NEAR(hit.face->plane().normal[2], 1, 1e-12);
+	CHECK(hit.edge == nullptr && hit.vertex == nullptr);
+
+	// within 0.01 * t of the edge y = 1, z = 1
+	hit = picker.pick({ Point(0.5, 0.99, 5), down }, 0.01);
+	REQUIRE(hit && hit.edge != nullptr);
+	CHECK(hit.vertex == nullptr);
+	for (const Vertex* end : { hit.edge->he1->start, hit.edge->he1->end }) {
+		CHECK(end->point->y == 1 && end->point->z == 1);
+	}
+
+	// a vertex wins over its edges
+	hit = picker.pick({ Point(0.99, 0.99, 5), down }, 0.01);
+	REQUIRE(hit && hit.vertex != nullptr);
+	CHECK(hit.vertex->point->x == 1 && hit.vertex->point->y == 1 && hit.vertex->point->z == 1);
+
+	CHECK(!picker.pick({ Point(2, 2, 5), down }, 0.01));
+}
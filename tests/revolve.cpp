@@ -0,0 +1,72 @@
+// Revolves against the polygonal version of Pappus' theorem: a profile
+// turned by angle in n straight steps sweeps n wedges of volume
+// sin(angle / n) times the integral of r over the profile, and every
+// result is a valid solid with the expected number of entities.
+
+#include <cmath>
+
+#include "MassProperties.h"
+#include "Support.h"
+#include "Test.h"
+#include "Validator.h"
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+
+// 2 <= r <= 4, 0 <= z <= 2 in the xz plane, with a hole
+// 2.5 <= r <= 3.5, 0.5 <= z <= 1.5 when holed
+string profile(bool holed) {
+	string text = "face 4\n2 0 0\n4 0 0\n4 0 2\n2 0 2\n";
+	if (holed) {
+		text += "ring 4\n2.5 0 0.5\n2.5 0 1.5\n3.5 0 1.5\n3.5 0 0.5\n";
+	}
+	return text;
+}
+
+// integral of r over a rectangle r0..r1 by height
+double moment(double r0, double r1, double height) {
+	return (r1 * r1 - r0 * r0) / 2 * height;
+}
+
+struct Case {
+	double degrees;
+	int segments;
+	bool holed;
+};
+
+} // namespace
+
+TEST(revolve, pappus) {
+	const Case cases[] = {
+		{ 360, 8, false }, { 360, 3, false }, { 360, 12, true }, { 90, 1, false },
+		{ 120, 5, true },  { -90, 4, false }, { -360, 6, true },
+	};
+	for (const Case& c : cases) {
+		Brep brep;
+		build(brep, profile(c.holed) + "revolve\n0 0 0\n0 0 1\n" + to_string(c.degrees) + ' ' +
+		                to_string(c.segments) + '\n');
+		REQUIRE(brep.solids.size() == 1);
+		const Solid* solid = brep.solids[0];
+		CHECK(!validate(solid));
+
+		// each profile vertex gives one vertex per step (one less when the
+		// last step closes onto the first), each profile edge a face per step
+		// and an edge along it
+		size_t corners = c.holed ? 8 : 4;
+		bool closed = fabs(c.degrees) == 360;
+		size_t copies = closed ? c.segments : c.segments + 1;
+		CHECK(solid->vertices.size() == corners * copies);
+		CHECK(solid->edges.size() == corners * copies + corners * c.segments);
+		CHECK(solid->faces.size() == corners * c.segments + (closed ? 0 : 2));
+
+		double integral = moment(2, 4, 2) - (c.holed ? moment(2.5, 3.5, 1) : 0);
+		double angle = fabs(c.degrees) * pi / 180;
+		MassProperties m = massProperties(solid);
+		// turned the other way the faces point inwards, as when sweeping the
+		// other way
+		double sign = c.degrees < 0 ? -1 : 1;
+		CHECK_NEAR(m.volume, sign * c.segments * sin(angle / c.segments) * integral, 1e-9);
+		CHECK_NEAR(m.centroid[2], 1, 1e-9);
+	}
+}
@@ -0,0 +1,62 @@
+// The bounded trace: what dump() prints, wrap-around and the TRACE macro.
+
+#define CADBREP_TRACE // as the viewer is built, so TRACE records
+
+#include <string>
+
+#include "Test.h"
+#include "Trace.h"
+
+namespace {
+
+std::string dumped(const Trace& trace) {
+	FILE* file = tmpfile();
+	REQUIRE(file != nullptr);
+	trace.dump(file);
+	std::string text;
+	rewind(file);
+	for (int c; (c = fgetc(file)) != EOF;) {
+		text += static_cast<char>(c);
+	}
+	fclose(file);
+	return text;
+}
+
+} // namespace
+
+TEST(trace, dump) {
+	Trace trace;
+	trace.record("begin", "GL_TRIANGLES");
+	trace.record("vertex", 1, 2.5, -3);
+	trace.record("end");
+	CHECK(dumped(trace) == "begin GL_TRIANGLES\nvertex 1 2.5 -3\nend\n");
+	trace.clear();
+	CHECK(dumped(trace).empty());
+}
+
+TEST(trace, wraps_around) {
+	Trace trace(3);
+	const char* names[] = { "a", "b", "c", "d", "e" };
+	for (const char* name : names) {
+		trace.record(name);
+	}
+	CHECK(dumped(trace) == "(2 earlier events dropped)\nc\nd\ne\n");
+	for (int i = 0; i < 1000; ++i) {
+		trace.record("x", i, 0, 0);
+	}
+	CHECK(dumped(trace) == "(1002 earlier events dropped)\nx 997 0 0\nx 998 0 0\nx 999 0 0\n");
+
+	Trace one(0); // keeps one event
+	one.record("a");
+	one.record("b");
+	CHECK(dumped(one) == "(1 earlier events dropped)\nb\n");
+}
+
+TEST(trace, records_only_when_enabled) {
+	Trace trace;
+	TRACE(trace, "off");
+	CHECK(dumped(trace).empty());
+	trace.enabled = true;
+	TRACE(trace, "on", 1, 2, 3);
+	CHECK(dumped(trace) == "on 1 2 3\n");
+}
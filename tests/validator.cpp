@@ -0,0 +1,173 @@
+// validate(): valid models pass, and each kind of broken link is reported
+// with its own problem and the id of the entity concerned.
+
+#include <cstring>
+#include <utility>
+
+#include "Support.h"
+#include "Test.h"
+#include "Validator.h"
+
+namespace {
+
+// a plate with a square hole, swept into a solid
+const char* plate = "face 4\n0 0 0\n4 0 0\n4 4 0\n0 4 0\n"
+                    "ring 4\n1 1 0\n1 3 0\n3 3 0\n3 1 0\n"
+                    "sweep\n0 0 1\n";
+
+void expect(const Solid* solid, const char* problem, int id) {
+	TopologyError error = validate(solid);
+	if (!error) {
+		test::fail(__FILE__, __LINE__, string("no error, expected ") + problem);
+		return;
+	}
+	if (strcmp(error.problem, problem) != 0 || error.id != id) {
+		test::fail(__FILE__, __LINE__, string(error.problem) + " (id " + to_string(error.id) + "), expected " +
+		                                   problem + " (id " + to_string(id) + ")");
+	}
+	CHECK(error.solid == solid);
+}
+
+} // namespace
+
+TEST(validator, valid_models) {
+	Brep brep;
+	build(brep, plate);
+	build(brep, "face 4\n2 0 0\n3 0 0\n3 0 1\n2 0 1\nrevolve\n0 0 0\n0 0 1\n360 12\n");
+	build(brep, "face 3\n0 0 0\n1 0 0\n0 1 0\n");
+	brep.MVFS(5, 5, 5);
+	for (const Solid* solid : brep.solids) {
+		CHECK(!validate(solid));
+	}
+	CHECK(!validate(brep, 4));
+}
+
+TEST(validator, lists) {
+	Brep brep;
+	build(brep, plate);
+	Solid* solid = brep.solids[0];
+	swap(solid->vertices[0], solid->vertices[1]);
+	expect(solid, "vertex list out of order", -1);
+	swap(solid->vertices[0], solid->vertices[1]);
+
+	// an edge no vertex starts its half-edge on, so the vertices are still
+	// fine when the edges are checked
+	Edge* edge = nullptr;
+	for (Edge* candidate : solid->edges) {
+		bool used = false;
+		for (const Vertex* vertex : solid->vertices) {
+			used = used || vertex->he->edge == candidate;
+		}
+		if (!used) {
+			edge = candidate;
+		}
+	}
+	REQUIRE(edge);
+	edge->index ^= 1;
+	expect(solid, "edge list out of order", -1);
+	edge->index ^= 1;
+
+	swap(solid->faces[0], solid->faces[4]);
+	expect(solid, "face list out of order", -1);
+	swap(solid->faces[0], solid->faces[4]);
+	CHECK(!validate(solid));
+}
+
+TEST(validator, vertex) {
+	Brep brep;
+	build(brep, plate);
+	Vertex* vertex = brep.solids[0]->vertices[3];
+	HalfEdge* he = vertex->he;
+	vertex->he = he->next;
+	expect(brep.solids[0], "vertex half-edge does not start at the vertex", vertex->VertexId);
+	vertex->he = he;
+	CHECK(!validate(brep.solids[0]));
+}
+
+TEST(validator, partner) {
+	Brep brep;
+	build(brep, plate);
+	Edge* edge = brep.solids[0]->edges[5];
+	edge->he1->partner = edge->he1;
+	expect(brep.solids[0], "partner is not an involution", edge->EdgeId);
+	edge->he1->partner = edge->he2;
+
+	Edge* other = brep.solids[0]->edges[6];
+	edge->he2->edge = other;
+	expect(brep.solids[0], "half-edge points at another edge", edge->EdgeId);
+	edge->he2->edge = edge;
+
+	Vertex* end = edge->he2->end;
+	edge->he2->end = edge->he2->start;
+	expect(brep.solids[0], "half-edges of an edge do not share its vertices", edge->EdgeId);
+	edge->he2->end = end;
+	CHECK(!validate(brep.solids[0]));
+}
+
+TEST(validator, face_and_solid) {
+	Brep brep;
+	build(brep, plate);
+	build(brep, "face 3\n0 0 5\n1 0 5\n0 1 5\n");
+	Solid* solid = brep.solids[0];
+	Face* face = solid->faces[2];
+	face->solid = brep.solids[1];
+	expect(solid, "face of another solid", face->faceId);
+	face->solid = solid;
+
+	Loop* loop = face->outer_loop;
+	loop->face = solid->faces[3];
+	expect(solid, "loop does not point back at its face", face->faceId);
+	loop->face = face;
+	CHECK(!validate(solid));
+}
+
+TEST(validator, loop) {
+	Brep brep;
+	build(brep, plate);
+	Solid* solid = brep.solids[0];
+	Face* face = solid->faces[1];
+	HalfEdge* he = face->outer_loop->first_edge->next;
+	Loop* loop = he->loop;
+	he->loop = solid->faces[2]->outer_loop;
+	expect(solid, "half-edge points at another loop", loop->loopId);
+	he->loop = loop;
+
+	HalfEdge* pre = he->pre;
+	he->pre = pre->pre;
+	expect(solid, "next and pre are not symmetric", loop->loopId);
+	he->pre = pre;
+
+	// the hole of the plate's face, as seen from its inner loop
+	Face* holed = nullptr;
+	for (Face* f : solid->faces) {
+		if (!f->inner_loops.empty()) {
+			holed = f;
+		}
+	}
+	REQUIRE(holed);
+	Loop* ring = holed->inner_loops[0];
+	HalfEdge* first = ring->first_edge;
+	first->loop = holed->outer_loop;
+	expect(solid, "half-edge points at another loop", ring->loopId);
+	first->loop = ring;
+	CHECK(!validate(solid));
+}
+
+TEST(validator, brep_reports_the_first_solid) {
+	Brep brep;
+	for (int i = 0; i < 8; ++i) {
+		build(brep, plate);
+	}
+	Solid* bad[2] = { brep.solids[5], brep.solids[2] };
+	for (Solid* solid : bad) {
+		swap(solid->vertices[0], solid->vertices[1]);
+	}
+	for (unsigned threads : { 1u, 3u }) {
+		TopologyError error = validate(brep, threads);
+		CHECK(error.solid == brep.solids[2]);
+	}
+	for (Solid* solid : bad) {
+		swap(solid->vertices[0], solid->vertices[1]);
+	}
+	CHECK(!validate(brep, 3));
+}
@@ -1,17 +1,29 @@
+#ifdef _WIN32
+#define NOMINMAX // std::min and std::max in the headers below
 #include <Windows.h>
+#endif
 #include "GL/freeglut.h"
 
 #ifndef _WIN32
 #define __stdcall
 #endif
 
+#include <cmath>
+#include <cstdio>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <sstream>
+#include <unordered_map>
 #include <vector>
 
+#include "Boolean.h"
 #include "Brep.h"
+#include "CommandParser.h"
+#include "Picker.h"
+#include "Tessellator.h"
+#include "Trace.h"
 
 using namespace std;
 
@@ -19,11 +31,18 @@ using namespace std;
 #define CALLBACK
 #endif
 
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#define GL_STATIC_DRAW 0x88E4
+#endif
+
 void CALLBACK tessBeginCB(GLenum which);
 void CALLBACK tessEndCB();
 void CALLBACK tessErrorCB(GLenum errorCode);
 void CALLBACK tessVertexCB(const GLvoid* data); // without color
 void CALLBACK tessVertexCB2(const GLvoid* data); /// with color
+void CALLBACK tessEdgeFlagCB(GLboolean flag);
 void CALLBACK tessCombineCB(const GLdouble newVertex[3], const GLdouble* neighborVertex[4],
                             const GLfloat neighborWeight[4], GLdouble** outData);
 
@@ -38,6 +57,7 @@ void mouseMotionCB(int x, int y);
 
 // function declarations
 void initGL();
+void initBuffers();
 int initGLUT(int argc, char** argv);
 bool initSharedMem();
 void initLights();
@@ -52,17 +72,97 @@ void* font = GLUT_BITMAP_8_BY_13;
 bool mouseLeftDown;
 bool mouseRightDown;
 float mouseX, mouseY;
+int pressX, pressY; // where the left button went down; released in place it picks
 float cameraAngleX;
 float cameraAngleY;
 float cameraDistance;
 int drawMode = 0;
-GLdouble vertices[64][6]; // arrary to store newly created vertices (x,y,z,r,g,b) by combine callback
-int vertexIndex = 0; // array index for above array incremented inside combine callback
 
 void drawInit();
 
-// DEBUG
-stringstream ss;
+// tessellation cache: triangles of a face, rebuilt only when the face's
+// revision says an Euler operator changed it
+struct FaceMesh {
+	unsigned revision = 0;
+	GLfloat normal[3] = { 0, 0, 1 }; // unit, shared by all of the face's vertices
+	vector<GLfloat> positions; // x, y, z per vertex
+	vector<GLuint> indices; // three per triangle
+};
+
+// what is drawn of a solid: the triangles of all of its faces in one vertex
+// buffer (position and face normal interleaved) and one index buffer, drawn
+// with a single call and uploaded again only when the solid's revision
+// changes; without buffer objects the same arrays stay in client memory
+struct SolidMesh {
+	unsigned revision = 0;
+	unsigned frame = 0; // last frame the solid was drawn, used for eviction
+	unordered_map<int, FaceMesh> faces; // keyed by faceId
+	GLuint vertexBuffer = 0;
+	GLuint indexBuffer = 0;
+	GLsizei indexCount = 0;
+	vector<GLfloat> vertices; // client-side path only
+	vector<GLuint> indices;
+};
+unordered_map<int, SolidMesh> meshCache; // keyed by SolidId
+vector<GLfloat> vertexScratch; // arrays of the solid being uploaded
+vector<GLuint> indexScratch;
+
+// buffer objects are GL 1.5, past what opengl32.dll exports on Windows, so
+// their entry points are looked up at run time (initBuffers)
+typedef void (__stdcall* GenBuffersProc)(GLsizei n, GLuint* buffers);
+typedef void (__stdcall* DeleteBuffersProc)(GLsizei n, const GLuint* buffers);
+typedef void (__stdcall* BindBufferProc)(GLenum target, GLuint buffer);
+typedef void (__stdcall* BufferDataProc)(GLenum target, ptrdiff_t size, const GLvoid* data, GLenum usage);
+GenBuffersProc genBuffers = nullptr;
+DeleteBuffersProc deleteBuffers = nullptr;
+BindBufferProc bindBuffer = nullptr;
+BufferDataProc bufferData = nullptr;
+bool useBuffers = false;
+
+FaceMesh* tessTarget = nullptr; // mesh the tessellator callbacks append to
+vector<GLdouble> tessCoords; // contour coordinates handed to gluTessVertex
+
+// vertices the combine callback makes where contours cross; GLU keeps the
+// pointers until gluTessEndPolygon, so they are carved out of blocks that
+// never move, and every polygon starts over in the blocks of the last one
+struct CombineArena {
+	static constexpr size_t blockVertices = 256;
+	vector<unique_ptr<GLdouble[]>> blocks;
+	size_t used = 0; // vertices handed out for the current polygon
+
+	GLdouble* allocate() {
+		if (used == blocks.size() * blockVertices) {
+			blocks.emplace_back(new GLdouble[3 * blockVertices]);
+		}
+		GLdouble* vertex = blocks[used / blockVertices].get() + 3 * (used % blockVertices);
+		++used;
+		return vertex;
+	}
+};
+CombineArena combineArena;
+GLUtesselator* tess = nullptr; // fallback for loops the native tessellator rejects
+Tessellator tessellator;
+TriangleMesh tessScratch;
+unsigned frameCount = 0;
+
+size_t drawnSolids = 0; // solids of the last frame that were inside the view frustum
+GLdouble modelviewMatrix[16], projectionMatrix[16]; // of the last frame, with the camera applied
+GLint viewport[4];
+
+// ray picking, brought up to date with the Brep on every click
+Picker picker;
+PickHit picked; // cleared whenever the Brep changes
+
+void tessellateFace(Face* face, FaceMesh& mesh);
+const SolidMesh& solidMesh(Solid* solid);
+void frustumPlanes(GLdouble planes[6][4]);
+bool insideFrustum(const Box& box, const GLdouble planes[6][4]);
+void pickAt(int x, int y);
+void drawPicked();
+void combineLast(Boolean::Operation operation);
+
+// GLU callbacks and uploads, 'T' switches recording on and off, 'P' prints it
+Trace trace;
 Brep* brep = new Brep();
 
 int main(int argc, char** argv) {
@@ -77,46 +177,11 @@ int main(int argc, char** argv) {
 }
 
 void drawInit() {
-	Point pos;
-	ifstream input("input.txt");
-	string s;
-	Vertex* vtx = nullptr;
-	Face* face = nullptr;
-	while (input) {
-		input >> s;
-		if (s == "face") {
-			input >> s;
-			int num = stoi(s);
-			input >> pos;
-			brep->MVFS(pos.x, pos.y, pos.z);
-			auto& loop = brep->solids.back()->faces[0]->outer_loop;
-			auto& vertices = brep->solids.back()->vertices;
-			for (int i = 1; i < num; ++i) {
-				input >> pos;
-				vtx = brep->MEV(loop, vertices.back(), pos.x, pos.y, pos.z);
-			}
-			face = brep->MEF(loop, vertices[num - 2], vertices[num - 1], vertices[1],
-			                 vertices[0]);
-		} else if (s == "ring") {
-			input >> s;
-			int num = stoi(s);
-			auto& loop = face->outer_loop;
-			auto& vertices = brep->solids.back()->vertices;
-			int origin_size = vertices.size();
-			input >> pos;
-			brep->MEV(loop, vertices[0], pos.x, pos.y, pos.z);
-			for (int i = 1; i < num; ++i) {
-				input >> pos;
-				brep->MEV(loop, vertices.back(), pos.x, pos.y, pos.z);
-			}
-			brep->MEF(loop, vertices[origin_size + 1], vertices[origin_size], vertices[vertices.size() - 2],vertices.back());
-			brep->KEMR(loop, vertices[origin_size], vertices[0]);
-		} else if (s == "sweep") {
-			input >> pos;
-			brep->sweep(face, pos.x, pos.y, pos.z);
-		} else {
-			return;
-		}
+	brep->startJournal(); // one step per command, for 'U' and 'R'
+	Modeler modeler(brep);
+	CommandParser parser(&modeler);
+	if (!parser.parseFile("input.txt")) {
+		cerr << "input.txt:" << parser.line << ":" << parser.column << ": " << parser.error << endl;
 	}
 }
 
@@ -190,6 +255,24 @@ void initGL() {
 
 	initLights();
 	setCamera(0, 0, 5, 0, 0, -0.5);
+	initBuffers();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// look up the buffer object functions; drawing falls back to client-side
+// arrays when the GL is older than 1.5
+///////////////////////////////////////////////////////////////////////////////
+void initBuffers() {
+	int major = 0, minor = 0;
+	const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+	if (!version || sscanf(version, "%d.%d", &major, &minor) != 2 || (major == 1 && minor < 5)) {
+		return;
+	}
+	genBuffers = reinterpret_cast<GenBuffersProc>(glutGetProcAddress("glGenBuffers"));
+	deleteBuffers = reinterpret_cast<DeleteBuffersProc>(glutGetProcAddress("glDeleteBuffers"));
+	bindBuffer = reinterpret_cast<BindBufferProc>(glutGetProcAddress("glBindBuffer"));
+	bufferData = reinterpret_cast<BufferDataProc>(glutGetProcAddress("glBufferData"));
+	useBuffers = genBuffers && deleteBuffers && bindBuffer && bufferData;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -257,6 +340,9 @@ void initLights() {
 	float lightPos[4] = { 0, 0, 20, 1 }; // positional light
 	glLightfv(GL_LIGHT0, GL_POSITION, lightPos);
 
+	// normals follow the outer loops, so light the back of a face as well
+	glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, GL_TRUE);
+
 	glEnable(GL_LIGHT0); // MUST enable each light source after configuration
 }
 
@@ -297,10 +383,37 @@ void showInfo() {
 	drawString(ss.str().c_str(), 1, 186, color, font);
 	ss.str("");
 
-	ss << "Press 'D' to switch drawing mode." << ends;
+	ss << "Solids in view: " << drawnSolids << " of " << brep->solids.size() << ends;
+	drawString(ss.str().c_str(), 1, 174, color, font);
+	ss.str("");
+
+	if (picked.vertex) {
+		ss << "Picked vertex " << picked.vertex->VertexId;
+	} else if (picked.edge) {
+		ss << "Picked edge " << picked.edge->EdgeId;
+	} else if (picked.face) {
+		ss << "Picked face " << picked.face->faceId;
+	} else {
+		ss << "Click to pick a face, edge or vertex.";
+	}
+	if (picked) {
+		ss << " of solid " << picked.face->solid->SolidId;
+	}
+	ss << ends;
+	drawString(ss.str().c_str(), 1, 162, color, font);
+	ss.str("");
+
+	ss << "Press 'D' to switch drawing mode, 'U'/'R' to undo/redo a command, '+'/'-'/'*' to combine the last two "
+	      "solids." << ends;
 	drawString(ss.str().c_str(), 1, 2, color, font);
 	ss.str("");
 
+#ifdef CADBREP_TRACE
+	ss << "Press 'T' to " << (trace.enabled ? "stop" : "start") << " tracing, 'P' to print the trace." << ends;
+	drawString(ss.str().c_str(), 1, 10, color, font);
+	ss.str("");
+#endif
+
 	// unset floating format
 	ss << std::resetiosflags(std::ios_base::fixed | std::ios_base::floatfield);
 
@@ -329,59 +442,64 @@ void displayCB() {
 	glRotatef(cameraAngleX, 1, 0, 0); // pitch
 	glRotatef(cameraAngleY, 0, 1, 0); // heading
 
+	++frameCount;
+	const GLsizei stride = 6 * sizeof(GLfloat);
+	glGetDoublev(GL_MODELVIEW_MATRIX, modelviewMatrix);
+	glGetDoublev(GL_PROJECTION_MATRIX, projectionMatrix);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	GLdouble planes[6][4];
+	frustumPlanes(planes);
+	drawnSolids = 0;
+	glColor3f(1, 1, 1);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
 	for (auto& solid : brep->solids) {
-		GLuint id = glGenLists(solid->faces.size());
-		if (!id)
-			return;
-		GLuint faceId = id;
-
-		for (auto& face : solid->faces) {
-			GLUtesselator* faceTess = gluNewTess();
-			gluTessCallback(faceTess, GLU_TESS_BEGIN, (void (__stdcall*)(void))tessBeginCB);
-			gluTessCallback(faceTess, GLU_TESS_END, (void (__stdcall*)(void))tessEndCB);
-			gluTessCallback(faceTess, GLU_TESS_ERROR, (void (__stdcall*)(void))tessErrorCB);
-			gluTessCallback(faceTess, GLU_TESS_VERTEX, (void (__stdcall*)())tessVertexCB);
-
-			glNewList(faceId, GL_COMPILE);
-			glColor3f(1, 1, 1);
-			gluTessBeginPolygon(faceTess, nullptr);
-			gluTessBeginContour(faceTess);
-			HalfEdge* he = face->outer_loop->first_edge;
-			vector<double*> vec;
-			do {
-				double* point = new double[3];
-				vec.push_back(point);
-				point[0] = he->start->point->x;
-				point[1] = he->start->point->y;
-				point[2] = he->start->point->z;
-				gluTessVertex(faceTess, point, point);
-				he = he->next;
-			} while (he != face->outer_loop->first_edge);
-			gluTessEndContour(faceTess);
-			for (Loop* loop : face->inner_loops) {
-				gluTessBeginContour(faceTess);
-				HalfEdge* he = loop->first_edge;
-				do {
-					double* point = new double[3];
-					vec.push_back(point);
-					point[0] = he->start->point->x;
-					point[1] = he->start->point->y;
-					point[2] = he->start->point->z;
-					gluTessVertex(faceTess, point, point);
-					he = he->next;
-				} while (he != loop->first_edge);
-				gluTessEndContour(faceTess);
+		if (!insideFrustum(solid->box(), planes)) {
+			// out of sight: neither tessellated nor drawn, but its buffers stay
+			auto it = meshCache.find(solid->SolidId);
+			if (it != meshCache.end()) {
+				it->second.frame = frameCount;
 			}
-			gluTessEndPolygon(faceTess);
-			for (GLdouble* d : vec) {
-				delete[] d;
+			continue;
+		}
+		++drawnSolids;
+		const SolidMesh& mesh = solidMesh(solid);
+		if (mesh.indexCount == 0) {
+			continue;
+		}
+		if (useBuffers) {
+			bindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+			bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffer);
+			glVertexPointer(3, GL_FLOAT, stride, nullptr);
+			glNormalPointer(GL_FLOAT, stride, reinterpret_cast<const GLvoid*>(3 * sizeof(GLfloat)));
+			glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, nullptr);
+		} else {
+			glVertexPointer(3, GL_FLOAT, stride, mesh.vertices.data());
+			glNormalPointer(GL_FLOAT, stride, mesh.vertices.data() + 3);
+			glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, mesh.indices.data());
+		}
+	}
+	if (useBuffers) {
+		bindBuffer(GL_ARRAY_BUFFER, 0);
+		bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	drawPicked();
+
+	// solids killed or undone since the last frame leave stale entries behind
+	if (meshCache.size() > brep->solids.size()) {
+		for (auto it = meshCache.begin(); it != meshCache.end();) {
+			if (it->second.frame == frameCount) {
+				++it;
+				continue;
 			}
-			glEndList();
-			gluDeleteTess(faceTess);
-			glCallList(faceId);
-			faceId++;
+			if (it->second.vertexBuffer) {
+				GLuint buffers[2] = { it->second.vertexBuffer, it->second.indexBuffer };
+				deleteBuffers(2, buffers);
+			}
+			it = meshCache.erase(it);
 		}
-		glDeleteLists(id, solid->faces.size());
 	}
 
 	// draw info messages
@@ -392,6 +510,269 @@ void displayCB() {
 	glutSwapBuffers();
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// planes a*x + b*y + c*z + d >= 0 bounding the view volume in model
+// coordinates, read off the rows of projection * modelview (Gribb/Hartmann)
+///////////////////////////////////////////////////////////////////////////////
+void frustumPlanes(GLdouble planes[6][4]) {
+	GLdouble clip[16];
+	// column-major, clip = projection * modelview
+	for (int column = 0; column < 4; ++column) {
+		for (int row = 0; row < 4; ++row) {
+			clip[4 * column + row] = 0;
+			for (int k = 0; k < 4; ++k) {
+				clip[4 * column + row] += projectionMatrix[4 * k + row] * modelviewMatrix[4 * column + k];
+			}
+		}
+	}
+	for (int i = 0; i < 6; ++i) {
+		int row = i / 2;
+		GLdouble sign = i % 2 ? -1 : 1; // left/right, bottom/top, near/far
+		for (int column = 0; column < 4; ++column) {
+			planes[i][column] = clip[4 * column + 3] + sign * clip[4 * column + row];
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// false only when the box lies wholly behind one of the planes; boxes that
+// straddle a corner of the frustum are kept, which is safe for culling
+///////////////////////////////////////////////////////////////////////////////
+bool insideFrustum(const Box& box, const GLdouble planes[6][4]) {
+	if (box.empty()) {
+		return false;
+	}
+	for (int i = 0; i < 6; ++i) {
+		// the corner furthest along the plane's normal
+		GLdouble distance = planes[i][3];
+		for (int axis = 0; axis < 3; ++axis) {
+			distance += planes[i][axis] * (planes[i][axis] > 0 ? box.max[axis] : box.min[axis]);
+		}
+		if (distance < 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// pick what lies under window position (x, y): the ray runs from the eye
+// through the pixel, and edges and vertices within a few pixels of the hit
+// point win over the face
+///////////////////////////////////////////////////////////////////////////////
+void pickAt(int x, int y) {
+	GLdouble farPoint[3];
+	gluUnProject(x, viewport[3] - y, 1, modelviewMatrix, projectionMatrix, viewport, &farPoint[0], &farPoint[1],
+	             &farPoint[2]);
+	// the eye is -R^T t for modelview rotation R and translation t
+	GLdouble eye[3];
+	for (int i = 0; i < 3; ++i) {
+		eye[i] = -(modelviewMatrix[4 * i] * modelviewMatrix[12] + modelviewMatrix[4 * i + 1] * modelviewMatrix[13] +
+		           modelviewMatrix[4 * i + 2] * modelviewMatrix[14]);
+	}
+	Ray ray{ Point(eye[0], eye[1], eye[2]), Point(farPoint[0] - eye[0], farPoint[1] - eye[1], farPoint[2] - eye[2]) };
+	double length = sqrt(ray.direction.x * ray.direction.x + ray.direction.y * ray.direction.y +
+	                     ray.direction.z * ray.direction.z);
+	ray.direction = Point(ray.direction.x / length, ray.direction.y / length, ray.direction.z / length);
+
+	// one pixel at unit distance, from the projection's 1 / tan(fovy / 2)
+	double pixel = 2 / (projectionMatrix[5] * viewport[3]);
+	picker.update(*brep);
+	picked = picker.pick(ray, 5 * pixel);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// replace the last two solids by their union, difference or intersection, as
+// one step for undo
+///////////////////////////////////////////////////////////////////////////////
+void combineLast(Boolean::Operation operation) {
+	if (brep->solids.size() < 2) {
+		return;
+	}
+	Boolean boolean;
+	Solid* a = brep->solids[brep->solids.size() - 2];
+	Solid* b = brep->solids.back();
+	if (!boolean.apply(*brep, a, b, operation)) {
+		cerr << "Boolean: " << boolean.error << endl;
+	}
+	brep->endStep();
+	picked = PickHit();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// highlight the picked face, edge or vertex on top of the solids
+///////////////////////////////////////////////////////////////////////////////
+void drawPicked() {
+	if (!picked) {
+		return;
+	}
+	glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT | GL_LINE_BIT | GL_POINT_BIT | GL_POLYGON_BIT);
+	glDisable(GL_LIGHTING);
+	if (picked.vertex) {
+		glDisable(GL_DEPTH_TEST);
+		glPointSize(8);
+		glColor3f(1, 0.8f, 0);
+		glBegin(GL_POINTS);
+		glVertex3d(picked.vertex->point->x, picked.vertex->point->y, picked.vertex->point->z);
+		glEnd();
+	} else if (picked.edge) {
+		glDisable(GL_DEPTH_TEST);
+		glLineWidth(3);
+		glColor3f(1, 0.8f, 0);
+		const Point *start = picked.edge->he1->start->point, *end = picked.edge->he1->end->point;
+		glBegin(GL_LINES);
+		glVertex3d(start->x, start->y, start->z);
+		glVertex3d(end->x, end->y, end->z);
+		glEnd();
+	} else {
+		// the face's triangles as last drawn
+		auto solid = meshCache.find(picked.face->solid->SolidId);
+		if (solid != meshCache.end()) {
+			auto face = solid->second.faces.find(picked.face->faceId);
+			if (face != solid->second.faces.end()) {
+				glEnable(GL_POLYGON_OFFSET_FILL);
+				glPolygonOffset(-1, -1);
+				glColor3f(1, 0.5f, 0.2f);
+				glBegin(GL_TRIANGLES);
+				for (GLuint index : face->second.indices) {
+					glVertex3fv(&face->second.positions[3 * index]);
+				}
+				glEnd();
+			}
+		}
+	}
+	glPopAttrib();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// return the mesh of a solid; when an Euler operator changed the solid since
+// its last upload, the faces it touched are tessellated again and the whole
+// solid is uploaded once more
+///////////////////////////////////////////////////////////////////////////////
+const SolidMesh& solidMesh(Solid* solid) {
+	auto [it, inserted] = meshCache.try_emplace(solid->SolidId);
+	SolidMesh& mesh = it->second;
+	mesh.frame = frameCount;
+	if (!inserted && mesh.revision == solid->revision) {
+		return mesh;
+	}
+	mesh.revision = solid->revision;
+
+	// untouched faces keep their triangles, killed ones drop out
+	unordered_map<int, FaceMesh> faces;
+	faces.reserve(solid->faces.size());
+	vertexScratch.clear();
+	indexScratch.clear();
+	for (Face* face : solid->faces) {
+		FaceMesh& faceMesh = faces[face->faceId];
+		auto old = mesh.faces.find(face->faceId);
+		if (old != mesh.faces.end() && old->second.revision == face->revision) {
+			faceMesh = std::move(old->second);
+		} else {
+			tessellateFace(face, faceMesh);
+			faceMesh.revision = face->revision;
+		}
+		GLuint base = static_cast<GLuint>(vertexScratch.size() / 6);
+		for (size_t i = 0; i < faceMesh.positions.size(); i += 3) {
+			vertexScratch.insert(vertexScratch.end(), faceMesh.positions.begin() + i, faceMesh.positions.begin() + i + 3);
+			vertexScratch.insert(vertexScratch.end(), faceMesh.normal, faceMesh.normal + 3);
+		}
+		for (GLuint index : faceMesh.indices) {
+			indexScratch.push_back(base + index);
+		}
+	}
+	mesh.faces.swap(faces);
+	mesh.indexCount = static_cast<GLsizei>(indexScratch.size());
+	TRACE(trace, "upload solid (id, faces, triangles)", solid->SolidId, static_cast<double>(solid->faces.size()),
+	      mesh.indexCount / 3.0);
+
+	if (useBuffers) {
+		if (!mesh.vertexBuffer) {
+			genBuffers(1, &mesh.vertexBuffer);
+			genBuffers(1, &mesh.indexBuffer);
+		}
+		bindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+		bufferData(GL_ARRAY_BUFFER, vertexScratch.size() * sizeof(GLfloat), vertexScratch.data(), GL_STATIC_DRAW);
+		bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffer);
+		bufferData(GL_ELEMENT_ARRAY_BUFFER, indexScratch.size() * sizeof(GLuint), indexScratch.data(), GL_STATIC_DRAW);
+	} else {
+		mesh.vertices.assign(vertexScratch.begin(), vertexScratch.end());
+		mesh.indices.assign(indexScratch.begin(), indexScratch.end());
+	}
+	return mesh;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// triangulate the outer loop and the inner loops of a face into mesh; faces
+// the native tessellator cannot cover (self-intersecting loops) go through GLU
+///////////////////////////////////////////////////////////////////////////////
+void tessellateFace(Face* face, FaceMesh& mesh) {
+	const Plane& plane = face->plane();
+	if (plane.normal[0] != 0 || plane.normal[1] != 0 || plane.normal[2] != 0) {
+		for (int i = 0; i < 3; ++i) {
+			mesh.normal[i] = static_cast<GLfloat>(plane.normal[i]);
+		}
+	}
+
+	tessScratch.clear();
+	if (tessellator.triangulate(face, tessScratch)) {
+		mesh.positions.assign(tessScratch.positions.begin(), tessScratch.positions.end());
+		mesh.indices.assign(tessScratch.indices.begin(), tessScratch.indices.end());
+		return;
+	}
+
+	if (!tess) {
+		tess = gluNewTess();
+		gluTessCallback(tess, GLU_TESS_BEGIN, (void (__stdcall*)(void))tessBeginCB);
+		gluTessCallback(tess, GLU_TESS_END, (void (__stdcall*)(void))tessEndCB);
+		gluTessCallback(tess, GLU_TESS_ERROR, (void (__stdcall*)(void))tessErrorCB);
+		gluTessCallback(tess, GLU_TESS_VERTEX, (void (__stdcall*)())tessVertexCB);
+		// an edge flag callback makes GLU emit independent triangles only
+		gluTessCallback(tess, GLU_TESS_EDGE_FLAG, (void (__stdcall*)())tessEdgeFlagCB);
+		gluTessCallback(tess, GLU_TESS_COMBINE, (void (__stdcall*)())tessCombineCB);
+	}
+
+	// gluTessVertex keeps the pointers until gluTessEndPolygon, so size the
+	// coordinate buffer up front and never let it reallocate in between
+	size_t count = 0;
+	HalfEdge* he = face->outer_loop->first_edge;
+	do {
+		++count;
+		he = he->next;
+	} while (he != face->outer_loop->first_edge);
+	for (Loop* loop : face->inner_loops) {
+		he = loop->first_edge;
+		do {
+			++count;
+			he = he->next;
+		} while (he != loop->first_edge);
+	}
+	tessCoords.resize(3 * count);
+
+	mesh.positions.clear();
+	mesh.indices.clear();
+	tessTarget = &mesh;
+	combineArena.used = 0;
+	GLdouble* point = tessCoords.data();
+	gluTessBeginPolygon(tess, nullptr);
+	for (size_t i = 0; i <= face->inner_loops.size(); ++i) {
+		Loop* loop = i == 0 ? face->outer_loop : face->inner_loops[i - 1];
+		gluTessBeginContour(tess);
+		he = loop->first_edge;
+		do {
+			point[0] = he->start->point->x;
+			point[1] = he->start->point->y;
+			point[2] = he->start->point->z;
+			gluTessVertex(tess, point, point);
+			point += 3;
+			he = he->next;
+		} while (he != loop->first_edge);
+		gluTessEndContour(tess);
+	}
+	gluTessEndPolygon(tess);
+	tessTarget = nullptr;
+}
+
 void reshapeCB(int w, int h) {
 	// set viewport to be the entire window
 	glViewport(0, 0, (GLsizei)w, (GLsizei)h);
@@ -425,6 +806,40 @@ void keyboardCB(unsigned char key, int x, int y) {
 	case ' ':
 		break;
 
+	case 'u': // undo the last command of input.txt
+	case 'U':
+		brep->undo();
+		picked = PickHit();
+		break;
+
+	case 'r':
+	case 'R':
+		brep->redo();
+		picked = PickHit();
+		break;
+
+	case '+': // union of the last two solids
+		combineLast(Boolean::Operation::unite);
+		break;
+
+	case '-': // the second to last solid minus the last one
+		combineLast(Boolean::Operation::subtract);
+		break;
+
+	case '*': // intersection of the last two solids
+		combineLast(Boolean::Operation::intersect);
+		break;
+
+	case 't': // start or stop recording the trace
+	case 'T':
+		trace.enabled = !trace.enabled;
+		break;
+
+	case 'p': // print the trace
+	case 'P':
+		trace.dump(stderr);
+		break;
+
 	case 'd': // switch rendering modes (fill -> wire -> point)
 	case 'D':
 		drawMode = ++drawMode % 3;
@@ -457,8 +872,15 @@ void mouseCB(int button, int state, int x, int y) {
 	if (button == GLUT_LEFT_BUTTON) {
 		if (state == GLUT_DOWN) {
 			mouseLeftDown = true;
-		} else if (state == GLUT_UP)
+			pressX = x;
+			pressY = y;
+		} else if (state == GLUT_UP) {
 			mouseLeftDown = false;
+			if (abs(x - pressX) + abs(y - pressY) <= 2) {
+				pickAt(x, y);
+				glutPostRedisplay();
+			}
+		}
 	} else if (button == GLUT_RIGHT_BUTTON) {
 		if (state == GLUT_DOWN) {
 			mouseRightDown = true;
@@ -488,18 +910,12 @@ void mouseMotionCB(int x, int y) {
 // GLU_TESS CALLBACKS
 ///////////////////////////////////////////////////////////////////////////////
 void CALLBACK tessBeginCB(GLenum which) {
-	glBegin(which);
-
-	// DEBUG //
-	ss << "glBegin(" << getPrimitiveType(which) << ");\n";
+	TRACE(trace, "glBegin", getPrimitiveType(which));
 }
 
 
 void CALLBACK tessEndCB() {
-	glEnd();
-
-	// DEBUG //
-	ss << "glEnd();\n";
+	TRACE(trace, "glEnd");
 }
 
 
@@ -507,13 +923,21 @@ void CALLBACK tessVertexCB(const GLvoid* data) {
 	// cast back to double type
 	const GLdouble* ptr = (const GLdouble*)data;
 
-	glVertex3dv(ptr);
+	tessTarget->indices.push_back(static_cast<GLuint>(tessTarget->positions.size() / 3));
+	tessTarget->positions.push_back(static_cast<GLfloat>(ptr[0]));
+	tessTarget->positions.push_back(static_cast<GLfloat>(ptr[1]));
+	tessTarget->positions.push_back(static_cast<GLfloat>(ptr[2]));
 
-	// DEBUG //
-	ss << "  glVertex3d(" << *ptr << ", " << *(ptr + 1) << ", " << *(ptr + 2) << ");\n";
+	TRACE(trace, "glVertex3d", ptr[0], ptr[1], ptr[2]);
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+// only registered so that GLU sticks to GL_TRIANGLES instead of fans and strips
+///////////////////////////////////////////////////////////////////////////////
+void CALLBACK tessEdgeFlagCB(GLboolean flag) {}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // draw a vertex with color
 ///////////////////////////////////////////////////////////////////////////////
@@ -524,55 +948,24 @@ void CALLBACK tessVertexCB2(const GLvoid* data) {
 	glColor3dv(ptr + 3);
 	glVertex3dv(ptr);
 
-	// DEBUG //
-	ss << "  glColor3d(" << *(ptr + 3) << ", " << *(ptr + 4) << ", " << *(ptr + 5) << ");\n";
-	ss << "  glVertex3d(" << *ptr << ", " << *(ptr + 1) << ", " << *(ptr + 2) << ");\n";
+	TRACE(trace, "glColor3d", ptr[3], ptr[4], ptr[5]);
+	TRACE(trace, "glVertex3d", ptr[0], ptr[1], ptr[2]);
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////
-// Combine callback is used to create a new vertex where edges intersect.
-// In this function, copy the vertex data into local array and compute the
-// color of the vertex. And send it back to tessellator, so tessellator pass it
-// to vertex callback function.
-//
-// newVertex: the intersect point which tessellator creates for us
-// neighborVertex[4]: 4 neighbor vertices to cause intersection (given from 3rd param of gluTessVertex()
-// neighborWeight[4]: 4 interpolation weights of 4 neighbor vertices
-// outData: the vertex data to return to tessellator
+// Combine callback: GLU reports a new vertex where contours intersect (or a
+// vertex it merges) and needs storage for it that lasts until the end of the
+// polygon. Only positions are tessellated, so the neighbours and weights are
+// not needed.
 ///////////////////////////////////////////////////////////////////////////////
 void CALLBACK tessCombineCB(const GLdouble newVertex[3], const GLdouble* neighborVertex[4],
                             const GLfloat neighborWeight[4], GLdouble** outData) {
-	// copy new intersect vertex to local array
-	// Because newVertex is temporal and cannot be hold by tessellator until next
-	// vertex callback called, it must be copied to the safe place in the app.
-	// Once gluTessEndPolygon() called, then you can safly deallocate the array.
-	vertices[vertexIndex][0] = newVertex[0];
-	vertices[vertexIndex][1] = newVertex[1];
-	vertices[vertexIndex][2] = newVertex[2];
-
-	// compute vertex color with given weights and colors of 4 neighbors
-	// the neighborVertex[4] must hold required info, in this case, color.
-	// neighborVertex was actually the third param of gluTessVertex() and is
-	// passed into here to compute the color of the intersect vertex.
-	vertices[vertexIndex][3] = neighborWeight[0] * neighborVertex[0][3] + // red
-	                           neighborWeight[1] * neighborVertex[1][3] +
-	                           neighborWeight[2] * neighborVertex[2][3] +
-	                           neighborWeight[3] * neighborVertex[3][3];
-	vertices[vertexIndex][4] = neighborWeight[0] * neighborVertex[0][4] + // green
-	                           neighborWeight[1] * neighborVertex[1][4] +
-	                           neighborWeight[2] * neighborVertex[2][4] +
-	                           neighborWeight[3] * neighborVertex[3][4];
-	vertices[vertexIndex][5] = neighborWeight[0] * neighborVertex[0][5] + // blue
-	                           neighborWeight[1] * neighborVertex[1][5] +
-	                           neighborWeight[2] * neighborVertex[2][5] +
-	                           neighborWeight[3] * neighborVertex[3][5];
-
-
-	// return output data (vertex coords and others)
-	*outData = vertices[vertexIndex]; // assign the address of new intersect vertex
-
-	++vertexIndex; // increase index for next vertex
+	GLdouble* vertex = combineArena.allocate();
+	vertex[0] = newVertex[0];
+	vertex[1] = newVertex[1];
+	vertex[2] = newVertex[2];
+	*outData = vertex;
 }
 
 void CALLBACK tessErrorCB(GLenum errorCode) {